@@ -0,0 +1,593 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * Loading textures directly from PAK (Quake1/2) and ZIP (PK3, PK4) archives.
+ * An archive is mapped once and its directory is indexed once (and kept around
+ * for the next files from the same archive), so browsing through an archive
+ * with thousands of textures doesn't need any extraction or open() calls.
+ * Files that are stored uncompressed are just a part of the archive's mapping,
+ * deflated files are inflated (with stb_image's zlib decoder) into pooled buffers.
+ */
+
+#define STBI_NO_STDIO
+#include "libs/stb_image.h"
+
+#include "texview.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+	#define strncasecmp _strnicmp
+#endif
+
+namespace texview {
+
+enum ZipMethod : uint16_t {
+	ZM_STORED = 0,
+	ZM_DEFLATED = 8
+};
+
+class Archive {
+public:
+	struct Entry {
+		std::string name; // with '/' as path separator
+		uint64_t offset; // of the data for PAK, of the local file header for ZIP
+		uint64_t compressedSize;
+		uint64_t size;
+		uint16_t method; // ZipMethod (always ZM_STORED for PAK)
+	};
+
+	std::string path;
+	MemMappedFile* mmf = nullptr;
+	bool isZip = false;
+	std::vector<Entry> entries; // sorted by name
+
+	~Archive() {
+		if(mmf != nullptr) {
+			UnloadMemMappedFile(mmf);
+		}
+	}
+
+	bool Open(const char* archivePath);
+
+	const Entry* FindEntry(const char* name) const;
+
+	// returns NULL if the entry is broken
+	const unsigned char* GetEntryData(const Entry& e) const;
+
+private:
+	bool IndexPAK();
+	bool IndexZIP();
+};
+
+static uint16_t Get16(const unsigned char* p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t Get32(const unsigned char* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint64_t Get64(const unsigned char* p) {
+	return Get32(p) | (uint64_t(Get32(p + 4)) << 32);
+}
+
+bool Archive::Open(const char* archivePath)
+{
+	path = archivePath;
+	// archives are always mapped: reading (or populating) a whole 2GB archive just to look
+	// at a few textures in it would be a waste, so neither the FIO_READ backend
+	// nor the MemMapHints (that are meant for single textures) make sense here
+	mmf = LoadMemMappedFile(archivePath, FIO_MMAP, MMH_NONE);
+	if(mmf == nullptr) {
+		return false;
+	}
+	if(mmf->readBuffer != nullptr) {
+		errprintf("Can't use '%s' as archive, it's not a regular file\n", archivePath);
+		return false;
+	}
+	bool ok = false;
+	if(mmf->length >= 12 && memcmp(mmf->data, "PACK", 4) == 0) {
+		ok = IndexPAK();
+	} else {
+		isZip = true;
+		ok = IndexZIP();
+	}
+	if(ok) {
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			return a.name < b.name;
+		});
+	}
+	return ok;
+}
+
+bool Archive::IndexPAK()
+{
+	// see https://quakewiki.org/wiki/.pak - the directory is an array of
+	// 64 byte entries: 56 chars name, 32bit offset, 32bit size (all little endian)
+	const unsigned char* d = (const unsigned char*)mmf->data;
+	const size_t len = mmf->length;
+	const uint32_t dirOffset = Get32(d + 4);
+	const uint32_t dirLen = Get32(d + 8);
+	if(dirOffset > len || dirLen > len - dirOffset || (dirLen % 64) != 0) {
+		errprintf("'%s' has an invalid PAK header\n", path.c_str());
+		return false;
+	}
+	const uint32_t numEntries = dirLen / 64;
+	entries.reserve(numEntries);
+	for(uint32_t i=0; i < numEntries; ++i) {
+		const unsigned char* e = d + dirOffset + i * 64;
+		Entry entry;
+		entry.name.assign((const char*)e, strnlen((const char*)e, 56));
+		entry.offset = Get32(e + 56);
+		entry.size = entry.compressedSize = Get32(e + 60);
+		entry.method = ZM_STORED;
+		if(entry.offset > len || entry.size > len - entry.offset) {
+			errprintf("Entry '%s' in '%s' is outside of the file, skipping it\n", entry.name.c_str(), path.c_str());
+			continue;
+		}
+		entries.push_back(std::move(entry));
+	}
+	return true;
+}
+
+// for ZIP64 the sizes and offset in the central directory are 0xFFFFFFFF,
+// the real values are in an extra field (only the ones that are 0xFFFFFFFF, in this order)
+static void ReadZip64ExtraField(const unsigned char* extra, size_t extraLen, Archive::Entry& e)
+{
+	while(extraLen >= 4) {
+		uint16_t id = Get16(extra);
+		uint16_t fieldLen = Get16(extra + 2);
+		if(fieldLen > extraLen - 4) {
+			return;
+		}
+		if(id == 0x0001) {
+			const unsigned char* f = extra + 4;
+			const unsigned char* fieldEnd = f + fieldLen;
+			if(e.size == 0xFFFFFFFF && fieldEnd - f >= 8) {
+				e.size = Get64(f);
+				f += 8;
+			}
+			if(e.compressedSize == 0xFFFFFFFF && fieldEnd - f >= 8) {
+				e.compressedSize = Get64(f);
+				f += 8;
+			}
+			if(e.offset == 0xFFFFFFFF && fieldEnd - f >= 8) {
+				e.offset = Get64(f);
+			}
+			return;
+		}
+		extra += 4 + fieldLen;
+		extraLen -= 4 + fieldLen;
+	}
+}
+
+bool Archive::IndexZIP()
+{
+	// see https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT
+	// the End Of Central Directory record is at the end of the file,
+	// but it can be followed by a comment (of up to 64KB)
+	const unsigned char* d = (const unsigned char*)mmf->data;
+	const size_t len = mmf->length;
+	if(len < 22) {
+		errprintf("'%s' is too small to be a ZIP or PAK file\n", path.c_str());
+		return false;
+	}
+	size_t eocd = len - 22;
+	const size_t minEOCD = (len > 22 + 0xFFFF) ? len - 22 - 0xFFFF : 0;
+	while(Get32(d + eocd) != 0x06054B50) {
+		if(eocd == minEOCD) {
+			errprintf("'%s' doesn't look like a ZIP or PAK file\n", path.c_str());
+			return false;
+		}
+		--eocd;
+	}
+	uint64_t numEntries = Get16(d + eocd + 10);
+	uint64_t cdSize = Get32(d + eocd + 12);
+	uint64_t cdOffset = Get32(d + eocd + 16);
+	if( (numEntries == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF)
+	   && eocd >= 20 && Get32(d + eocd - 20) == 0x07064B50 )
+	{
+		// ZIP64: the locator right before the EOCD has the offset of the ZIP64 EOCD record
+		// (the ZIP64 EOCD record is 56 bytes, a file can be shorter than that)
+		uint64_t eocd64 = Get64(d + eocd - 20 + 8);
+		if(len < 56 || eocd64 > len - 56 || Get32(d + eocd64) != 0x06064B50) {
+			errprintf("'%s' has an invalid ZIP64 End Of Central Directory record\n", path.c_str());
+			return false;
+		}
+		numEntries = Get64(d + eocd64 + 32);
+		cdSize = Get64(d + eocd64 + 40);
+		cdOffset = Get64(d + eocd64 + 48);
+	}
+	if(cdOffset > len || cdSize > len - cdOffset) {
+		errprintf("'%s' has an invalid ZIP central directory\n", path.c_str());
+		return false;
+	}
+	// each central directory entry is at least 46 bytes, so this limits the reserve()
+	// for broken files that claim to have billions of entries
+	entries.reserve(std::min(numEntries, cdSize / 46));
+	const unsigned char* cd = d + cdOffset;
+	const unsigned char* cdEnd = cd + cdSize;
+	for(uint64_t i=0; i < numEntries; ++i) {
+		if(cdEnd - cd < 46 || Get32(cd) != 0x02014B50) {
+			errprintf("'%s' has an invalid ZIP central directory entry (#%llu)\n", path.c_str(), (unsigned long long)i);
+			return false;
+		}
+		const uint16_t flags = Get16(cd + 8);
+		const uint16_t nameLen = Get16(cd + 28);
+		const uint16_t extraLen = Get16(cd + 30);
+		const uint16_t commentLen = Get16(cd + 32);
+		if(size_t(cdEnd - cd) < 46u + nameLen + extraLen + commentLen) {
+			errprintf("'%s' has an invalid ZIP central directory entry (#%llu)\n", path.c_str(), (unsigned long long)i);
+			return false;
+		}
+		Entry entry;
+		entry.name.assign((const char*)cd + 46, nameLen);
+		entry.method = Get16(cd + 10);
+		entry.compressedSize = Get32(cd + 20);
+		entry.size = Get32(cd + 24);
+		entry.offset = Get32(cd + 42);
+		if(entry.size == 0xFFFFFFFF || entry.compressedSize == 0xFFFFFFFF || entry.offset == 0xFFFFFFFF) {
+			ReadZip64ExtraField(cd + 46 + nameLen, extraLen, entry);
+		}
+		cd += 46 + nameLen + extraLen + commentLen;
+
+		if(entry.name.empty() || entry.name.back() == '/') {
+			continue; // directory
+		}
+		if(flags & 1) {
+			continue; // encrypted, can't be loaded anyway
+		}
+		// some (old Windows) tools use backslashes
+		std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+		entries.push_back(std::move(entry));
+	}
+	return true;
+}
+
+const Archive::Entry* Archive::FindEntry(const char* name) const
+{
+	auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const Entry& e, const char* n) {
+		return strcmp(e.name.c_str(), n) < 0;
+	});
+	if(it != entries.end() && it->name == name) {
+		return &*it;
+	}
+	return nullptr;
+}
+
+const unsigned char* Archive::GetEntryData(const Entry& e) const
+{
+	const unsigned char* d = (const unsigned char*)mmf->data;
+	const size_t len = mmf->length;
+	uint64_t dataOffset = e.offset;
+	if(isZip) {
+		// the data comes after the local file header, that has its own name and extra field
+		// lengths (that can differ from the central directory). It's only read now so indexing
+		// the archive doesn't touch (=> page fault) a local header for each file
+		if(e.offset > len || len - e.offset < 30 || Get32(d + e.offset) != 0x04034B50) {
+			return nullptr;
+		}
+		dataOffset = e.offset + 30 + Get16(d + e.offset + 26) + Get16(d + e.offset + 28);
+	}
+	if(dataOffset > len || e.compressedSize > len - dataOffset) {
+		return nullptr;
+	}
+	return d + dataOffset;
+}
+
+// opened archives are kept around (most recently used first), so they're only
+// indexed once. (Files loaded from an archive keep it alive even when it's not in this list)
+static std::mutex openArchivesMutex;
+static std::vector<std::shared_ptr<Archive>> openArchives;
+static const size_t MAX_OPEN_ARCHIVES = 8;
+
+static std::shared_ptr<Archive> GetArchive(const std::string& archivePath)
+{
+	uint64_t size = 0;
+	int64_t modTime = 0;
+	if(!GetFileSizeAndModTime(archivePath.c_str(), &size, &modTime)) {
+		errprintf("Can't open archive '%s', it doesn't exist or isn't a regular file\n", archivePath.c_str());
+		return nullptr;
+	}
+	// the lock is held while indexing, so if several loader threads want files from
+	// the same archive at the same time, it's still only indexed once
+	std::lock_guard<std::mutex> lock(openArchivesMutex);
+	for(auto it = openArchives.begin(); it != openArchives.end(); ++it) {
+		if((*it)->path != archivePath) {
+			continue;
+		}
+		if((*it)->mmf->length == size && (*it)->mmf->modTime == modTime) {
+			std::shared_ptr<Archive> ret = *it;
+			openArchives.erase(it);
+			openArchives.insert(openArchives.begin(), ret);
+			return ret;
+		}
+		// it has changed, so it must be indexed again
+		openArchives.erase(it);
+		break;
+	}
+	std::shared_ptr<Archive> ret = std::make_shared<Archive>();
+	if(!ret->Open(archivePath.c_str())) {
+		return nullptr;
+	}
+	openArchives.insert(openArchives.begin(), ret);
+	if(openArchives.size() > MAX_OPEN_ARCHIVES) {
+		openArchives.pop_back();
+	}
+	return ret;
+}
+
+// Deflated files are inflated into buffers from this pool. Buffer sizes are rounded up
+// to one of four steps per power of two, so files of similar size (like all the 256x256
+// textures in a PK3) can use the same buffers. Reusing them avoids that each big malloc()
+// gets fresh pages from the OS (that must be page-faulted in and zeroed) and that free()
+// gives them back right away
+static std::mutex bufferPoolMutex;
+static std::vector<std::pair<size_t, void*>> bufferPool; // size, buffer; oldest first
+static size_t bufferPoolBytes = 0;
+static const size_t MAX_BUFFER_POOL_BYTES = 128 * 1024 * 1024;
+
+static size_t GetPoolBufferSize(size_t size)
+{
+	size_t pow2 = 4096;
+	while(pow2 < size / 2) {
+		pow2 *= 2;
+	}
+	// size is now between pow2 and 2*pow2 (or smaller than 4096), round it up to pow2/4 steps
+	const size_t step = pow2 / 4;
+	return ((size + step - 1) / step) * step;
+}
+
+static void* GetPoolBuffer(size_t size)
+{
+	const size_t bufSize = GetPoolBufferSize(size);
+	{
+		std::lock_guard<std::mutex> lock(bufferPoolMutex);
+		// searching backwards, so the most recently used buffer (that's most likely still in the CPU cache) is used
+		for(size_t i = bufferPool.size(); i > 0; --i) {
+			if(bufferPool[i-1].first == bufSize) {
+				void* ret = bufferPool[i-1].second;
+				bufferPool.erase(bufferPool.begin() + (i-1));
+				bufferPoolBytes -= bufSize;
+				return ret;
+			}
+		}
+	}
+	return malloc(bufSize);
+}
+
+static void ReturnPoolBuffer(void* buf, size_t size)
+{
+	const size_t bufSize = GetPoolBufferSize(size);
+	std::lock_guard<std::mutex> lock(bufferPoolMutex);
+	bufferPool.push_back(std::make_pair(bufSize, buf));
+	bufferPoolBytes += bufSize;
+	while(bufferPoolBytes > MAX_BUFFER_POOL_BYTES) {
+		bufferPoolBytes -= bufferPool.front().first;
+		free(bufferPool.front().second);
+		bufferPool.erase(bufferPool.begin());
+	}
+}
+
+static const char* archiveExtensions[] = { ".pak", ".pk3", ".pk4", ".zip" };
+
+// returns true if the string from start to end ends with one of the archiveExtensions
+static bool HasArchiveExtension(const char* start, const char* end)
+{
+	for(const char* ext : archiveExtensions) {
+		size_t extLen = strlen(ext);
+		if(size_t(end - start) > extLen && strncasecmp(end - extLen, ext, extLen) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool IsPathSeparator(char c)
+{
+#ifdef _WIN32
+	return c == '/' || c == '\\';
+#else
+	return c == '/';
+#endif
+}
+
+// resolves "." and ".." and removes duplicate slashes, so innerPath
+// can be compared with the names in the archive
+static std::string NormalizeInnerPath(const char* innerPath)
+{
+	std::vector<std::string> parts;
+	const char* c = innerPath;
+	while(*c != '\0') {
+		const char* end = c;
+		while(*end != '\0' && !IsPathSeparator(*end)) {
+			++end;
+		}
+		std::string part(c, end - c);
+		if(part == "..") {
+			if(!parts.empty()) {
+				parts.pop_back();
+			}
+		} else if(!part.empty() && part != ".") {
+			parts.push_back(std::move(part));
+		}
+		c = (*end != '\0') ? end + 1 : end;
+	}
+	std::string ret;
+	for(const std::string& part : parts) {
+		if(!ret.empty()) {
+			ret += '/';
+		}
+		ret += part;
+	}
+	return ret;
+}
+
+bool HasArchiveExtension(const char* fileName)
+{
+	return HasArchiveExtension(fileName, fileName + strlen(fileName));
+}
+
+bool SplitArchivePath(const char* path, std::string& archivePath, std::string& innerPath)
+{
+	for(const char* c = path; ; ++c) {
+		if( (*c == '\0' || IsPathSeparator(*c)) && HasArchiveExtension(path, c) ) {
+			std::string candidate(path, c - path);
+			// it might just be a directory called foo.zip
+			if(GetFileSizeAndModTime(candidate.c_str(), nullptr, nullptr)) {
+				archivePath = std::move(candidate);
+				innerPath = NormalizeInnerPath(c);
+				return true;
+			}
+		}
+		if(*c == '\0') {
+			return false;
+		}
+	}
+}
+
+MemMappedFile* LoadArchivedFile(const char* archivePath, const char* innerPath)
+{
+	std::shared_ptr<Archive> archive = GetArchive(archivePath);
+	if(archive == nullptr) {
+		return nullptr;
+	}
+	if(innerPath[0] == '\0') {
+		errprintf("'%s' is an archive, not a texture\n", archivePath);
+		return nullptr;
+	}
+	const Archive::Entry* e = archive->FindEntry(innerPath);
+	if(e == nullptr) {
+		errprintf("Couldn't find '%s' in '%s'\n", innerPath, archivePath);
+		return nullptr;
+	}
+	if(e->size == 0) {
+		errprintf("Can't load '%s' from '%s', it's empty!\n", innerPath, archivePath);
+		return nullptr;
+	}
+	const unsigned char* data = archive->GetEntryData(*e);
+	if(data == nullptr) {
+		errprintf("'%s' in '%s' is broken (invalid offset or size)\n", innerPath, archivePath);
+		return nullptr;
+	}
+
+	MemMappedFile* ret = new MemMappedFile;
+	ret->length = e->size;
+	ret->modTime = archive->mmf->modTime;
+	if(e->method == ZM_STORED) {
+		if(e->compressedSize != e->size) {
+			errprintf("'%s' in '%s' is broken (size mismatch)\n", innerPath, archivePath);
+			delete ret;
+			return nullptr;
+		}
+		// no copying needed, it's just a part of the archive's mapping
+		ret->data = data;
+	} else if(e->method == ZM_DEFLATED) {
+		// stb_image's zlib decoder uses int for sizes
+		if(e->size > INT_MAX || e->compressedSize > INT_MAX) {
+			errprintf("Can't load '%s' from '%s', compressed files bigger than 2GB aren't supported\n", innerPath, archivePath);
+			delete ret;
+			return nullptr;
+		}
+		char* buf = (char*)GetPoolBuffer(e->size);
+		if(buf == nullptr) {
+			errprintf("Couldn't allocate %llu bytes to inflate '%s'\n", (unsigned long long)e->size, innerPath);
+			delete ret;
+			return nullptr;
+		}
+		int outLen = stbi_zlib_decode_noheader_buffer(buf, (int)e->size, (const char*)data, (int)e->compressedSize);
+		if(outLen != (int)e->size) {
+			errprintf("Inflating '%s' from '%s' failed: %s\n", innerPath, archivePath,
+			          outLen < 0 ? stbi_failure_reason() : "unexpected size");
+			ReturnPoolBuffer(buf, e->size);
+			delete ret;
+			return nullptr;
+		}
+		ret->data = ret->readBuffer = buf;
+	} else {
+		errprintf("Can't load '%s' from '%s', it uses an unsupported compression method (%d)\n",
+		          innerPath, archivePath, (int)e->method);
+		delete ret;
+		return nullptr;
+	}
+	ret->archive = std::move(archive);
+	return ret;
+}
+
+void ReleaseArchivedFile(MemMappedFile* mmf)
+{
+	if(mmf->readBuffer != nullptr) {
+		ReturnPoolBuffer(mmf->readBuffer, mmf->length);
+	}
+	delete mmf; // if this was the last reference to the archive (shared_ptr), it's unmapped now
+}
+
+bool ListArchiveDirectory(const char* dirPath, std::vector<std::string>& fileNames,
+                          std::vector<std::string>* dirNames)
+{
+	std::string archivePath, prefix;
+	if(!SplitArchivePath(dirPath, archivePath, prefix)) {
+		return false;
+	}
+	std::shared_ptr<Archive> archive = GetArchive(archivePath);
+	if(archive == nullptr) {
+		return false;
+	}
+	if(!prefix.empty() && prefix.back() != '/') {
+		prefix += '/';
+	}
+	// entries are sorted by name, so everything in that directory (incl. subdirectories)
+	// is one contiguous range, and all files in a subdirectory are next to each other
+	const std::vector<Archive::Entry>& entries = archive->entries;
+	auto it = std::lower_bound(entries.begin(), entries.end(), prefix, [](const Archive::Entry& e, const std::string& p) {
+		return e.name < p;
+	});
+	bool foundAny = false;
+	for(; it != entries.end() && it->name.compare(0, prefix.size(), prefix) == 0; ++it) {
+		foundAny = true;
+		const char* name = it->name.c_str() + prefix.size();
+		const char* slash = strchr(name, '/');
+		if(slash == nullptr) {
+			fileNames.push_back(name);
+		} else if(dirNames != nullptr && slash != name) {
+			std::string subDir(name, slash - name);
+			if(dirNames->empty() || dirNames->back() != subDir) {
+				dirNames->push_back(std::move(subDir));
+			}
+		}
+	}
+	// like ListDirectory() fails for directories that don't exist
+	return foundAny || prefix.empty();
+}
+
+bool GetArchivedFileSizeAndModTime(const char* path, uint64_t* size, int64_t* modTime)
+{
+	std::string archivePath, innerPath;
+	if(!SplitArchivePath(path, archivePath, innerPath) || innerPath.empty()) {
+		return false;
+	}
+	std::shared_ptr<Archive> archive = GetArchive(archivePath);
+	if(archive == nullptr) {
+		return false;
+	}
+	const Archive::Entry* e = archive->FindEntry(innerPath.c_str());
+	if(e == nullptr) {
+		return false;
+	}
+	if(size != nullptr) {
+		*size = e->size;
+	}
+	if(modTime != nullptr) {
+		*modTime = archive->mmf->modTime;
+	}
+	return true;
+}
+
+} //namespace texview
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ */
+
+#include "texview.h"
+
+#include <algorithm>
+
+namespace texview {
+
+bool AsyncLoader::Init(NotifyFun notifyFun)
+{
+	notify = notifyFun;
+	shutdown = false;
+
+	// more than one thread so a new load can start right away even if a cancelled
+	// load is still busy in some code that can't be interrupted (stb_image, libktx)
+	numThreads = std::thread::hardware_concurrency() / 2;
+	numThreads = std::min(std::max(numThreads, 2u), 4u);
+	for(unsigned i=0; i < numThreads; ++i) {
+		threads.push_back( std::thread(&AsyncLoader::WorkerThread, this) );
+	}
+	return true;
+}
+
+void AsyncLoader::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+		pendingJobs.clear();
+		pendingPrefetches.clear();
+		for(JobPtr& job : runningJobs) {
+			job->progress.cancelRequested = true;
+		}
+	}
+	cond.notify_all();
+	for(std::thread& t : threads) {
+		t.join();
+	}
+	threads.clear();
+	runningJobs.clear();
+	finishedJobs.clear();
+}
+
+void AsyncLoader::StartLoad(const char* path)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingJobs.clear();
+		for(JobPtr& j : runningJobs) {
+			if(!j->isPrefetch) {
+				j->progress.cancelRequested = true;
+			}
+		}
+		// also throw away loads that finished but haven't been fetched yet,
+		// they'd replace the texture we're about to load (but keep prefetched ones)
+		auto isRegular = [](const JobPtr& j) { return !j->isPrefetch; };
+		finishedJobs.erase(std::remove_if(finishedJobs.begin(), finishedJobs.end(), isRegular),
+		                   finishedJobs.end());
+
+		// if it's already being prefetched, just turn that into a regular load
+		for(JobPtr& j : finishedJobs) {
+			if(j->path == path) {
+				j->isPrefetch = false;
+				if(notify != nullptr) {
+					notify();
+				}
+				return;
+			}
+		}
+		for(JobPtr& j : runningJobs) {
+			if(j->isPrefetch && j->path == path) {
+				j->isPrefetch = false;
+				return;
+			}
+		}
+		JobPtr job;
+		for(auto it = pendingPrefetches.begin(); it != pendingPrefetches.end(); ++it) {
+			if((*it)->path == path) {
+				job = *it;
+				pendingPrefetches.erase(it);
+				job->isPrefetch = false;
+				break;
+			}
+		}
+		if(job == nullptr) {
+			job = std::make_shared<Job>();
+			job->path = path;
+		}
+		pendingJobs.push_back(job);
+	}
+	cond.notify_one();
+}
+
+void AsyncLoader::Prefetch(const char* path)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(IsLoadingLocked(path)) {
+			return;
+		}
+		JobPtr job = std::make_shared<Job>();
+		job->path = path;
+		job->isPrefetch = true;
+		pendingPrefetches.push_back(job);
+	}
+	cond.notify_one();
+}
+
+bool AsyncLoader::IsLoading(const char* path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return IsLoadingLocked(path);
+}
+
+bool AsyncLoader::IsLoadingLocked(const char* path) const
+{
+	for(const std::deque<JobPtr>* jobs : { &pendingJobs, &pendingPrefetches, &finishedJobs }) {
+		for(const JobPtr& j : *jobs) {
+			if(j->path == path) {
+				return true;
+			}
+		}
+	}
+	for(const JobPtr& j : runningJobs) {
+		if(j->path == path && !j->progress.IsCancelled()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void AsyncLoader::CancelAll()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pendingJobs.clear();
+	for(JobPtr& j : runningJobs) {
+		if(!j->isPrefetch) {
+			j->progress.cancelRequested = true;
+		}
+	}
+}
+
+bool AsyncLoader::GetFinished(Texture& tex, std::string& path, bool& success, bool& isPrefetch)
+{
+	JobPtr job;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(finishedJobs.empty()) {
+			return false;
+		}
+		job = finishedJobs.front();
+		finishedJobs.pop_front();
+		isPrefetch = job->isPrefetch;
+	}
+	path = std::move(job->path);
+	success = job->success;
+	if(success) {
+		tex = std::move(job->tex);
+	}
+	return true;
+}
+
+bool AsyncLoader::GetCurrentLoad(std::string& path, const char*& stage, float& progress)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for(JobPtr& job : runningJobs) {
+		if(!job->isPrefetch && !job->progress.IsCancelled()) {
+			path = job->path;
+			stage = job->progress.stage;
+			progress = job->progress.progress;
+			return true;
+		}
+	}
+	if(!pendingJobs.empty()) {
+		path = pendingJobs.front()->path;
+		stage = "Waiting";
+		progress = 0.0f;
+		return true;
+	}
+	return false;
+}
+
+void AsyncLoader::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true) {
+		// always keep one thread free of prefetches, so regular loads can start right away
+		auto canPrefetch = [this]() -> bool {
+			if(pendingPrefetches.empty()) {
+				return false;
+			}
+			size_t numPrefetching = 0;
+			for(const JobPtr& j : runningJobs) {
+				if(j->isPrefetch) {
+					++numPrefetching;
+				}
+			}
+			return numPrefetching + 1 < numThreads;
+		};
+		cond.wait(lock, [&]{ return shutdown || !pendingJobs.empty() || canPrefetch(); });
+		if(shutdown) {
+			break;
+		}
+		JobPtr job;
+		if(!pendingJobs.empty()) {
+			job = pendingJobs.front();
+			pendingJobs.pop_front();
+		} else {
+			job = pendingPrefetches.front();
+			pendingPrefetches.pop_front();
+		}
+		runningJobs.push_back(job);
+
+		lock.unlock();
+		job->success = job->tex.Load(job->path.c_str(), &job->progress);
+		if(job->success && computeMipHashes && !job->progress.IsCancelled()) {
+			job->tex.ComputeMipHashes();
+		}
+		lock.lock();
+
+		runningJobs.erase(std::find(runningJobs.begin(), runningJobs.end(), job));
+		if(job->isPrefetch) {
+			// a thread is free for another prefetch now
+			cond.notify_one();
+		}
+		if(job->progress.IsCancelled() || shutdown) {
+			// nobody is interested in this anymore, it's freed when job goes out of scope
+			continue;
+		}
+		if(!job->success) {
+			errprintf("Couldn't %s texture '%s'!\n", job->isPrefetch ? "prefetch" : "load", job->path.c_str());
+		}
+		finishedJobs.push_back(job);
+		if(notify != nullptr) {
+			notify();
+		}
+	}
+}
+
+} //namespace texview
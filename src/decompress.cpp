@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * Decompression of zstd- or gzip-compressed texture files (like foo.dds.zst
+ * or foo.ktx.gz), so they can be loaded without decompressing them to disk first.
+ * The whole file is decompressed into memory and then loaded like any other file.
+ * zstd files that consist of several frames (like the ones written by pzstd or
+ * zstd --long -T0 with some settings) are decompressed by several threads,
+ * one frame per thread. gzip (with stb_image's zlib decoder) is single-threaded.
+ */
+
+#define STBI_NO_STDIO
+#include "libs/stb_image.h"
+
+// zstd.c is built as part of libktx
+#include "libs/ktx/external/basisu/zstd/zstd.h"
+
+#include "texview.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace texview {
+
+static const unsigned char zstdMagic[4] = { 0x28, 0xB5, 0x2F, 0xFD };
+static const unsigned char gzipMagic[3] = { 0x1F, 0x8B, 0x08 }; // 8 = deflate, the only supported method
+
+const char* GetCompressedContainerName(const void* data, size_t size)
+{
+	if(size >= sizeof(zstdMagic) && memcmp(data, zstdMagic, sizeof(zstdMagic)) == 0) {
+		return "zstd";
+	}
+	if(size >= sizeof(gzipMagic) && memcmp(data, gzipMagic, sizeof(gzipMagic)) == 0) {
+		return "gzip";
+	}
+	return nullptr;
+}
+
+static MemMappedFile* NewReadBufferFile(void* buf, size_t size, const MemMappedFile* compressed)
+{
+	MemMappedFile* ret = new MemMappedFile;
+	ret->data = ret->readBuffer = buf;
+	ret->length = size;
+	ret->modTime = compressed->modTime;
+	return ret;
+}
+
+// for zstd frames that don't know their decompressed size, like when zstd compressed from a pipe
+static MemMappedFile* DecompressZstdStream(const MemMappedFile* mmf, const char* filename, LoadProgress* progress)
+{
+	ZSTD_DStream* ds = ZSTD_createDStream();
+	if(ds == nullptr) {
+		return nullptr;
+	}
+	size_t capacity = std::max(mmf->length * 4, ZSTD_DStreamOutSize());
+	size_t size = 0;
+	char* buf = (char*)malloc(capacity);
+	ZSTD_inBuffer in = { mmf->data, mmf->length, 0 };
+	bool ok = (buf != nullptr);
+	while(ok && in.pos < in.size) {
+		if(capacity - size < ZSTD_DStreamOutSize()) {
+			capacity *= 2;
+			char* newBuf = (char*)realloc(buf, capacity);
+			if(newBuf == nullptr) {
+				errprintf("Couldn't allocate %zu bytes to decompress '%s'\n", capacity, filename);
+				ok = false;
+				break;
+			}
+			buf = newBuf;
+		}
+		ZSTD_outBuffer out = { buf, capacity, size };
+		size_t res = ZSTD_decompressStream(ds, &out, &in);
+		if(ZSTD_isError(res)) {
+			errprintf("Decompressing '%s' failed: %s\n", filename, ZSTD_getErrorName(res));
+			ok = false;
+		}
+		size = out.pos;
+		if(progress != nullptr) {
+			if(progress->IsCancelled()) {
+				ok = false;
+			}
+			progress->Set("Decompressing", float(in.pos) / in.size);
+		}
+	}
+	ZSTD_freeDStream(ds);
+	if(!ok || size == 0) {
+		free(buf);
+		return nullptr;
+	}
+	return NewReadBufferFile(buf, size, mmf);
+}
+
+static MemMappedFile* DecompressZstd(const MemMappedFile* mmf, const char* filename, LoadProgress* progress)
+{
+	struct Frame {
+		size_t srcOffset;
+		size_t srcSize;
+		size_t dstOffset;
+		size_t dstSize;
+	};
+	std::vector<Frame> frames;
+	const unsigned char* src = (const unsigned char*)mmf->data;
+	const size_t srcLen = mmf->length;
+	size_t dstLen = 0;
+	for(size_t pos = 0; pos < srcLen; ) {
+		size_t frameSize = ZSTD_findFrameCompressedSize(src + pos, srcLen - pos);
+		if(ZSTD_isError(frameSize)) {
+			errprintf("Invalid zstd data in '%s': %s\n", filename, ZSTD_getErrorName(frameSize));
+			return nullptr;
+		}
+		unsigned long long contentSize = ZSTD_getFrameContentSize(src + pos, srcLen - pos);
+		if(contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+			// can't put the frames in parallel into one buffer if their sizes are unknown
+			return DecompressZstdStream(mmf, filename, progress);
+		}
+		if(contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize > SIZE_MAX - dstLen) {
+			errprintf("Invalid zstd frame header in '%s'\n", filename);
+			return nullptr;
+		}
+		frames.push_back({ pos, frameSize, dstLen, (size_t)contentSize });
+		dstLen += (size_t)contentSize;
+		pos += frameSize;
+	}
+	if(dstLen == 0) {
+		errprintf("'%s' is empty after decompressing!\n", filename);
+		return nullptr;
+	}
+	unsigned char* dst = (unsigned char*)malloc(dstLen);
+	if(dst == nullptr) {
+		errprintf("Couldn't allocate %zu bytes to decompress '%s'\n", dstLen, filename);
+		return nullptr;
+	}
+
+	std::atomic<size_t> nextFrame(0);
+	std::atomic<size_t> bytesDone(0);
+	std::atomic<bool> failed(false);
+	auto workerFun = [&]() {
+		ZSTD_DCtx* dctx = ZSTD_createDCtx();
+		if(dctx == nullptr) {
+			failed = true;
+			return;
+		}
+		size_t idx;
+		while(!failed && (idx = nextFrame++) < frames.size()) {
+			const Frame& f = frames[idx];
+			size_t res = ZSTD_decompressDCtx(dctx, dst + f.dstOffset, f.dstSize, src + f.srcOffset, f.srcSize);
+			if(ZSTD_isError(res) || res != f.dstSize) {
+				errprintf("Decompressing '%s' failed: %s\n", filename,
+				          ZSTD_isError(res) ? ZSTD_getErrorName(res) : "unexpected size");
+				failed = true;
+				break;
+			}
+			size_t done = (bytesDone += f.dstSize);
+			if(progress != nullptr) {
+				if(progress->IsCancelled()) {
+					failed = true;
+				}
+				progress->Set("Decompressing", float(done) / dstLen);
+			}
+		}
+		ZSTD_freeDCtx(dctx);
+	};
+
+	int numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	numThreads = std::min(numThreads, (int)frames.size());
+	std::vector<std::thread> threads;
+	for(int i=1; i < numThreads; ++i) {
+		threads.push_back(std::thread(workerFun));
+	}
+	workerFun(); // this thread helps as well
+	for(std::thread& t : threads) {
+		t.join();
+	}
+
+	if(failed) {
+		free(dst);
+		return nullptr;
+	}
+	return NewReadBufferFile(dst, dstLen, mmf);
+}
+
+static MemMappedFile* DecompressGzip(const MemMappedFile* mmf, const char* filename)
+{
+	// see RFC 1952 for the format
+	enum { FTEXT = 1, FHCRC = 2, FEXTRA = 4, FNAME = 8, FCOMMENT = 16 };
+	const unsigned char* src = (const unsigned char*)mmf->data;
+	const size_t srcLen = mmf->length;
+	if(srcLen < 18) {
+		errprintf("'%s' is too small to be a gzip file\n", filename);
+		return nullptr;
+	}
+	const unsigned char flags = src[3];
+	size_t pos = 10;
+	if(flags & FEXTRA) {
+		pos += 2 + (src[pos] | (src[pos+1] << 8));
+	}
+	if(flags & FNAME) {
+		while(pos < srcLen && src[pos] != '\0')
+			++pos;
+		++pos;
+	}
+	if(flags & FCOMMENT) {
+		while(pos < srcLen && src[pos] != '\0')
+			++pos;
+		++pos;
+	}
+	if(flags & FHCRC) {
+		pos += 2;
+	}
+	// the compressed data is followed by CRC32 and ISIZE (size of the uncompressed data mod 2^32)
+	if(pos + 8 > srcLen) {
+		errprintf("Invalid gzip header in '%s'\n", filename);
+		return nullptr;
+	}
+	const unsigned char* trailer = src + srcLen - 4;
+	uint32_t isize = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (uint32_t(trailer[3]) << 24);
+	size_t deflateLen = srcLen - 8 - pos;
+	// stb_image's zlib decoder uses int for sizes
+	if(deflateLen > INT_MAX || isize > INT_MAX) {
+		errprintf("'%s' is too big, gzip files are only supported up to 2GB\n", filename);
+		return nullptr;
+	}
+	int outLen = 0;
+	char* out = stbi_zlib_decode_malloc_guesssize_headerflag((const char*)src + pos, (int)deflateLen,
+	                                                         std::max((int)isize, 1), &outLen, 0);
+	if(out == nullptr) {
+		errprintf("Decompressing '%s' failed: %s\n", filename, stbi_failure_reason());
+		return nullptr;
+	}
+	// stb_image stops at the end of the first member, so if several gzip files
+	// were concatenated, the size (usually) doesn't match the one of the last member
+	if((uint32_t)outLen != isize || outLen == 0) {
+		errprintf("Decompressing '%s' failed: got %d bytes instead of %u (gzip files with several members aren't supported)\n",
+		          filename, outLen, isize);
+		free(out);
+		return nullptr;
+	}
+	return NewReadBufferFile(out, outLen, mmf);
+}
+
+MemMappedFile* DecompressMemMappedFile(const MemMappedFile* mmf, const char* filename, LoadProgress* progress)
+{
+	const char* name = GetCompressedContainerName(mmf->data, mmf->length);
+	if(name == nullptr) {
+		return nullptr;
+	}
+	if(progress != nullptr) {
+		progress->Set("Decompressing", 0.0f);
+	}
+	if(name[0] == 'z') {
+		return DecompressZstd(mmf, filename, progress);
+	}
+	return DecompressGzip(mmf, filename);
+}
+
+} //namespace texview
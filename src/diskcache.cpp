@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * On-disk cache for textures that are expensive to get into a GPU-ready state:
+ * images decoded with stb_image (PNG, JPEG, PSD, ...) and transcoded BasisU textures.
+ * The result (incl. the mip layout) is written to a file in GetCacheDir() that is
+ * mmap()ed when the same file is loaded again, so that only costs an mmap and an upload.
+ * Files are named by a hash of the source file's path, size, modification time,
+ * a hash of (parts of) its contents and a "variant" (e.g. the transcode target).
+ * Least recently used files are deleted when the cache gets bigger than its budget.
+ */
+
+#include "texview.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace texview {
+
+// textures smaller than this are so fast to decode that caching them isn't worth it
+static const size_t DISK_CACHE_MIN_SIZE = 256 * 1024;
+// mip level data in the cache file is aligned to this
+static const size_t DISK_CACHE_ALIGNMENT = 64;
+// for the content hash (of the source file) these many bytes are hashed
+// at the start, the end and at some positions in between
+static const size_t HASH_SAMPLE_SIZE = 4096;
+static const int HASH_NUM_SAMPLES = 64;
+
+static std::atomic<size_t> diskCacheBudget( size_t(2048) * 1024 * 1024 );
+
+struct DiskCacheHeader {
+	char magic[4]; // "TVDC"
+	uint32_t version;
+	uint64_t cacheKey;
+	uint64_t fileSize; // of the source file
+	int64_t fileModTime;
+	uint32_t fileType;
+	uint32_t textureFlags;
+	uint32_t dataFormat;
+	uint32_t glFormat;
+	uint32_t glType;
+	uint32_t glTarget;
+	uint32_t numElements;
+	uint32_t numMips;
+	// these strings follow the header (not 0-terminated),
+	// then the DiskCacheMip table (numElements * numMips entries)
+	uint32_t pathLength;
+	uint32_t formatNameLength;
+	uint32_t transcodeTargetLength;
+	uint32_t pad;
+	uint64_t dataOffset; // offset of the first mip level's data in the cache file
+};
+
+struct DiskCacheMip {
+	uint32_t width;
+	uint32_t height;
+	uint32_t size;
+	uint32_t pad;
+	uint64_t offset; // relative to DiskCacheHeader::dataOffset
+};
+
+static const uint32_t DISK_CACHE_VERSION = 1;
+
+static uint64_t HashBytes(const unsigned char* data, size_t len, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	for(size_t i=0; i < len; ++i) {
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static std::string GetDiskCachePath(uint64_t cacheKey)
+{
+	std::string cacheDir = GetCacheDir();
+	if(cacheDir.empty()) {
+		return cacheDir;
+	}
+	char fileName[40];
+	snprintf(fileName, sizeof(fileName), "/tex_%016llx.tvc", (unsigned long long)cacheKey);
+	return cacheDir + fileName;
+}
+
+void SetDiskCacheBudget(size_t budget)
+{
+	diskCacheBudget = budget;
+}
+
+size_t GetDiskCacheBudget()
+{
+	return diskCacheBudget.load();
+}
+
+uint64_t Texture::GetDiskCacheKey(const MemMappedFile* mmf, const char* filename, uint32_t variant)
+{
+	if(diskCacheBudget.load() == 0 || GetCacheDir().empty()) {
+		return 0;
+	}
+	if(IsStdinPath(filename)) {
+		// with only samples of the data hashed, different inputs might look the same
+		return 0;
+	}
+	uint64_t hash = HashBytes((const unsigned char*)filename, strlen(filename));
+	const uint64_t fileSize = mmf->length;
+	hash = HashBytes((const unsigned char*)&fileSize, sizeof(fileSize), hash);
+	hash = HashBytes((const unsigned char*)&mmf->modTime, sizeof(mmf->modTime), hash);
+	hash = HashBytes((const unsigned char*)&variant, sizeof(variant), hash);
+	// hashing the whole file would take about as long as decoding it (for big files
+	// most time is spent on reading them from disk), so only some samples are hashed.
+	// the modification time and size should catch most changes anyway
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	const size_t len = mmf->length;
+	if(len <= HASH_SAMPLE_SIZE * (HASH_NUM_SAMPLES + 2)) {
+		hash = HashBytes(data, len, hash);
+	} else {
+		hash = HashBytes(data, HASH_SAMPLE_SIZE, hash);
+		const size_t stride = (len - HASH_SAMPLE_SIZE) / (HASH_NUM_SAMPLES + 1);
+		for(int i=1; i <= HASH_NUM_SAMPLES; ++i) {
+			hash = HashBytes(data + i * stride, HASH_SAMPLE_SIZE, hash);
+		}
+		hash = HashBytes(data + len - HASH_SAMPLE_SIZE, HASH_SAMPLE_SIZE, hash);
+	}
+	// 0 means "don't use the cache"
+	return (hash != 0) ? hash : 1;
+}
+
+bool Texture::LoadFromDiskCache(uint64_t cacheKey, const char* filename)
+{
+	std::string path = GetDiskCachePath(cacheKey);
+	uint64_t size = 0;
+	if(path.empty() || !GetFileSizeAndModTime(path.c_str(), &size, nullptr) || size < sizeof(DiskCacheHeader)) {
+		return false;
+	}
+	MemMappedFile* mmf = LoadMemMappedFile(path.c_str());
+	if(mmf == nullptr) {
+		return false;
+	}
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	DiskCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+	const size_t pathLen = strlen(filename);
+	const uint64_t stringsEnd = sizeof(header) + uint64_t(header.pathLength)
+	                            + header.formatNameLength + header.transcodeTargetLength;
+	const uint64_t numMipEntries = uint64_t(header.numElements) * header.numMips;
+	const uint64_t mipTableOffset = (stringsEnd + 7) & ~uint64_t(7);
+	bool valid = memcmp(header.magic, "TVDC", 4) == 0 && header.version == DISK_CACHE_VERSION
+	             && header.cacheKey == cacheKey && header.pathLength == pathLen
+	             && header.numElements > 0 && header.numMips > 0
+	             && mipTableOffset + numMipEntries * sizeof(DiskCacheMip) <= header.dataOffset
+	             && header.dataOffset <= mmf->length
+	             && memcmp(data + sizeof(header), filename, pathLen) == 0;
+	// the transcode target name must be one of the known ones (it's a const char*)
+	const char* targetName = nullptr;
+	if(valid && header.transcodeTargetLength != 0) {
+		std::string tt((const char*)data + sizeof(header) + pathLen + header.formatNameLength,
+		               header.transcodeTargetLength);
+		targetName = FindTranscodeTargetName(tt.c_str());
+		valid = (targetName != nullptr);
+	}
+	std::vector<std::vector<MipLevel>> elems;
+	if(valid) {
+		const size_t dataSize = mmf->length - header.dataOffset;
+		const unsigned char* mipData = data + header.dataOffset;
+		const DiskCacheMip* mipTable = (const DiskCacheMip*)(data + mipTableOffset);
+		elems.resize(header.numElements);
+		for(uint32_t e=0; e < header.numElements && valid; ++e) {
+			elems[e].reserve(header.numMips);
+			for(uint32_t m=0; m < header.numMips; ++m) {
+				DiskCacheMip mip;
+				memcpy(&mip, &mipTable[e * header.numMips + m], sizeof(mip));
+				if(mip.offset > dataSize || mip.size > dataSize - mip.offset) {
+					valid = false;
+					break;
+				}
+				elems[e].push_back(MipLevel(mip.width, mip.height, mipData + mip.offset, mip.size));
+			}
+		}
+	}
+	if(!valid) {
+		// probably from an older version of texview, or broken => will be overwritten
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+
+	formatName.assign((const char*)data + sizeof(header) + pathLen, header.formatNameLength);
+	transcodeTarget = targetName;
+	elements = std::move(elems);
+	fileType = (FileType)header.fileType;
+	textureFlags = header.textureFlags;
+	dataFormat = header.dataFormat;
+	glFormat = header.glFormat;
+	glType = header.glType;
+	glTarget = header.glTarget;
+	texData = mmf;
+	cpuDataSize = mmf->length;
+	texDataFreeCookie = 0;
+	texDataFreeFun = FreeMemMappedTexData;
+	// for the LRU eviction
+	TouchFile(path.c_str());
+	return true;
+}
+
+// deletes the least recently used files from the cache until it fits in the budget
+void TrimDiskCache()
+{
+	// several loader threads might save textures at the same time
+	static std::mutex trimMutex;
+	std::lock_guard<std::mutex> lock(trimMutex);
+
+	std::string cacheDir = GetCacheDir();
+	std::vector<std::string> fileNames;
+	if(cacheDir.empty() || !ListDirectory(cacheDir.c_str(), fileNames)) {
+		return;
+	}
+	struct CacheFile {
+		std::string path;
+		uint64_t size;
+		int64_t modTime;
+	};
+	std::vector<CacheFile> files;
+	uint64_t totalSize = 0;
+	for(const std::string& fn : fileNames) {
+		// cached textures and the shader program binaries saved by main.cpp
+		bool isTexture = fn.length() >= 8 && fn.compare(0, 4, "tex_") == 0 && fn.compare(fn.length() - 4, 4, ".tvc") == 0;
+		bool isShader = fn.length() >= 11 && fn.compare(0, 7, "shader_") == 0 && fn.compare(fn.length() - 4, 4, ".bin") == 0;
+		if(!isTexture && !isShader) {
+			continue; // not one of ours (or a .tmp file that's currently being written)
+		}
+		CacheFile cf;
+		cf.path = cacheDir + "/" + fn;
+		if(GetFileSizeAndModTime(cf.path.c_str(), &cf.size, &cf.modTime)) {
+			totalSize += cf.size;
+			files.push_back(std::move(cf));
+		}
+	}
+	const size_t budget = diskCacheBudget.load();
+	if(totalSize <= budget) {
+		return;
+	}
+	// oldest first
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) {
+		return a.modTime < b.modTime;
+	});
+	for(const CacheFile& cf : files) {
+		if(totalSize <= budget) {
+			break;
+		}
+		if(RemoveFile(cf.path.c_str())) {
+			totalSize -= cf.size;
+		}
+	}
+}
+
+void Texture::SaveToDiskCache(uint64_t cacheKey, const char* filename)
+{
+	if(elements.empty() || elements[0].empty() || defaultSwizzle != nullptr) {
+		return; // the swizzle is a const char* that can't be restored, but this isn't used for those anyway
+	}
+	const uint32_t numMips = uint32_t(elements[0].size());
+	size_t dataSize = 0;
+	for(const std::vector<MipLevel>& mips : elements) {
+		if(mips.size() != numMips) {
+			return;
+		}
+		for(const MipLevel& mip : mips) {
+			if(mip.data == nullptr) {
+				return;
+			}
+			dataSize += (mip.size + DISK_CACHE_ALIGNMENT - 1) & ~(DISK_CACHE_ALIGNMENT - 1);
+		}
+	}
+	// something that takes up most of the cache would just push out everything else
+	const size_t budget = diskCacheBudget.load();
+	if(dataSize < DISK_CACHE_MIN_SIZE || dataSize > budget / 2) {
+		return;
+	}
+	std::string path = GetDiskCachePath(cacheKey);
+	if(path.empty()) {
+		return;
+	}
+
+	const size_t pathLen = strlen(filename);
+	const size_t targetLen = (transcodeTarget != nullptr) ? strlen(transcodeTarget) : 0;
+	const size_t stringsEnd = sizeof(DiskCacheHeader) + pathLen + formatName.length() + targetLen;
+	const size_t mipTableOffset = (stringsEnd + 7) & ~size_t(7);
+	const size_t numMipEntries = elements.size() * numMips;
+	const size_t dataOffset = (mipTableOffset + numMipEntries * sizeof(DiskCacheMip) + DISK_CACHE_ALIGNMENT - 1)
+	                          & ~(DISK_CACHE_ALIGNMENT - 1);
+
+	std::vector<unsigned char> headerBuf(dataOffset, 0);
+	DiskCacheHeader header = {};
+	memcpy(header.magic, "TVDC", 4);
+	header.version = DISK_CACHE_VERSION;
+	header.cacheKey = cacheKey;
+	header.fileSize = fileSize;
+	header.fileModTime = fileModTime;
+	header.fileType = fileType;
+	header.textureFlags = textureFlags;
+	header.dataFormat = dataFormat;
+	header.glFormat = glFormat;
+	header.glType = glType;
+	header.glTarget = glTarget;
+	header.numElements = uint32_t(elements.size());
+	header.numMips = numMips;
+	header.pathLength = uint32_t(pathLen);
+	header.formatNameLength = uint32_t(formatName.length());
+	header.transcodeTargetLength = uint32_t(targetLen);
+	header.dataOffset = dataOffset;
+	unsigned char* hp = headerBuf.data();
+	memcpy(hp, &header, sizeof(header));
+	hp += sizeof(header);
+	memcpy(hp, filename, pathLen);
+	hp += pathLen;
+	memcpy(hp, formatName.data(), formatName.length());
+	hp += formatName.length();
+	if(targetLen != 0) {
+		memcpy(hp, transcodeTarget, targetLen);
+	}
+
+	// the mip levels are written directly from wherever they are, no copying
+	static const unsigned char zeros[DISK_CACHE_ALIGNMENT] = {};
+	std::vector<DataChunk> chunks;
+	chunks.reserve(1 + 2 * numMipEntries);
+	chunks.push_back({ headerBuf.data(), headerBuf.size() });
+	DiskCacheMip* mipTable = (DiskCacheMip*)(headerBuf.data() + mipTableOffset);
+	uint64_t offset = 0;
+	for(size_t e=0; e < elements.size(); ++e) {
+		for(uint32_t m=0; m < numMips; ++m) {
+			const MipLevel& mip = elements[e][m];
+			DiskCacheMip dcm = {};
+			dcm.width = mip.width;
+			dcm.height = mip.height;
+			dcm.size = mip.size;
+			dcm.offset = offset;
+			memcpy(&mipTable[e * numMips + m], &dcm, sizeof(dcm));
+			chunks.push_back({ mip.data, mip.size });
+			size_t padding = (DISK_CACHE_ALIGNMENT - (mip.size % DISK_CACHE_ALIGNMENT)) % DISK_CACHE_ALIGNMENT;
+			if(padding != 0) {
+				chunks.push_back({ zeros, padding });
+			}
+			offset += mip.size + padding;
+		}
+	}
+
+	if(WriteWholeFile(path.c_str(), chunks.data(), chunks.size())) {
+		TrimDiskCache();
+	}
+}
+
+} //namespace texview
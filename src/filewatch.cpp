@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * Watching the file of the current texture for changes, so it can be reloaded
+ * automatically (e.g. while an artist keeps re-exporting it).
+ * On Linux this uses inotify on the directory of the file (many programs write a new
+ * file and rename it to the old name when saving, a watch on the file itself would miss that),
+ * elsewhere the modification time of the file is checked regularly.
+ */
+
+#include "texview.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace texview {
+
+// a change is only reported once there were no further events for this long
+static const int debounceMs = 300;
+// how often the modification time is checked if inotify isn't available
+static const int pollIntervalMs = 500;
+
+bool FileWatcher::Init(NotifyFun notifyFun)
+{
+	notify = notifyFun;
+	shutdown = false;
+#ifdef __linux__
+	if(pipe2(wakeupPipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+		errprintf("Creating the wakeup pipe for the file watcher failed: %s\n", strerror(errno));
+		return false;
+	}
+#endif
+	thread = std::thread(&FileWatcher::ThreadFun, this);
+	return true;
+}
+
+void FileWatcher::Shutdown()
+{
+	if(!thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+	}
+	WakeUp();
+	thread.join();
+#ifdef __linux__
+	close(wakeupPipe[0]);
+	close(wakeupPipe[1]);
+	wakeupPipe[0] = wakeupPipe[1] = -1;
+#endif
+}
+
+void FileWatcher::WakeUp()
+{
+	cond.notify_all();
+#ifdef __linux__
+	if(wakeupPipe[1] >= 0) {
+		char c = 1;
+		// if the pipe is full, the thread will wake up anyway
+		ssize_t ret = write(wakeupPipe[1], &c, 1);
+		(void)ret;
+	}
+#endif
+}
+
+void FileWatcher::Watch(const std::string& path, int64_t modTime)
+{
+	std::string file;
+	if(!path.empty() && !IsStdinPath(path.c_str())) {
+		std::string innerPath;
+		if(!SplitArchivePath(path.c_str(), file, innerPath)) {
+			file = path;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(path == watchPath && modTime == knownModTime) {
+			return;
+		}
+		watchPath = file.empty() ? std::string() : path;
+		filePath = file;
+		knownModTime = modTime;
+		changed = false;
+		++watchGeneration;
+	}
+	WakeUp();
+}
+
+bool FileWatcher::GetChanged(std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(!changed) {
+		return false;
+	}
+	changed = false;
+	path = watchPath;
+	return true;
+}
+
+#ifdef __linux__
+// waits (up to timeoutMs, -1 for no limit) until something happens in the watched directory
+// or the thread is woken up. returns true if one of the events was for fileName
+static bool WaitForInotify(int inotifyFd, int wakeupFd, int timeoutMs, const std::string& fileName)
+{
+	struct pollfd fds[2] = {
+		{ inotifyFd, POLLIN, 0 },
+		{ wakeupFd, POLLIN, 0 }
+	};
+	if(poll(fds, 2, timeoutMs) <= 0) {
+		return false;
+	}
+	alignas(struct inotify_event) char buf[4096];
+	while(read(wakeupFd, buf, sizeof(buf)) > 0)
+		;
+	bool ret = false;
+	ssize_t len;
+	while((len = read(inotifyFd, buf, sizeof(buf))) > 0) {
+		for(char* ptr = buf; ptr < buf + len; ) {
+			const struct inotify_event* ev = (const struct inotify_event*)ptr;
+			if(ev->len > 0 && fileName == ev->name) {
+				ret = true;
+			}
+			ptr += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+	return ret;
+}
+#endif
+
+void FileWatcher::ThreadFun()
+{
+	using clock = std::chrono::steady_clock;
+	int watchDesc = -1; // stays -1 without inotify
+#ifdef __linux__
+	int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotifyFd < 0) {
+		errprintf("inotify_init1() failed (%s), will check the modification time of files instead\n",
+		          strerror(errno));
+	}
+#endif
+	uint32_t generation = 0;
+	std::string path; // of the file that's watched
+	std::string fileName; // without the directory, as reported by inotify
+	int64_t reportedModTime = 0; // of the version that was loaded (or reported last)
+	int64_t lastSeenModTime = 0; // when checking the modification time without inotify
+	bool pending = false; // something happened, waiting for the file to settle down
+	clock::time_point lastEvent;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while(!shutdown) {
+		if(generation != watchGeneration) {
+			generation = watchGeneration;
+			path = filePath;
+			reportedModTime = lastSeenModTime = knownModTime;
+			lock.unlock();
+#ifdef __linux__
+			if(watchDesc >= 0) {
+				inotify_rm_watch(inotifyFd, watchDesc);
+				watchDesc = -1;
+			}
+			if(inotifyFd >= 0 && !path.empty()) {
+				size_t lastSlash = path.find_last_of('/');
+				std::string dir = (lastSlash == 0) ? "/" : path.substr(0, lastSlash);
+				fileName = path.substr(lastSlash + 1);
+				watchDesc = inotify_add_watch(inotifyFd, dir.c_str(),
+				                              IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+				if(watchDesc < 0) {
+					errprintf("Can't watch '%s' with inotify (%s), will check its modification time instead\n",
+					          dir.c_str(), strerror(errno));
+				}
+			}
+#endif
+			// it might have changed already since it was loaded, so check right away
+			pending = !path.empty();
+			lastEvent = clock::time_point();
+			lock.lock();
+			continue;
+		}
+		if(path.empty()) {
+			cond.wait(lock);
+			continue;
+		}
+		lock.unlock();
+
+		int timeoutMs = (watchDesc >= 0) ? -1 : pollIntervalMs;
+		if(pending) {
+			auto sinceEvent = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - lastEvent).count();
+			timeoutMs = int(std::max<decltype(sinceEvent)>(debounceMs - sinceEvent, 0));
+		}
+		if(timeoutMs != 0) {
+#ifdef __linux__
+			if(watchDesc >= 0) {
+				if(WaitForInotify(inotifyFd, wakeupPipe[0], timeoutMs, fileName)) {
+					pending = true;
+					lastEvent = clock::now();
+				}
+			} else
+#endif
+			{
+				lock.lock();
+				bool interrupted = cond.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+				                                 [&]{ return shutdown || generation != watchGeneration; });
+				lock.unlock();
+				int64_t modTime = 0;
+				if(!interrupted && GetFileSizeAndModTime(path.c_str(), nullptr, &modTime)
+				   && modTime != lastSeenModTime) {
+					lastSeenModTime = modTime;
+					pending = true;
+					lastEvent = clock::now();
+				}
+			}
+		}
+
+		if(pending && clock::now() - lastEvent >= std::chrono::milliseconds(debounceMs)) {
+			pending = false;
+			int64_t modTime = 0;
+			// if it doesn't exist (yet), it'll be reported when it's created
+			if(GetFileSizeAndModTime(path.c_str(), nullptr, &modTime) && modTime != reportedModTime) {
+				reportedModTime = lastSeenModTime = modTime;
+				lock.lock();
+				if(generation == watchGeneration) {
+					changed = true;
+					if(notify != nullptr) {
+						notify();
+					}
+				}
+				continue;
+			}
+		}
+		lock.lock();
+	}
+	lock.unlock();
+
+#ifdef __linux__
+	if(inotifyFd >= 0) {
+		close(inotifyFd); // also removes the watch
+	}
+#endif
+}
+
+} //namespace texview
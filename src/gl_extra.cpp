@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ */
+
+#include "gl_extra.h"
+
+#include <string.h>
+
+int TV_GL_ARB_instanced_arrays = 0;
+PFNGLVERTEXATTRIBDIVISORPROC tv_glVertexAttribDivisor = nullptr;
+
+int TV_GL_ARB_get_program_binary = 0;
+PFNGLGETPROGRAMBINARYPROC tv_glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC tv_glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC tv_glProgramParameteri = nullptr;
+
+int TV_GL_ARB_buffer_storage = 0;
+PFNGLBUFFERSTORAGEPROC tv_glBufferStorage = nullptr;
+
+int TV_GL_ARB_texture_storage = 0;
+PFNGLTEXSTORAGE2DPROC tv_glTexStorage2D = nullptr;
+PFNGLTEXSTORAGE3DPROC tv_glTexStorage3D = nullptr;
+
+int TV_GL_ARB_direct_state_access = 0;
+PFNGLCREATETEXTURESPROC tv_glCreateTextures = nullptr;
+PFNGLTEXTURESTORAGE2DPROC tv_glTextureStorage2D = nullptr;
+PFNGLTEXTURESTORAGE3DPROC tv_glTextureStorage3D = nullptr;
+PFNGLTEXTURESUBIMAGE2DPROC tv_glTextureSubImage2D = nullptr;
+PFNGLTEXTURESUBIMAGE3DPROC tv_glTextureSubImage3D = nullptr;
+PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC tv_glCompressedTextureSubImage2D = nullptr;
+PFNGLCOMPRESSEDTEXTURESUBIMAGE3DPROC tv_glCompressedTextureSubImage3D = nullptr;
+PFNGLTEXTUREPARAMETERIPROC tv_glTextureParameteri = nullptr;
+PFNGLBINDTEXTUREUNITPROC tv_glBindTextureUnit = nullptr;
+
+int TV_GL_ARB_internalformat_query2 = 0;
+PFNGLGETINTERNALFORMATIVPROC tv_glGetInternalformativ = nullptr;
+
+int TV_GetGLversion()
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	return major * 10 + minor;
+}
+
+bool TV_HasGLextension(const char* ext)
+{
+	GLint numExts = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExts);
+	for(GLint i=0; i < numExts; ++i) {
+		const char* e = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if(e != nullptr && strcmp(e, ext) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void TV_LoadGLextra(GLADloadfunc load)
+{
+	int glVersion = TV_GetGLversion();
+
+	TV_GL_ARB_instanced_arrays = 0;
+	if(glVersion >= 33) {
+		tv_glVertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC)load("glVertexAttribDivisor");
+	} else if(TV_HasGLextension("GL_ARB_instanced_arrays")) {
+		tv_glVertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC)load("glVertexAttribDivisorARB");
+	}
+	TV_GL_ARB_instanced_arrays = (tv_glVertexAttribDivisor != nullptr);
+
+	TV_GL_ARB_get_program_binary = 0;
+	if(glVersion >= 41 || TV_HasGLextension("GL_ARB_get_program_binary")) {
+		tv_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+		tv_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+		tv_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		// some drivers support the extension, but no formats, so it's useless
+		TV_GL_ARB_get_program_binary = tv_glGetProgramBinary != nullptr && tv_glProgramBinary != nullptr
+			&& tv_glProgramParameteri != nullptr && numFormats > 0;
+	}
+
+	TV_GL_ARB_buffer_storage = 0;
+	if(glVersion >= 44 || TV_HasGLextension("GL_ARB_buffer_storage")) {
+		tv_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+		TV_GL_ARB_buffer_storage = (tv_glBufferStorage != nullptr);
+	}
+
+	TV_GL_ARB_texture_storage = 0;
+	if(glVersion >= 42 || TV_HasGLextension("GL_ARB_texture_storage")) {
+		tv_glTexStorage2D = (PFNGLTEXSTORAGE2DPROC)load("glTexStorage2D");
+		tv_glTexStorage3D = (PFNGLTEXSTORAGE3DPROC)load("glTexStorage3D");
+		TV_GL_ARB_texture_storage = (tv_glTexStorage2D != nullptr && tv_glTexStorage3D != nullptr);
+	}
+
+	TV_GL_ARB_direct_state_access = 0;
+	if(glVersion >= 45 || TV_HasGLextension("GL_ARB_direct_state_access")) {
+		tv_glCreateTextures = (PFNGLCREATETEXTURESPROC)load("glCreateTextures");
+		tv_glTextureStorage2D = (PFNGLTEXTURESTORAGE2DPROC)load("glTextureStorage2D");
+		tv_glTextureStorage3D = (PFNGLTEXTURESTORAGE3DPROC)load("glTextureStorage3D");
+		tv_glTextureSubImage2D = (PFNGLTEXTURESUBIMAGE2DPROC)load("glTextureSubImage2D");
+		tv_glTextureSubImage3D = (PFNGLTEXTURESUBIMAGE3DPROC)load("glTextureSubImage3D");
+		tv_glCompressedTextureSubImage2D = (PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC)load("glCompressedTextureSubImage2D");
+		tv_glCompressedTextureSubImage3D = (PFNGLCOMPRESSEDTEXTURESUBIMAGE3DPROC)load("glCompressedTextureSubImage3D");
+		tv_glTextureParameteri = (PFNGLTEXTUREPARAMETERIPROC)load("glTextureParameteri");
+		tv_glBindTextureUnit = (PFNGLBINDTEXTUREUNITPROC)load("glBindTextureUnit");
+		TV_GL_ARB_direct_state_access = tv_glCreateTextures != nullptr
+			&& tv_glTextureStorage2D != nullptr && tv_glTextureStorage3D != nullptr
+			&& tv_glTextureSubImage2D != nullptr && tv_glTextureSubImage3D != nullptr
+			&& tv_glCompressedTextureSubImage2D != nullptr && tv_glCompressedTextureSubImage3D != nullptr
+			&& tv_glTextureParameteri != nullptr && tv_glBindTextureUnit != nullptr;
+	}
+
+	TV_GL_ARB_internalformat_query2 = 0;
+	if(glVersion >= 43 || TV_HasGLextension("GL_ARB_internalformat_query2")) {
+		tv_glGetInternalformativ = (PFNGLGETINTERNALFORMATIVPROC)load("glGetInternalformativ");
+		TV_GL_ARB_internalformat_query2 = (tv_glGetInternalformativ != nullptr);
+	}
+}
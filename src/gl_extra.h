@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * The glad loader in libs/glad/ only covers OpenGL 3.2 (+ some texture
+ * compression extensions). This adds (in the same style) the few things
+ * from newer GL versions/extensions that are used when available.
+ * Call TV_LoadGLextra() after gladLoadGL() and check the TV_GL_* flags
+ * before using any of this.
+ */
+
+#ifndef _TV_GL_EXTRA_H
+#define _TV_GL_EXTRA_H
+
+#include <glad/gl.h>
+
+#ifndef GL_ARB_buffer_storage
+#define GL_ARB_buffer_storage 1
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#define GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT 0x00004000
+#define GL_BUFFER_IMMUTABLE_STORAGE 0x821F
+#define GL_BUFFER_STORAGE_FLAGS 0x8220
+typedef void (GLAD_API_PTR *PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#endif
+
+#ifndef GL_ARB_texture_storage
+#define GL_ARB_texture_storage 1
+#define GL_TEXTURE_IMMUTABLE_FORMAT 0x912F
+typedef void (GLAD_API_PTR *PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (GLAD_API_PTR *PFNGLTEXSTORAGE3DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+#endif
+
+#ifndef GL_ARB_direct_state_access
+#define GL_ARB_direct_state_access 1
+typedef void (GLAD_API_PTR *PFNGLCREATETEXTURESPROC)(GLenum target, GLsizei n, GLuint *textures);
+typedef void (GLAD_API_PTR *PFNGLTEXTURESTORAGE2DPROC)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (GLAD_API_PTR *PFNGLTEXTURESTORAGE3DPROC)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+typedef void (GLAD_API_PTR *PFNGLTEXTURESUBIMAGE2DPROC)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+typedef void (GLAD_API_PTR *PFNGLTEXTURESUBIMAGE3DPROC)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels);
+typedef void (GLAD_API_PTR *PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void *data);
+typedef void (GLAD_API_PTR *PFNGLCOMPRESSEDTEXTURESUBIMAGE3DPROC)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *data);
+typedef void (GLAD_API_PTR *PFNGLTEXTUREPARAMETERIPROC)(GLuint texture, GLenum pname, GLint param);
+typedef void (GLAD_API_PTR *PFNGLBINDTEXTUREUNITPROC)(GLuint unit, GLuint texture);
+#endif
+
+#ifndef GL_ARB_internalformat_query2
+#define GL_ARB_internalformat_query2 1
+#define GL_INTERNALFORMAT_SUPPORTED 0x826F
+typedef void (GLAD_API_PTR *PFNGLGETINTERNALFORMATIVPROC)(GLenum target, GLenum internalformat, GLenum pname, GLsizei count, GLint *params);
+#endif
+
+#ifndef GL_ARB_instanced_arrays
+#define GL_ARB_instanced_arrays 1
+#define GL_VERTEX_ATTRIB_ARRAY_DIVISOR 0x88FE
+typedef void (GLAD_API_PTR *PFNGLVERTEXATTRIBDIVISORPROC)(GLuint index, GLuint divisor);
+#endif
+
+// 1 if GL_ARB_instanced_arrays or OpenGL 3.3 is available
+extern int TV_GL_ARB_instanced_arrays;
+extern PFNGLVERTEXATTRIBDIVISORPROC tv_glVertexAttribDivisor;
+#define glVertexAttribDivisor tv_glVertexAttribDivisor
+
+#ifndef GL_ARB_get_program_binary
+#define GL_ARB_get_program_binary 1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+typedef void (GLAD_API_PTR *PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (GLAD_API_PTR *PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (GLAD_API_PTR *PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+#endif
+
+// 1 if GL_ARB_get_program_binary or OpenGL 4.1 is available
+// *and* the driver supports at least one binary format
+extern int TV_GL_ARB_get_program_binary;
+extern PFNGLGETPROGRAMBINARYPROC tv_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC tv_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC tv_glProgramParameteri;
+#define glGetProgramBinary tv_glGetProgramBinary
+#define glProgramBinary tv_glProgramBinary
+#define glProgramParameteri tv_glProgramParameteri
+
+// 1 if GL_ARB_buffer_storage or OpenGL 4.4 is available
+extern int TV_GL_ARB_buffer_storage;
+extern PFNGLBUFFERSTORAGEPROC tv_glBufferStorage;
+#define glBufferStorage tv_glBufferStorage
+
+// 1 if GL_ARB_texture_storage or OpenGL 4.2 is available
+extern int TV_GL_ARB_texture_storage;
+extern PFNGLTEXSTORAGE2DPROC tv_glTexStorage2D;
+extern PFNGLTEXSTORAGE3DPROC tv_glTexStorage3D;
+#define glTexStorage2D tv_glTexStorage2D
+#define glTexStorage3D tv_glTexStorage3D
+
+// 1 if GL_ARB_direct_state_access or OpenGL 4.5 is available
+// (only the functions used by texview are loaded)
+extern int TV_GL_ARB_direct_state_access;
+extern PFNGLCREATETEXTURESPROC tv_glCreateTextures;
+extern PFNGLTEXTURESTORAGE2DPROC tv_glTextureStorage2D;
+extern PFNGLTEXTURESTORAGE3DPROC tv_glTextureStorage3D;
+extern PFNGLTEXTURESUBIMAGE2DPROC tv_glTextureSubImage2D;
+extern PFNGLTEXTURESUBIMAGE3DPROC tv_glTextureSubImage3D;
+extern PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC tv_glCompressedTextureSubImage2D;
+extern PFNGLCOMPRESSEDTEXTURESUBIMAGE3DPROC tv_glCompressedTextureSubImage3D;
+extern PFNGLTEXTUREPARAMETERIPROC tv_glTextureParameteri;
+extern PFNGLBINDTEXTUREUNITPROC tv_glBindTextureUnit;
+#define glCreateTextures tv_glCreateTextures
+#define glTextureStorage2D tv_glTextureStorage2D
+#define glTextureStorage3D tv_glTextureStorage3D
+#define glTextureSubImage2D tv_glTextureSubImage2D
+#define glTextureSubImage3D tv_glTextureSubImage3D
+#define glCompressedTextureSubImage2D tv_glCompressedTextureSubImage2D
+#define glCompressedTextureSubImage3D tv_glCompressedTextureSubImage3D
+#define glTextureParameteri tv_glTextureParameteri
+#define glBindTextureUnit tv_glBindTextureUnit
+
+// 1 if GL_ARB_internalformat_query2 or OpenGL 4.3 is available
+// (glGetInternalformativ() itself is from GL_ARB_internalformat_query,
+//  but GL_INTERNALFORMAT_SUPPORTED needs the "2" version)
+extern int TV_GL_ARB_internalformat_query2;
+extern PFNGLGETINTERNALFORMATIVPROC tv_glGetInternalformativ;
+#define glGetInternalformativ tv_glGetInternalformativ
+
+// returns the OpenGL version as major*10 + minor, e.g. 33 for 3.3
+extern int TV_GetGLversion();
+
+// returns true if the given extension is supported by the current context
+extern bool TV_HasGLextension(const char* ext);
+
+// must be called with a current context, after gladLoadGL()
+extern void TV_LoadGLextra(GLADloadfunc load);
+
+#endif // _TV_GL_EXTRA_H
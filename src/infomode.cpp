@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * Headless "texview --info" mode that prints format, size etc of lots of
+ * textures (as JSON or CSV), using the same loading code as the viewer.
+ * By default only the headers are parsed (see Texture::Load()'s infoOnly),
+ * with --decode the textures are completely loaded (incl. decoding/transcoding).
+ */
+
+#include "texview.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace texview {
+
+struct InfoResult {
+	bool ok = false;
+	const char* fileType = "";
+	std::string formatName;
+	int width = 0;
+	int height = 0;
+	int numMips = 0;
+	int numElements = 0; // array elements (not counting cube faces)
+	int numCubeFaces = 0;
+	uint32_t textureFlags = 0;
+	uint64_t fileSize = 0;
+	PageFaultCounts faults; // while loading
+};
+
+static void PrintUsage()
+{
+	errprintf("Usage: texview --info [--json | --csv] [--decode] [--io mmap|read] [--mmap-hints HINTS] [-j numThreads] [-o outfile] file_or_dir ...\n"
+	          "  Prints information about the given textures (directories and archives like .pk3\n"
+	          "  are searched recursively, - is stdin).\n"
+	          "  --json     Output a JSON array (default)\n"
+	          "  --csv      Output CSV with a header line\n"
+	          "  --decode   Load the whole texture (decode/transcode pixel data), not just the header\n"
+	          "  --io BACKEND  How files are accessed: mmap (default) or read (better on network filesystems)\n"
+	          "  --mmap-hints HINTS  Comma-separated list of: populate,sequential,willneed,hugepage,readahead\n"
+	          "  -j N       Use N threads (default: number of CPU cores)\n"
+	          "  -o FILE    Write to FILE instead of stdout\n");
+}
+
+static void CollectFiles(const std::string& dirPath, std::vector<std::string>& outFiles)
+{
+	std::vector<std::string> fileNames;
+	std::vector<std::string> dirNames;
+	// archives (PAK, PK3, ...) are searched like directories
+	if(!ListArchiveDirectory(dirPath.c_str(), fileNames, &dirNames)
+	   && !ListDirectory(dirPath.c_str(), fileNames, &dirNames)) {
+		return;
+	}
+	// sorted so the output order is deterministic
+	std::sort(fileNames.begin(), fileNames.end());
+	std::sort(dirNames.begin(), dirNames.end());
+	for(const std::string& f : fileNames) {
+		if(HasSupportedFileExtension(f.c_str())) {
+			outFiles.push_back(dirPath + '/' + f);
+		} else if(HasArchiveExtension(f.c_str())) {
+			dirNames.push_back(f);
+		}
+	}
+	for(const std::string& d : dirNames) {
+		CollectFiles(dirPath + '/' + d, outFiles);
+	}
+}
+
+static void GetInfo(const std::string& path, bool decode, InfoResult& res)
+{
+	Texture tex;
+	if(!tex.Load(path.c_str(), nullptr, !decode)) {
+		return;
+	}
+	res.ok = true;
+	switch(tex.fileType) {
+		case Texture::FT_DDS: res.fileType = "DDS"; break;
+		case Texture::FT_KTX: res.fileType = "KTX"; break;
+		case Texture::FT_STB: res.fileType = "STB"; break;
+		case Texture::FT_WAL: res.fileType = "WAL"; break;
+		case Texture::FT_PCX: res.fileType = "PCX"; break;
+		case Texture::FT_BMP: res.fileType = "BMP"; break;
+		case Texture::FT_TGA: res.fileType = "TGA"; break;
+		case Texture::FT_RAW: res.fileType = "RAW"; break;
+		default: res.fileType = "";
+	}
+	res.formatName = tex.formatName;
+	float w = 0.0f, h = 0.0f;
+	tex.GetSize(&w, &h);
+	res.width = (int)w;
+	res.height = (int)h;
+	res.numMips = tex.GetNumMips();
+	res.numElements = tex.GetNumElements();
+	res.numCubeFaces = tex.IsCubemap() ? tex.GetNumCubemapFaces() : 0;
+	res.textureFlags = tex.textureFlags;
+	res.fileSize = tex.fileSize;
+	res.faults = tex.loadFaults;
+}
+
+static void WriteJSONstring(FILE* out, const char* str)
+{
+	fputc('"', out);
+	for(const char* c = str; *c != '\0'; ++c) {
+		unsigned char uc = (unsigned char)*c;
+		if(uc == '"' || uc == '\\') {
+			fputc('\\', out);
+			fputc(uc, out);
+		} else if(uc < 0x20) {
+			fprintf(out, "\\u%04x", uc);
+		} else {
+			fputc(uc, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void WriteCSVstring(FILE* out, const char* str)
+{
+	if(strpbrk(str, ",\"\r\n") == nullptr) {
+		fputs(str, out);
+		return;
+	}
+	fputc('"', out);
+	for(const char* c = str; *c != '\0'; ++c) {
+		if(*c == '"') {
+			fputc('"', out); // quotes are escaped by doubling them
+		}
+		fputc(*c, out);
+	}
+	fputc('"', out);
+}
+
+static const char* BoolStr(bool b)
+{
+	return b ? "true" : "false";
+}
+
+static void WriteJSON(FILE* out, const std::vector<std::string>& files, const std::vector<InfoResult>& results)
+{
+	fputs("[\n", out);
+	for(size_t i=0; i < files.size(); ++i) {
+		const InfoResult& r = results[i];
+		fputs("  { \"path\": ", out);
+		WriteJSONstring(out, files[i].c_str());
+		fprintf(out, ", \"ok\": %s", BoolStr(r.ok));
+		if(r.ok) {
+			fprintf(out, ", \"fileType\": \"%s\", \"format\": ", r.fileType);
+			WriteJSONstring(out, r.formatName.c_str());
+			uint32_t f = r.textureFlags;
+			fprintf(out, ", \"width\": %d, \"height\": %d, \"mips\": %d, \"arrayElements\": %d,"
+			        " \"isArray\": %s, \"cubeFaces\": %d, \"sRGB\": %s, \"alpha\": %s,"
+			        " \"premultipliedAlpha\": %s, \"compressed\": %s, \"fileSize\": %llu,"
+			        " \"minorFaults\": %llu, \"majorFaults\": %llu",
+			        r.width, r.height, r.numMips, r.numElements, BoolStr(f & TF_IS_ARRAY), r.numCubeFaces,
+			        BoolStr(f & TF_SRGB), BoolStr(f & TF_HAS_ALPHA), BoolStr(f & TF_PREMUL_ALPHA),
+			        BoolStr(f & TF_COMPRESSED), (unsigned long long)r.fileSize,
+			        (unsigned long long)r.faults.minor, (unsigned long long)r.faults.major);
+		}
+		fputs((i+1 < files.size()) ? " },\n" : " }\n", out);
+	}
+	fputs("]\n", out);
+}
+
+static void WriteCSV(FILE* out, const std::vector<std::string>& files, const std::vector<InfoResult>& results)
+{
+	fputs("path,ok,fileType,format,width,height,mips,arrayElements,isArray,cubeFaces,sRGB,alpha,premultipliedAlpha,compressed,fileSize,minorFaults,majorFaults\n", out);
+	for(size_t i=0; i < files.size(); ++i) {
+		const InfoResult& r = results[i];
+		WriteCSVstring(out, files[i].c_str());
+		if(!r.ok) {
+			fputs(",false,,,,,,,,,,,,,,,\n", out);
+			continue;
+		}
+		fprintf(out, ",true,%s,", r.fileType);
+		WriteCSVstring(out, r.formatName.c_str());
+		uint32_t f = r.textureFlags;
+		fprintf(out, ",%d,%d,%d,%d,%s,%d,%s,%s,%s,%s,%llu,%llu,%llu\n",
+		        r.width, r.height, r.numMips, r.numElements, BoolStr(f & TF_IS_ARRAY), r.numCubeFaces,
+		        BoolStr(f & TF_SRGB), BoolStr(f & TF_HAS_ALPHA), BoolStr(f & TF_PREMUL_ALPHA),
+		        BoolStr(f & TF_COMPRESSED), (unsigned long long)r.fileSize,
+		        (unsigned long long)r.faults.minor, (unsigned long long)r.faults.major);
+	}
+}
+
+int RunInfoMode(int argc, char** argv)
+{
+	bool csv = false;
+	bool decode = false;
+	int numThreads = 0;
+	const char* outPath = nullptr;
+	std::vector<std::string> files;
+	for(int i=0; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(strcmp(arg, "--json") == 0) {
+			csv = false;
+		} else if(strcmp(arg, "--csv") == 0) {
+			csv = true;
+		} else if(strcmp(arg, "--decode") == 0) {
+			decode = true;
+		} else if(strcmp(arg, "--io") == 0 && i+1 < argc) {
+			FileIOBackend backend;
+			if(!ParseFileIOBackend(argv[++i], backend)) {
+				errprintf("Unknown I/O backend '%s'\n", argv[i]);
+				PrintUsage();
+				return 1;
+			}
+			SetFileIOBackend(backend);
+		} else if(strcmp(arg, "--mmap-hints") == 0 && i+1 < argc) {
+			SetMemMapHints(ParseMemMapHints(argv[++i]));
+		} else if(strcmp(arg, "-j") == 0 && i+1 < argc) {
+			numThreads = atoi(argv[++i]);
+		} else if(strcmp(arg, "-o") == 0 && i+1 < argc) {
+			outPath = argv[++i];
+		} else if(strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+			PrintUsage();
+			return 0;
+		} else if(arg[0] == '-' && arg[1] != '\0') {
+			errprintf("Unknown option '%s'\n", arg);
+			PrintUsage();
+			return 1;
+		} else if( IsStdinPath(arg) || GetArchivedFileSizeAndModTime(arg, nullptr, nullptr)
+		          || (GetFileSizeAndModTime(arg, nullptr, nullptr) && !HasArchiveExtension(arg)) ) {
+			files.push_back(arg); // regular file, use it even if it has an unknown extension
+		} else {
+			std::string dir(arg);
+			while(dir.size() > 1 && (dir.back() == '/' || dir.back() == '\\')) {
+				dir.pop_back();
+			}
+			CollectFiles(dir, files);
+		}
+	}
+	if(argc == 0) {
+		PrintUsage();
+		return 1;
+	}
+
+	if(numThreads <= 0) {
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	numThreads = std::min(numThreads, std::max(1, (int)files.size()));
+
+	std::vector<InfoResult> results(files.size());
+	std::atomic<size_t> nextFile(0);
+	auto workerFun = [&]() {
+		while(true) {
+			size_t idx = nextFile++;
+			if(idx >= files.size()) {
+				break;
+			}
+			GetInfo(files[idx], decode, results[idx]);
+		}
+	};
+	std::vector<std::thread> threads;
+	for(int i=1; i < numThreads; ++i) {
+		threads.push_back(std::thread(workerFun));
+	}
+	workerFun(); // the main thread helps as well
+	for(std::thread& t : threads) {
+		t.join();
+	}
+
+	FILE* out = stdout;
+	if(outPath != nullptr) {
+		out = fopen(outPath, "w");
+		if(out == nullptr) {
+			errprintf("Couldn't open '%s' for writing!\n", outPath);
+			return 1;
+		}
+	}
+	if(csv) {
+		WriteCSV(out, files, results);
+	} else {
+		WriteJSON(out, files, results);
+	}
+	if(out != stdout) {
+		fclose(out);
+	}
+
+	int numFailed = 0;
+	for(const InfoResult& r : results) {
+		numFailed += r.ok ? 0 : 1;
+	}
+	return (numFailed == 0) ? 0 : 2;
+}
+
+} //namespace texview
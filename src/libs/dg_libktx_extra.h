@@ -31,7 +31,7 @@
 extern "C" {
 #endif
 
-static uint32_t ktxTexture_GetVkFormat(const ktxTexture* tex)
+static inline uint32_t ktxTexture_GetVkFormat(const ktxTexture* tex)
 {
 	assert(tex && "don't call this with NULL");
 	if(tex == NULL)
@@ -51,7 +51,7 @@ static uint32_t ktxTexture_GetVkFormat(const ktxTexture* tex)
 	return 0;
 }
 
-static GLint dg_glGetBaseInternalFormat(GLenum glInternalFormat)
+static inline GLint dg_glGetBaseInternalFormat(GLenum glInternalFormat)
 {
 	// NOTE: glGetFormatFromInternalFormat() returns GL_INVALID_VALUE if it's already a base format
 	//       (or is invalid.. in the end: if it's not in its table)
@@ -64,7 +64,7 @@ static GLint dg_glGetBaseInternalFormat(GLenum glInternalFormat)
 // set arguments you don't care about to NULL (except for tex, of course)
 // might set GL_INVALID_VALUE if no valid whatever was found
 // but glFormat and glType are set to 0 if it's a compressed format
-static bool ktxTexture_GetOpenGLFormat(const ktxTexture* tex, GLint* glInternalFormat, GLenum* glBaseInternalformat, GLenum* glFormat, GLenum* glType)
+static inline bool ktxTexture_GetOpenGLFormat(const ktxTexture* tex, GLint* glInternalFormat, GLenum* glBaseInternalformat, GLenum* glFormat, GLenum* glType)
 {
 	assert(tex && "don't call this with tex = NULL");
 	if(tex == NULL)
@@ -139,6 +139,10 @@ static inline bool ktxTexture_FormatHasAlpha(const ktxTexture* tex)
 // from ktx/lib/vkformat_str.c
 extern const char* vkFormatString(VkFormat format);
 
+// from ktx/lib/texture.c - true if the image data hasn't been read from
+// the texture's stream yet (only happens if it was created without KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT)
+extern ktx_bool_t ktxTexture_isActiveStream(ktxTexture* This);
+
 static inline bool ktxTexture_FormatIsSRGB(const ktxTexture* tex)
 {
 	VkFormat fmt = (VkFormat)ktxTexture_GetVkFormat(tex);
@@ -150,7 +154,7 @@ static inline bool ktxTexture_FormatIsSRGB(const ktxTexture* tex)
 	return false;
 }
 
-static const char* ktxTexture_GetFormatName(const ktxTexture* tex)
+static inline const char* ktxTexture_GetFormatName(const ktxTexture* tex)
 {
 	const char* ret = "<Unknown Format>";
 	if(tex->classId == ktxTexture1_c && tex->isCompressed) {
@@ -11,6 +11,7 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <glad/gl.h>
+#include "gl_extra.h"
 
 #include <ktx.h>
 
@@ -19,9 +20,13 @@
 #endif
 
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include <algorithm>
 #include <initializer_list>
+#include <unordered_map>
 
 #include "texview.h"
 #include "version.h"
@@ -36,11 +41,21 @@ static ImVec4 clear_color(0.45f, 0.55f, 0.60f, 1.00f);
 // TODO: should probably support more than one texture eventually..
 static texview::Texture curTex;
 
+static texview::AsyncLoader texLoader;
+
+// recently viewed (or prefetched) textures
+static texview::TextureCache texCache;
+
 static GLuint shaderProgram = 0;
 
 static bool showImGuiDemoWindow = false;
 static bool showAboutWindow = false;
 static bool showGLSLeditWindow = false;
+static bool showRawImportWindow = false;
+
+// for the raw import dialog (and set by the --raw-* commandline arguments)
+static char rawImportPath[1024] = {};
+static texview::RawImportParams rawImportParams;
 
 static float imGuiMenuWidth = 0.0f;
 static bool imguiMenuCollapsed = false;
@@ -123,29 +138,252 @@ static void ZoomFitToWindow(GLFWwindow* window, float tw, float th, bool isCube)
 	}
 }
 
+// All quads of a frame (mips, cube faces, ...) are drawn with a single instanced
+// draw call, each quad is one instance with the attributes from QuadInstance.
+// The 4 vertices of the quad (drawn as GL_TRIANGLE_FAN) don't need any attributes,
+// their corner is derived from gl_VertexID.
+// The mip level (or -1 for auto) is passed per quad as well, so the texture's
+// base/max level doesn't have to be changed for each quad (which can be slow)
 static const char* vertexShaderSrc = R"(
+in vec4 posSize;    // xy: position, zw: size
+in vec4 texParams;  // xy: max texcoord (min is 0), z: mip level or -1 for auto, w: array index
+in vec2 cubeParams; // x: cube face index or -1 if not a cube, y: rotation steps
+uniform vec4 viewTransform; // xy: scale, zw: offset (to normalized device coordinates)
 out vec4 texCoord;
-// TODO: a way to pass cube face num or array slice num? or is texCoord.z(?) stable enough?
+flat out float lod;
+
+const vec2 corners[4] = vec2[4]( vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0) );
+
 void main()
 {
-	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
-	texCoord = gl_MultiTexCoord0;
+	vec2 corner = corners[gl_VertexID];
+	vec2 pos = posSize.xy + corner * posSize.zw;
+	gl_Position = vec4(pos * viewTransform.xy + viewTransform.zw, 0.0, 1.0);
+	lod = texParams.z;
+	if(cubeParams.x < 0.0) {
+		texCoord = vec4(corner * texParams.xy, texParams.w, 0.0);
+	} else {
+		// helpful: https://stackoverflow.com/questions/38543155/opengl-render-face-of-cube-map-to-a-quad
+		// rotating the face (for the top and bottom faces of the cross) means using the coordinate
+		// of another corner, then scale from [0, 1] to [-1, 1]
+		int cornerIdx = (gl_VertexID + int(cubeParams.y)) % 4;
+		vec2 mc = corners[cornerIdx] * texParams.xy * 2.0 - 1.0;
+		vec3 dir;
+		int face = int(cubeParams.x);
+		if(face == 0)      dir = vec3(  1.0, -mc.y, -mc.x ); // X+
+		else if(face == 1) dir = vec3( -1.0, -mc.y,  mc.x ); // X-
+		else if(face == 2) dir = vec3( mc.x,   1.0,  mc.y ); // Y+
+		else if(face == 3) dir = vec3( mc.x,  -1.0, -mc.y ); // Y-
+		else if(face == 4) dir = vec3( mc.x, -mc.y,   1.0 ); // Z+
+		else               dir = vec3(-mc.x, -mc.y,  -1.0 ); // Z-
+		texCoord = vec4(dir, texParams.w);
+	}
 }
 )";
 
-// Note: before this something like "uniform sampler2D tex0;" is needed,
-//       setting that in UpdateShaders() based on type
-static const char* fragShaderStart = R"(
+// per-quad (instance) data for the vertex shader above
+struct QuadInstance {
+	float posSize[4];
+	float texParams[4];
+	float cubeParams[2];
+};
+
+// attribute locations, set with glBindAttribLocation() in CreateShaderProgram()
+enum { ATTR_POS_SIZE = 0, ATTR_TEX_PARAMS = 1, ATTR_CUBE_PARAMS = 2 };
+
+static GLuint quadVAO = 0;
+static GLuint quadInstanceVBO = 0;
+static GLint viewTransformLoc = -1;
+static GLint decodeLinearLoc = -1;
+static GLint decodeMaxLevelLoc = -1;
+static GLint decodeSize0Loc = -1;
+static float viewTransform[4] = { 1.0f, 1.0f, 0.0f, 0.0f }; // set in GenericFrame()
+static std::vector<QuadInstance> quadInstances;
+
+static const char* fragShaderInputs = R"(
 in vec4 texCoord;
+flat in float lod;
 out vec4 OutColor;
+uniform mat4 swizzleMat; // for the simple swizzle, see GetSimpleSwizzleUniforms()
+uniform vec4 swizzleAdd;
+uniform vec4 intNormDiv; // to normalize integer textures
+)";
+
+// Note: before this something like "uniform sampler2D tex0;" and a SampleTex0()
+//       function are needed, setting those in UpdateShaders() based on type
+static const char* fragShaderStart = R"(
 void main()
 {
 )";
 
-// ... here UpdateShaders() adds a line like "	vec4 c = texture(tex0, texCoord.st);\n"
+// ... here UpdateShaders() adds a line like "	vec4 c = SampleTex0();\n"
 // ... at this point swizzling could happen ("	c = c.agbr;") - generate that dynamically
 
 // Note: only indenting with single space so it looks better in the advanced swizzle editor
+// used instead of the (advanced) swizzle code if useSimpleSwizzle is set,
+// so changing the simple swizzle doesn't need a new shader
+static const char* simpleSwizzleSrc = " c = swizzleMat * c + swizzleAdd;\n";
+
+// SampleTex0() for textures that are decoded in the shader (Texture::IsDecodedInShader()),
+// like paletted (TF_INDEXED) textures or the packed DDS formats (texview::PackedFormat).
+// One of the DecodeTexel() functions below must come before this; it returns the color
+// of the pixel at p. Interpolating indices or packed texels makes no sense, so for linear
+// filtering the colors of the 4 nearest pixels are blended here.
+// The mip level is chosen like GL_*_MIPMAP_NEAREST would
+static const char* decodeSampleSrc = R"(
+uniform int decodeLinear;
+uniform int decodeMaxLevel; // relative to the base level, like lod
+uniform ivec2 decodeSize0; // size of the base level in pixels (not in texels of tex0!)
+
+vec4 DecodeWrapped(vec2 pos, ivec2 size, int level)
+{
+ ivec2 p = ivec2(mod(pos, vec2(size))); // like GL_REPEAT
+ return DecodeTexel(p, level);
+}
+
+vec4 SampleTex0()
+{
+ vec2 dx = dFdx( texCoord.st );
+ vec2 dy = dFdy( texCoord.st );
+ float l = lod;
+ if(l < 0.0) {
+  vec2 size0 = vec2(decodeSize0);
+  vec2 dxT = dx * size0;
+  vec2 dyT = dy * size0;
+  l = 0.5 * log2(max(dot(dxT, dxT), dot(dyT, dyT)));
+ }
+ int level = clamp(int(floor(l + 0.5)), 0, decodeMaxLevel);
+ ivec2 size = max(decodeSize0 >> level, ivec2(1));
+ vec2 pos = texCoord.st * vec2(size);
+ if(decodeLinear == 0)
+  return DecodeWrapped(floor(pos), size, level);
+ pos -= 0.5;
+ vec2 p = floor(pos);
+ vec2 f = pos - p;
+ vec4 c00 = DecodeWrapped(p, size, level);
+ vec4 c10 = DecodeWrapped(p + vec2(1.0, 0.0), size, level);
+ vec4 c01 = DecodeWrapped(p + vec2(0.0, 1.0), size, level);
+ vec4 c11 = DecodeWrapped(p + vec2(1.0, 1.0), size, level);
+ return mix(mix(c00, c10, f.x), mix(c01, c11, f.x), f.y);
+}
+)";
+
+// paletted textures: tex0 only contains the indices, the colors are
+// looked up in the palette texture (256x1)
+static const char* paletteDecodeSrc = R"(
+uniform sampler2D palette;
+
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ float idx = FetchTex0(p, level).r;
+ return texelFetch(palette, ivec2(int(idx * 255.0 + 0.5), 0), 0);
+}
+)";
+
+// the pixel pair formats are uploaded as GL_RGBA8UI with one texel for two pixels
+static const char* rgbgDecodeSrc = R"(
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ uvec4 t = FetchTex0(ivec2(p.x >> 1, p.y), level); // R G0 B G1
+ return vec4(t.r, ((p.x & 1) != 0) ? t.a : t.g, t.b, 255.0) / 255.0;
+}
+)";
+
+static const char* grgbDecodeSrc = R"(
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ uvec4 t = FetchTex0(ivec2(p.x >> 1, p.y), level); // G0 R G1 B
+ return vec4(t.g, ((p.x & 1) != 0) ? t.b : t.r, t.a, 255.0) / 255.0;
+}
+)";
+
+// BT.601 with limited ("TV") range, that's what D3D used for YUY2 and UYVY
+static const char* yuvToRGBsrc = R"(
+vec4 YUVtoRGB(uint yi, uint ui, uint vi)
+{
+ float y = 1.164 * (float(yi) - 16.0);
+ float u = float(ui) - 128.0;
+ float v = float(vi) - 128.0;
+ vec3 rgb = vec3(y + 1.596*v, y - 0.391*u - 0.813*v, y + 2.018*u) / 255.0;
+ return vec4(clamp(rgb, 0.0, 1.0), 1.0);
+}
+)";
+
+static const char* yuy2DecodeSrc = R"(
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ uvec4 t = FetchTex0(ivec2(p.x >> 1, p.y), level); // Y0 U Y1 V
+ return YUVtoRGB(((p.x & 1) != 0) ? t.b : t.r, t.g, t.a);
+}
+)";
+
+static const char* uyvyDecodeSrc = R"(
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ uvec4 t = FetchTex0(ivec2(p.x >> 1, p.y), level); // U Y0 V Y1
+ return YUVtoRGB(((p.x & 1) != 0) ? t.a : t.g, t.r, t.b);
+}
+)";
+
+static const char* a8r3g3b2DecodeSrc = R"(
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ uint v = FetchTex0(p, level).r;
+ return vec4(float((v >> 5) & 7u) / 7.0, float((v >> 2) & 7u) / 7.0, float(v & 3u) / 3.0, float(v >> 8) / 255.0);
+}
+)";
+
+static const char* a4l4DecodeSrc = R"(
+vec4 DecodeTexel(ivec2 p, int level)
+{
+ uint v = FetchTex0(p, level).r;
+ float l = float(v & 15u) / 15.0;
+ return vec4(l, l, l, float(v >> 4) / 15.0);
+}
+)";
+
+// returns DecodeTexel() and SampleTex0() for textures that are decoded in the shader, else ""
+static std::string GetDecodeSrc(const texview::Texture& texture)
+{
+	std::string ret;
+	if(texture.textureFlags & texview::TF_INDEXED) {
+		ret = paletteDecodeSrc;
+	} else {
+		switch(texture.packedFormat) {
+			case texview::PF_NONE:
+				return ret;
+			case texview::PF_R8G8_B8G8:
+				ret = rgbgDecodeSrc;
+				break;
+			case texview::PF_G8R8_G8B8:
+				ret = grgbDecodeSrc;
+				break;
+			case texview::PF_YUY2:
+				ret = yuvToRGBsrc;
+				ret += yuy2DecodeSrc;
+				break;
+			case texview::PF_UYVY:
+				ret = yuvToRGBsrc;
+				ret += uyvyDecodeSrc;
+				break;
+			case texview::PF_A8R3G3B2:
+				ret = a8r3g3b2DecodeSrc;
+				break;
+			case texview::PF_A4L4:
+				ret = a4l4DecodeSrc;
+				break;
+		}
+	}
+	// texelFetch() wants the layer as part of the coordinate for array textures
+	if(texture.IsArray()) {
+		ret.insert(0, "\n#define FetchTex0(pos, lvl) texelFetch(tex0, ivec3((pos), int(texCoord.p)), (lvl))\n");
+	} else {
+		ret.insert(0, "\n#define FetchTex0(pos, lvl) texelFetch(tex0, (pos), (lvl))\n");
+	}
+	ret += decodeSampleSrc;
+	return ret;
+}
+
 static const char* fragShaderEnd =  R"(
  OutColor = c;
 }
@@ -221,7 +459,14 @@ CreateShaderProgram(const GLuint shaders[2])
 	glAttachShader(prog, shaders[0]);
 	glAttachShader(prog, shaders[1]);
 
-	// TODO: glBindAttribLocation() goes here, if needed
+	glBindAttribLocation(prog, ATTR_POS_SIZE, "posSize");
+	glBindAttribLocation(prog, ATTR_TEX_PARAMS, "texParams");
+	glBindAttribLocation(prog, ATTR_CUBE_PARAMS, "cubeParams");
+
+	if(TV_GL_ARB_get_program_binary) {
+		// so it can be saved in the disk cache, see SaveProgramBinary()
+		glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 
 	glLinkProgram(prog);
 
@@ -305,15 +550,234 @@ static void SetSwizzleFromSimple()
 	AppendFormatted(swizzle, "c = vec4(%s, %s, %s, %s);\n", args[0], args[1], args[2], args[3]);
 }
 
-static bool UpdateShaders()
+// if enabled, frames are only rendered when something happened (input, loading
+// or uploading progress, ...), otherwise the main loop just waits for events
+static bool redrawOnDemand = true;
+// keep redrawing until this time (from glfwGetTime()), see RequestRedraw()
+static double redrawUntil = 0.0;
+// number of frames rendered so far, shown in the sidebar
+static unsigned int frameCounter = 0;
+
+// ImGui needs a few frames to react to input, and things like tooltips only show up
+// after a delay, so after any event rendering continues for a bit
+static void RequestRedraw(double forSeconds = 0.6)
+{
+	redrawUntil = std::max(redrawUntil, glfwGetTime() + forSeconds);
+}
+
+// compiled shader programs by their (complete) source code, so going back to a texture
+// type that was used before or changing the simple swizzle doesn't need any compiling
+static std::unordered_map<std::string, GLuint> shaderProgramCache;
+// how often shaders were compiled and how often a program could be loaded from
+// a program binary from the disk cache instead
+static int numShaderCompiles = 0;
+static int numProgramBinaryLoads = 0;
+
+// FNV-1a
+static uint64_t HashString(const std::string& str, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	for(unsigned char c : str) {
+		hash ^= c;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+struct ProgramBinaryHeader {
+	char magic[4]; // "TVPB"
+	uint32_t version;
+	uint32_t binaryFormat;
+	uint32_t binaryLength;
+	uint64_t sourceLength; // just another sanity check
+};
+
+// the program binary is specific to the GPU and driver (version),
+// so those are part of the hash that's used as the filename
+static std::string GetProgramBinaryPath(const std::string& source)
+{
+	// they're part of the disk cache (and count against its budget), so if that's disabled, so are they
+	if(!TV_GL_ARB_get_program_binary || texview::GetDiskCacheBudget() == 0) {
+		return std::string();
+	}
+	std::string cacheDir = texview::GetCacheDir();
+	if(cacheDir.empty()) {
+		return cacheDir;
+	}
+	uint64_t hash = HashString(source);
+	for(GLenum e : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const char* str = (const char*)glGetString(e);
+		hash = HashString(str != nullptr ? str : "", hash);
+	}
+	char fileName[40];
+	snprintf(fileName, sizeof(fileName), "/shader_%016llx.bin", (unsigned long long)hash);
+	return cacheDir + fileName;
+}
+
+static GLuint LoadProgramBinary(const std::string& path, const std::string& source)
+{
+	uint64_t size = 0;
+	if(!texview::GetFileSizeAndModTime(path.c_str(), &size, nullptr) || size < sizeof(ProgramBinaryHeader)) {
+		return 0;
+	}
+	texview::MemMappedFile* mmf = texview::LoadMemMappedFile(path.c_str());
+	if(mmf == nullptr) {
+		return 0;
+	}
+	GLuint prog = 0;
+	ProgramBinaryHeader header;
+	memcpy(&header, mmf->data, sizeof(header));
+	if(memcmp(header.magic, "TVPB", 4) == 0 && header.version == 1
+	   && header.sourceLength == source.length()
+	   && header.binaryLength == mmf->length - sizeof(header))
+	{
+		prog = glCreateProgram();
+		glProgramBinary(prog, header.binaryFormat, (const char*)mmf->data + sizeof(header), header.binaryLength);
+		GLint status = GL_FALSE;
+		glGetProgramiv(prog, GL_LINK_STATUS, &status);
+		if(status != GL_TRUE) {
+			// can happen if the driver was updated, it's just compiled again then
+			glDeleteProgram(prog);
+			prog = 0;
+		}
+	}
+	texview::UnloadMemMappedFile(mmf);
+	if(prog != 0) {
+		// for the LRU eviction in TrimDiskCache()
+		texview::TouchFile(path.c_str());
+	}
+	return prog;
+}
+
+static void SaveProgramBinary(GLuint prog, const std::string& path, const std::string& source)
 {
-	const char* glslVersion = "#version 150 compatibility\n";
+	GLint length = 0;
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) {
+		return;
+	}
+	std::vector<unsigned char> buf(sizeof(ProgramBinaryHeader) + length);
+	ProgramBinaryHeader header = {};
+	memcpy(header.magic, "TVPB", 4);
+	header.version = 1;
+	header.sourceLength = source.length();
+	GLenum binaryFormat = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(prog, length, &written, &binaryFormat, buf.data() + sizeof(header));
+	if(written <= 0) {
+		return;
+	}
+	header.binaryFormat = binaryFormat;
+	header.binaryLength = written;
+	memcpy(buf.data(), &header, sizeof(header));
+	if(texview::WriteWholeFile(path.c_str(), buf.data(), sizeof(header) + written)) {
+		texview::TrimDiskCache();
+	}
+}
+
+// returns the program for the given shader sources from the cache, or loads it
+// from the program binary disk cache, or compiles it. returns 0 on error
+static GLuint GetShaderProgram(const std::string& vertSrc, const std::string& fragSrc)
+{
+	std::string key = vertSrc;
+	key += '\0';
+	key += fragSrc;
+	auto it = shaderProgramCache.find(key);
+	if(it != shaderProgramCache.end()) {
+		return it->second;
+	}
+
+	std::string binaryPath = GetProgramBinaryPath(key);
+	if(!binaryPath.empty()) {
+		GLuint prog = LoadProgramBinary(binaryPath, key);
+		if(prog != 0) {
+			++numProgramBinaryLoads;
+			shaderProgramCache[key] = prog;
+			return prog;
+		}
+	}
 
 	GLuint shaders[2] = {};
-	shaders[0] = CompileShader(GL_VERTEX_SHADER, { glslVersion, vertexShaderSrc });
+	shaders[0] = CompileShader(GL_VERTEX_SHADER, { vertSrc.c_str() });
 	if(shaders[0] == 0) {
-		return false;
+		return 0;
 	}
+	shaders[1] = CompileShader(GL_FRAGMENT_SHADER, { fragSrc.c_str() });
+	if(shaders[1] == 0) {
+		glDeleteShader(shaders[0]);
+		return 0;
+	}
+	++numShaderCompiles;
+
+	GLuint prog = CreateShaderProgram(shaders);
+
+	// The shaders aren't needed anymore once they're linked into the program
+	glDeleteShader(shaders[0]);
+	glDeleteShader(shaders[1]);
+	if(prog == 0) {
+		return 0;
+	}
+	if(!binaryPath.empty()) {
+		SaveProgramBinary(prog, binaryPath, key);
+	}
+	shaderProgramCache[key] = prog;
+	return prog;
+}
+
+static void ClearShaderProgramCache()
+{
+	for(auto& it : shaderProgramCache) {
+		glDeleteProgram(it.second);
+	}
+	shaderProgramCache.clear();
+	shaderProgram = 0;
+}
+
+// the simple swizzle isn't compiled into the shader, but set as uniforms:
+// a matrix that selects the input channel for each output channel
+// and a vector that's added (for the constant 0 and 1)
+static void GetSimpleSwizzleUniforms(float mat[16], float add[4])
+{
+	memset(mat, 0, 16 * sizeof(float));
+	add[0] = add[1] = add[2] = 0.0f;
+	add[3] = 1.0f;
+	for(int i=0; i<4; ++i) {
+		char c = simpleSwizzle[i];
+		if(c >= 'A' && c <= 'Z') {
+			c += 32; // to lowercase
+		}
+		int channel = -1;
+		switch(c) {
+			case '0': add[i] = 0.0f; break;
+			case '1': add[i] = 1.0f; break;
+			case 'r': case 'x': channel = 0; break;
+			case 'g': case 'y': channel = 1; break;
+			case 'b': case 'z': channel = 2; break;
+			case 'a': case 'w': channel = 3; break;
+		}
+		if(c == '\0') {
+			break; // leave this and following at default value (like SetSwizzleFromSimple())
+		}
+		if(channel >= 0) {
+			// matrix is column-major, column = input channel, row = output channel
+			mat[channel * 4 + i] = 1.0f;
+			add[i] = 0.0f;
+		}
+	}
+}
+
+// normDiv from Texture::GetIntTexInfo() is GLSL code, either a float or a vec4(...)
+static void ParseNormDivisor(const char* normDiv, float div[4])
+{
+	if(sscanf(normDiv, "vec4(%f, %f, %f, %f)", &div[0], &div[1], &div[2], &div[3]) == 4) {
+		return;
+	}
+	div[0] = div[1] = div[2] = div[3] = strtof(normDiv, nullptr);
+}
+
+static bool UpdateShaders()
+{
+	// the shaders don't use any fixed-function stuff anymore, so they'd also work with a core profile
+	const char* glslVersion = "#version 150\n";
 
 	bool isUnsigned = false;
 	const char* normDiv = curTex.GetIntTexInfo(isUnsigned); // divisor to normalize integer texture
@@ -339,6 +803,8 @@ static bool UpdateShaders()
 			glslVersion = glslAdvVersion.c_str();
 		}
 	}
+	// cubemaps use 3D gradients, 2D textures 2D gradients, no matter if it's an array or not
+	int numGradCoords = numTexCoords;
 	if(curTex.IsArray()) {
 		typePostfix = "Array";
 		numTexCoords++;
@@ -347,116 +813,367 @@ static bool UpdateShaders()
 	char samplerUniform[48] = {};
 	snprintf(samplerUniform, sizeof(samplerUniform), "uniform %s%s%s tex0;\n", typePrefix, samplerBaseType, typePostfix);
 
+	// lod < 0 means auto, then the GPU chooses the mip level based on the gradients.
+	// they're calculated outside the if, because the implicit derivatives are
+	// undefined in non-uniform control flow
+	std::string sampleFunc;
+	AppendFormatted(sampleFunc, "%svec4 SampleTex0()\n{\n", typePrefix);
+	AppendFormatted(sampleFunc, " vec%d dx = dFdx( texCoord.%.*s );\n", numGradCoords, numGradCoords, "stpq");
+	AppendFormatted(sampleFunc, " vec%d dy = dFdy( texCoord.%.*s );\n", numGradCoords, numGradCoords, "stpq");
+	AppendFormatted(sampleFunc, " if(lod < 0.0)\n  return textureGrad( tex0, texCoord.%.*s, dx, dy );\n",
+	                numTexCoords, "stpq");
+	AppendFormatted(sampleFunc, " return textureLod( tex0, texCoord.%.*s, lod );\n}\n",
+	                numTexCoords, "stpq");
+	bool decodeInShader = curTex.IsDecodedInShader(); // (never for cubemaps)
+	if(decodeInShader) {
+		sampleFunc = GetDecodeSrc(curTex);
+	}
+
 	texSampleAndNormalize.clear();
 
-	if(isIntTexture) {
-		AppendFormatted(texSampleAndNormalize,
-		                " %svec4 v = texture( tex0, texCoord.%.*s );\n",
-		                typePrefix, numTexCoords, "stpq");
+	float normDivisor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	if(isIntTexture && !decodeInShader) {
+		AppendFormatted(texSampleAndNormalize, " %svec4 v = SampleTex0();\n", typePrefix);
 		// integer textures (GL_RGB_INTEGER etc) need normalization to display something useful
-		AppendFormatted(texSampleAndNormalize, " vec4 c = vec4(v) / %s;\n", normDiv);
+		// the divisor is a uniform so all integer textures of the same sampler type can share a program
+		texSampleAndNormalize += " vec4 c = vec4(v) / intNormDiv;\n";
+		ParseNormDivisor(normDiv, normDivisor);
 	} else {
 		// normal textures don't need normalization, so assign to vec4 c directly
-		AppendFormatted(texSampleAndNormalize, " vec4 c = texture( tex0, texCoord.%.*s );\n",
-		                numTexCoords, "stpq");
+		texSampleAndNormalize += " vec4 c = SampleTex0();\n";
 	}
 
 	if(useSimpleSwizzle) {
+		// still needed for the advanced swizzle editor
 		SetSwizzleFromSimple();
 	}
 
-	std::initializer_list<const char*> fragShaderSrc = {
-		glslVersion,
-		samplerUniform,
-		fragShaderStart,
-		texSampleAndNormalize.c_str(),
-		swizzle.c_str(),
-		fragShaderEnd
-	};
-	shaders[1] = CompileShader(GL_FRAGMENT_SHADER, fragShaderSrc );
-	if(shaders[1] == 0) {
-		glDeleteShader(shaders[0]);
-		return false;
-	}
+	std::string vertSrc = "#version 150\n";
+	vertSrc += vertexShaderSrc;
 
-	GLuint prog = CreateShaderProgram(shaders);
+	std::string fragSrc = glslVersion;
+	fragSrc += samplerUniform;
+	fragSrc += fragShaderInputs;
+	fragSrc += sampleFunc;
+	fragSrc += fragShaderStart;
+	fragSrc += texSampleAndNormalize;
+	fragSrc += useSimpleSwizzle ? simpleSwizzleSrc : swizzle.c_str();
+	fragSrc += fragShaderEnd;
 
-	// The shaders aren't needed anymore once they're linked into the program
-	glDeleteShader(shaders[0]);
-	glDeleteShader(shaders[1]);
+	GLuint prog = GetShaderProgram(vertSrc, fragSrc);
 	if(prog == 0) {
 		return false;
 	}
 
-	if(shaderProgram != 0) { // if we already had one and want to replace it
-		glDeleteProgram(shaderProgram);
-	}
-
 	shaderProgram = prog;
 
 	glUseProgram(shaderProgram);
-	// TODO: could set uniforms here
+	viewTransformLoc = glGetUniformLocation(shaderProgram, "viewTransform");
+	decodeLinearLoc = glGetUniformLocation(shaderProgram, "decodeLinear");
+	decodeMaxLevelLoc = glGetUniformLocation(shaderProgram, "decodeMaxLevel");
+	decodeSize0Loc = glGetUniformLocation(shaderProgram, "decodeSize0");
+	glUniform1i(glGetUniformLocation(shaderProgram, "palette"), 1); // texture unit 1, see DrawQuads()
+
+	float swizzleMat[16], swizzleAdd[4];
+	GetSimpleSwizzleUniforms(swizzleMat, swizzleAdd);
+	// (uniforms that aren't used by the current program have location -1, setting those does nothing)
+	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "swizzleMat"), 1, GL_FALSE, swizzleMat);
+	glUniform4fv(glGetUniformLocation(shaderProgram, "swizzleAdd"), 1, swizzleAdd);
+	glUniform4fv(glGetUniformLocation(shaderProgram, "intNormDiv"), 1, normDivisor);
 
 	return true;
 }
 
-// mipLevel -1 = auto (let GPU choose from all levels)
-// otherwise use the given level (if it exists..)
-static void SetMipmapLevel(texview::Texture& texture, GLint mipLevel, bool bindTexture = true)
+// returns the first mip level that can be used (at the moment)
+static GLint GetBaseMipLevel(const texview::Texture& texture)
 {
-	GLuint tex = texture.glTextureHandle;
+	// while the texture is still being uploaded, only the smaller mips can be used
 	GLint numMips = texture.GetNumMips();
-	if(tex == 0 || numMips == 1) {
+	return std::max(0, std::min(texture.GetFirstCompleteMip(), numMips - 1));
+}
+
+// only the range of mip levels that are uploaded is set here, the mip level
+// that's actually shown is chosen in the shader (with textureLod()), so this only
+// needs to be called when a texture is loaded or more of it has been uploaded
+static void UpdateMipmapRange(texview::Texture& texture)
+{
+	GLint numMips = texture.GetNumMips();
+	if(texture.glTextureHandle == 0 || numMips == 1) {
 		return;
 	}
-	if(bindTexture) {
-		glBindTexture(texture.glTarget, tex);
+	// (if the texture supports DSA, this doesn't even need to bind it)
+	texture.SetParameter(GL_TEXTURE_BASE_LEVEL, GetBaseMipLevel(texture));
+	texture.SetParameter(GL_TEXTURE_MAX_LEVEL, numMips - 1);
+}
+
+static void UpdateTextureFilter()
+{
+	if(curTex.glTextureHandle == 0) {
+		return;
 	}
+	// paletted and packed textures are filtered in the shader (after decoding)
+	bool linear = linearFilter && !curTex.IsDecodedInShader();
+	GLint filter = linear ? GL_LINEAR : GL_NEAREST;
+	if(curTex.GetNumMips() == 1) {
+		curTex.SetParameter(GL_TEXTURE_MIN_FILTER, filter);
+		curTex.SetParameter(GL_TEXTURE_MAG_FILTER, filter);
+	} else {
+		GLint mipFilter = linear ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+		curTex.SetParameter(GL_TEXTURE_MIN_FILTER, mipFilter);
+		curTex.SetParameter(GL_TEXTURE_MAG_FILTER, filter);
+	}
+}
 
-	mipLevel = std::min(mipLevel, numMips - 1);
-	// setting both to the same level enforces using that level
-	GLint baseLevel = mipLevel;
-	GLint maxLevel  = mipLevel;
-	if(mipLevel < 0) { // auto mode
-		baseLevel = 0;
-		maxLevel = numMips - 1;
+// returns the position of the last '/' (or '\\' on Windows) in path, or std::string::npos
+static size_t FindLastPathSeparator(const std::string& path)
+{
+	size_t lastSlash = path.find_last_of('/');
+#ifdef _WIN32
+	size_t lastBS = path.find_last_of('\\');
+	if( (lastBS != std::string::npos && lastBS > lastSlash)
+	   || lastSlash == std::string::npos )
+	{
+		lastSlash = lastBS;
 	}
-	glTexParameteri(texture.glTarget, GL_TEXTURE_BASE_LEVEL, baseLevel);
-	glTexParameteri(texture.glTarget, GL_TEXTURE_MAX_LEVEL, maxLevel);
+#endif
+	return lastSlash;
+}
+
+// sets prevPath and nextPath to the (loadable) files before and after path in its directory
+// (wrapping around at the end/beginning). returns false if there are no such files
+static bool GetNeighborFiles(const std::string& path, std::string& prevPath, std::string& nextPath)
+{
+	size_t lastSlash = FindLastPathSeparator(path);
+	if(lastSlash == std::string::npos) {
+		return false;
+	}
+	std::string dir = path.substr(0, lastSlash);
+	std::string fileName = path.substr(lastSlash + 1);
+	std::vector<std::string> files;
+	// (if path is in an archive, dir is the directory in the archive)
+	if(!texview::ListArchiveDirectory(dir.c_str(), files)
+	   && !texview::ListDirectory(dir.empty() ? "/" : dir.c_str(), files)) {
+		return false;
+	}
+	files.erase(std::remove_if(files.begin(), files.end(),
+	                           [](const std::string& f) { return !texview::HasSupportedFileExtension(f.c_str()); }),
+	            files.end());
+	if(files.empty()) {
+		return false;
+	}
+	std::sort(files.begin(), files.end());
+
+	// if path itself isn't in the list (anymore), its neighbors are still
+	// the files that would've been before and after it
+	auto it = std::lower_bound(files.begin(), files.end(), fileName);
+	size_t idx = it - files.begin();
+	size_t numFiles = files.size();
+	size_t nextIdx = idx;
+	if(it != files.end() && *it == fileName) {
+		nextIdx = idx + 1;
+	}
+	size_t prevIdx = (idx == 0) ? numFiles - 1 : idx - 1;
+	nextIdx = nextIdx % numFiles;
+
+	prevPath = dir + path[lastSlash] + files[prevIdx];
+	nextPath = dir + path[lastSlash] + files[nextIdx];
+	return true;
 }
 
-static void UpdateTextureFilter(bool bindTex = true)
+// the files next to the current one will probably be looked at next, so prefetch them
+static void PrefetchNeighbors()
 {
-	GLuint glTex = curTex.glTextureHandle;
-	GLenum target = curTex.glTarget;
-	if(glTex == 0) {
+	std::string prevPath, nextPath;
+	if(!GetNeighborFiles(curTex.name, prevPath, nextPath)) {
 		return;
 	}
-	if(bindTex) {
-		glBindTexture(target, glTex);
+	for(const std::string* p : { &nextPath, &prevPath }) {
+		if(*p != curTex.name && !texCache.Contains(*p) && !texLoader.IsLoading(p->c_str())) {
+			texLoader.Prefetch(p->c_str());
+		}
 	}
-	GLint filter = linearFilter ? GL_LINEAR : GL_NEAREST;
-	if(curTex.GetNumMips() == 1) {
-		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
-		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+}
+
+static void TextureLoaded(texview::Texture& newTex, const char* path);
+
+// uploading a big texture can take many frames, so it's done incrementally with
+// this time budget (in seconds) per frame, smallest mip levels first
+static double uploadTimeBudget = 0.004;
+
+// if available, texture data is uploaded through a persistently mapped
+// PBO ring buffer (that's filled by worker threads)
+static texview::UploadRing uploadRing;
+static bool useUploadRing = true;
+
+// use glTexStorage*() (and DSA) if supported
+static bool useImmutableStorage = true;
+
+static texview::UploadRing* GetUploadRing()
+{
+	if(useUploadRing && !uploadRing.IsAvailable() && TV_GL_ARB_buffer_storage) {
+		// only created when it's actually used, the upload thread has its own
+		if(!uploadRing.Init(64 * 1024 * 1024)) {
+			useUploadRing = false;
+		}
+	}
+	return (useUploadRing && uploadRing.IsAvailable()) ? &uploadRing : nullptr;
+}
+
+// if the upload thread is running (see main()), textures are uploaded there,
+// through a second OpenGL context that shares its objects with the main one.
+// The texture is shown once it's completely uploaded (and the GPU is done with it)
+static texview::UploadThread uploadThread;
+static bool useUploadThread = true;
+
+// if set, the CPU side copy of the texture data (the mmap or the decoded pixels)
+// is freed once the texture has been completely uploaded to the GPU.
+// It's loaded again when it's needed for another upload
+static bool dropCPUDataAfterUpload = false;
+
+// the (absolute) path of the texture that should be shown next,
+// textures finished by the upload thread that aren't this one go to the cache
+static std::string wantedTexPath;
+
+// if set, the file of curTex is watched and it's reloaded when it changes.
+// if only some mip levels (or array elements etc) have changed, only those are uploaded
+static texview::FileWatcher fileWatcher;
+static bool autoReload = true;
+// the path of curTex while it's being reloaded because its file has changed
+static std::string reloadingTexPath;
+
+// newTex must have been loaded from path; shows it right away if it's already
+// uploaded (from the cache) or passes it to the upload thread
+static void ShowTexture(texview::Texture& newTex, const char* path)
+{
+	if(newTex.glTextureHandle == 0 && useUploadThread && uploadThread.IsRunning()) {
+		uploadThread.Submit(newTex, useImmutableStorage, useUploadRing);
 	} else {
-		GLint mipFilter = linearFilter ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
-		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, mipFilter);
-		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+		TextureLoaded(newTex, path);
 	}
 }
 
+// called each frame to upload the next part of curTex, if anything is left
+static void ContinueTextureUpload()
+{
+	if(!curTex.IsUploadPending()) {
+		if(dropCPUDataAfterUpload && curTex.HasCPUData()) {
+			curTex.ReleaseCPUData(); // does nothing if it's not on the GPU yet
+		}
+		return;
+	}
+	int prevCompleteMip = curTex.GetFirstCompleteMip();
+	curTex.ContinueOpenGLupload(uploadTimeBudget, GetUploadRing());
+	if(curTex.GetFirstCompleteMip() != prevCompleteMip) {
+		// a bigger mip level can be shown now
+		UpdateMipmapRange(curTex);
+	}
+}
+
+// sets texPath to the first (in alphabetical order) loadable file in the archive
+// (or directory in an archive) at path, searching subdirectories depth-first
+static bool FindFirstTextureInArchive(const std::string& path, std::string& texPath)
+{
+	std::vector<std::string> files;
+	std::vector<std::string> dirs;
+	if(!texview::ListArchiveDirectory(path.c_str(), files, &dirs)) {
+		return false;
+	}
+	std::sort(files.begin(), files.end());
+	for(const std::string& f : files) {
+		if(texview::HasSupportedFileExtension(f.c_str())) {
+			texPath = path + '/' + f;
+			return true;
+		}
+	}
+	std::sort(dirs.begin(), dirs.end());
+	for(const std::string& d : dirs) {
+		if(FindFirstTextureInArchive(path + '/' + d, texPath)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// loading happens in the background, TextureLoaded() is called once it's done
+// (unless the texture is still in the cache, then it's used right away)
 static void LoadTexture(const char* path)
 {
+	std::string absPath = texview::IsStdinPath(path) ? std::string(path) : texview::ToAbsolutePath(path);
+	std::string archivePath, innerPath;
+	if(texview::SplitArchivePath(absPath.c_str(), archivePath, innerPath)
+	   && (innerPath.empty() || !texview::HasSupportedFileExtension(innerPath.c_str())))
 	{
-		texview::Texture newTex;
-		if(!newTex.Load(path)) {
-			errprintf("Couldn't load texture '%s'!\n", path);
+		// an archive (or a directory in one) was opened => show the first texture in it,
+		// the others can be reached with LoadNeighborTexture()
+		std::string texPath;
+		if(!FindFirstTextureInArchive(absPath, texPath)) {
+			errprintf("Found no loadable textures in '%s'\n", absPath.c_str());
 			return;
 		}
+		absPath = texPath;
+	}
+	wantedTexPath = absPath;
+	reloadingTexPath.clear();
+	texview::Texture cachedTex;
+	if(texCache.Take(absPath, cachedTex)) {
+		texLoader.CancelAll();
+		ShowTexture(cachedTex, absPath.c_str());
+		return;
+	}
+	texLoader.StartLoad(absPath.c_str());
+}
+
+// load the next (or previous) file in the directory of the current texture
+static void LoadNeighborTexture(bool next)
+{
+	std::string curPath = curTex.name;
+	std::string loadPath;
+	const char* loadStage = nullptr;
+	float loadProgress = 0.0f;
+	if(texLoader.GetCurrentLoad(loadPath, loadStage, loadProgress)) {
+		// when quickly skipping through the directory, continue from the file that's being loaded
+		curPath = loadPath;
+	} else if(!wantedTexPath.empty()) {
+		// .. or the one that's being uploaded
+		curPath = wantedTexPath;
+	}
+	if(curPath.empty()) {
+		return;
+	}
+	std::string prevPath, nextPath;
+	if(GetNeighborFiles(curPath, prevPath, nextPath)) {
+		const std::string& p = next ? nextPath : prevPath;
+		if(p != curPath) {
+			LoadTexture(p.c_str());
+		}
+	}
+}
 
-		curTex = std::move(newTex);
+// watch the file of curTex (if autoReload is enabled)
+static void UpdateFileWatcher()
+{
+	if(autoReload && curTex.fileType != texview::Texture::FT_NONE) {
+		fileWatcher.Watch(curTex.name, curTex.fileModTime);
+	} else {
+		fileWatcher.Watch(std::string(), 0);
+	}
+}
+
+// called (from the main thread) when the AsyncLoader has finished loading newTex
+static void TextureLoaded(texview::Texture& newTex, const char* path)
+{
+	// if it's the reloaded version of curTex (that couldn't be updated in place),
+	// things like the zoom, swizzle and array index shouldn't change
+	const bool isReload = !reloadingTexPath.empty() && reloadingTexPath == path;
+	reloadingTexPath.clear();
+	if(!isReload) {
+		// keep the old texture around in case the user goes back to it
+		// (a reloaded one is outdated, it doesn't belong in the cache)
+		texCache.Put(curTex);
 	}
+	curTex = std::move(newTex);
+	UpdateFileWatcher();
+
 	// set windowtitle to filename (not entire path)
 	{
 		const char* fileName = strrchr(path, '/');
@@ -466,7 +1183,7 @@ static void LoadTexture(const char* path)
 			fileName = lastBS;
 #endif
 		if(fileName == nullptr)
-			fileName = path;
+			fileName = texview::IsStdinPath(path) ? "stdin" : path;
 		else
 			++fileName; // skip (back)slash
 
@@ -476,32 +1193,46 @@ static void LoadTexture(const char* path)
 		glfwSetWindowTitle(glfwWindow, winTitle);
 	}
 
-	curTex.CreateOpenGLtexture();
+	if(curTex.glTextureHandle == 0) { // if it's from the cache, it's already uploaded
+		// the upload is continued in the following frames, see ContinueTextureUpload()
+		if(curTex.StartOpenGLupload(useImmutableStorage)) {
+			curTex.ContinueOpenGLupload(uploadTimeBudget, GetUploadRing());
+		}
+	}
 	int numMips = curTex.GetNumMips();
 
-	UpdateTextureFilter(false);
+	UpdateTextureFilter();
 	if(numMips > 1) {
-		if(mipmapLevel != -1) {
+		if(mipmapLevel != -1 && (!isReload || mipmapLevel >= numMips)) {
 			// if it's set to auto, keep it at auto, otherwise default to 0
 			mipmapLevel = 0;
 		}
-		SetMipmapLevel(curTex, mipmapLevel, false);
+		UpdateMipmapRange(curTex);
 	}
 
 	if(curTex.IsCubemap()) {
-		float w, h;
-		curTex.GetSize(&w, &h);
-		ZoomFitToWindow(glfwWindow, w, h, true);
+		if(!isReload) {
+			float w, h;
+			curTex.GetSize(&w, &h);
+			ZoomFitToWindow(glfwWindow, w, h, true);
+		}
 		spacingBetweenMips = 0;
 	} else {
 		spacingBetweenMips = 2;
 	}
 
-	textureArrayIndex = 0;
+	if(!isReload || textureArrayIndex >= curTex.GetNumElements()) {
+		textureArrayIndex = 0;
+	}
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+	if(isReload) {
+		// keep the swizzle the user chose
+		UpdateShaders();
+		return;
+	}
 
 	if(curTex.defaultSwizzle != nullptr) {
 		strncpy(simpleSwizzle, curTex.defaultSwizzle, 4);
@@ -517,46 +1248,51 @@ static void LoadTexture(const char* path)
 	swizzle.clear();
 
 	UpdateShaders();
+
+	PrefetchNeighbors();
 }
 
-// mipLevel -1 == use configured mipmapLevel
-static void DrawQuad(texview::Texture& texture, int mipLevel, int arrayIndex, ImVec2 pos, ImVec2 size, ImVec2 texCoordMax = ImVec2(1, 1))
+// called when the reloaded version of curTex (because its file has changed) has been loaded
+static void TextureReloaded(texview::Texture& newTex)
 {
-	ImVec2 texCoordMin = ImVec2(0, 0);
-	GLuint tex = texture.glTextureHandle;
-	if(tex) {
-
-		glBindTexture(texture.glTarget, tex);
-
-		SetMipmapLevel(texture, (mipLevel < 0) ? mipmapLevel : mipLevel, false);
-
-		float idx = arrayIndex;
-
-		glBegin(GL_QUADS);
-			glTexCoord3f(texCoordMin.x, texCoordMin.y, idx);
-			glVertex2f(pos.x, pos.y);
-
-			glTexCoord3f(texCoordMin.x, texCoordMax.y, idx);
-			glVertex2f(pos.x, pos.y + size.y);
-
-			glTexCoord3f(texCoordMax.x, texCoordMax.y, idx);
-			glVertex2f(pos.x + size.x, pos.y + size.y);
+	int numChanged = 0;
+	if(curTex.UpdateFromReloaded(newTex, numChanged)) {
+		// same format and size => the changed parts have been uploaded into the existing texture
+		reloadingTexPath.clear();
+		// (the upload statistics in the sidebar show how much had to be uploaded)
+		UpdateFileWatcher();
+		return;
+	}
+	// something has changed that the OpenGL texture can't just be updated for
+	// (or it wasn't uploaded completely yet), so it's replaced like a new texture,
+	// TextureLoaded() keeps the view state because reloadingTexPath is set
+	std::string path = newTex.name;
+	ShowTexture(newTex, path.c_str());
+}
 
-			glTexCoord3f(texCoordMax.x, texCoordMin.y, idx);
-			glVertex2f(pos.x + size.x, pos.y);
-		glEnd();
+// the texture LOD for the shader: -1 for auto, otherwise relative to the base level
+static float GetShaderLod(const texview::Texture& texture, int mipLevel)
+{
+	if(mipLevel < 0) {
+		return -1.0f;
 	}
+	mipLevel = std::min(mipLevel, texture.GetNumMips() - 1);
+	// if the requested level isn't uploaded yet, use the biggest available one instead
+	return float(std::max(mipLevel - GetBaseMipLevel(texture), 0));
 }
 
-struct vec4 {
-	union {
-		struct { float x, y, z, w; };
-		float vals[4];
+// mipLevel -1 == use configured mipmapLevel
+// the quad is only drawn in DrawQuads(), together with all others
+static void AddQuad(texview::Texture& texture, int mipLevel, int arrayIndex, ImVec2 pos, ImVec2 size, ImVec2 texCoordMax = ImVec2(1, 1))
+{
+	QuadInstance q = {
+		{ pos.x, pos.y, size.x, size.y },
+		{ texCoordMax.x, texCoordMax.y, GetShaderLod(texture, (mipLevel < 0) ? mipmapLevel : mipLevel), float(arrayIndex) },
+		{ -1.0f, 0.0f }
 	};
-	vec4() = default;
-	vec4(float x_, float y_, float z_ = 0.0f, float w_ = 0.0f)
-	: x(x_), y(y_), z(z_), w(w_) {}
-};
+	quadInstances.push_back(q);
+}
+
 enum CubeFaceIndex {
 	FI_XPOS = 0,
 	FI_XNEG = 1,
@@ -567,82 +1303,80 @@ enum CubeFaceIndex {
 };
 
 // mipLevel -1 == use configured mipmapLevel
-static void DrawCubeQuad(texview::Texture& texture, int mipLevel, int faceIndex, int arrayIndex, ImVec2 pos, ImVec2 size, ImVec2 texCoordMax = ImVec2(1, 1))
+// the face's texture coordinates are calculated in the vertex shader
+static void AddCubeQuad(texview::Texture& texture, int mipLevel, int faceIndex, int arrayIndex, ImVec2 pos, ImVec2 size, ImVec2 texCoordMax = ImVec2(1, 1))
 {
-	ImVec2 texCoordMin = ImVec2(0, 0);
-
-	GLuint tex = texture.glTextureHandle;
-	if(tex) {
-
-		glBindTexture(texture.glTarget, tex);
-
-		SetMipmapLevel(texture, (mipLevel < 0) ? mipmapLevel : mipLevel, false);
-
-		// helpful: https://stackoverflow.com/questions/38543155/opengl-render-face-of-cube-map-to-a-quad
+	int rotationSteps = 0;
+	if(cubeCrossVariant > 0 && (faceIndex == FI_YPOS || faceIndex == FI_YNEG)) {
+		rotationSteps = (faceIndex == FI_YPOS) ? cubeCrossVariant : (4 - cubeCrossVariant);
+	}
+	QuadInstance q = {
+		{ pos.x, pos.y, size.x, size.y },
+		{ texCoordMax.x, texCoordMax.y, GetShaderLod(texture, (mipLevel < 0) ? mipmapLevel : mipLevel), float(arrayIndex) },
+		{ float(faceIndex), float(rotationSteps) }
+	};
+	quadInstances.push_back(q);
+}
 
-		// scale from [0, 1] to [-1, 1]
-		texCoordMin.x = texCoordMin.x * 2.0f - 1.0f;
-		texCoordMin.y = texCoordMin.y * 2.0f - 1.0f;
-		texCoordMax.x = texCoordMax.x * 2.0f - 1.0f;
-		texCoordMax.y = texCoordMax.y * 2.0f - 1.0f;
-
-		vec4 mapCoords[4] = {
-			// initialize with x, y coordinates (or s,t or whatever)
-			{ texCoordMin.x, texCoordMin.y },
-			{ texCoordMin.x, texCoordMax.y },
-			{ texCoordMax.x, texCoordMax.y },
-			{ texCoordMax.x, texCoordMin.y }
-		};
-
-		for(vec4& mc : mapCoords) {
-			vec4 tmp;
-			switch(faceIndex) {
-				case FI_XPOS:
-					tmp = vec4( 1.0f, -mc.y, -mc.x );
-					break;
-				case FI_XNEG:
-					tmp = vec4( -1.0f, -mc.y, mc.x );
-					break;
-				case FI_YPOS:
-					tmp = vec4( mc.x, 1.0f, mc.y );
-					break;
-				case FI_YNEG:
-					tmp = vec4( mc.x, -1.0f, -mc.y );
-					break;
-				case FI_ZPOS:
-					tmp = vec4( mc.x, -mc.y, 1.0f );
-					break;
-				case FI_ZNEG:
-					tmp = vec4( -mc.x, -mc.y, -1.0f );
-					break;
+// draws all the quads added with AddQuad() or AddCubeQuad() with one draw call
+static void DrawQuads(texview::Texture& texture)
+{
+	if(texture.glTextureHandle == 0 || quadInstances.empty()) {
+		quadInstances.clear();
+		return;
+	}
+	if(quadVAO == 0) {
+		glGenVertexArrays(1, &quadVAO);
+		glGenBuffers(1, &quadInstanceVBO);
+		glBindVertexArray(quadVAO);
+		if(TV_GL_ARB_instanced_arrays) {
+			glBindBuffer(GL_ARRAY_BUFFER, quadInstanceVBO);
+			const GLsizei stride = sizeof(QuadInstance);
+			glVertexAttribPointer(ATTR_POS_SIZE, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, posSize));
+			glVertexAttribPointer(ATTR_TEX_PARAMS, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, texParams));
+			glVertexAttribPointer(ATTR_CUBE_PARAMS, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, cubeParams));
+			for(GLuint attr : { ATTR_POS_SIZE, ATTR_TEX_PARAMS, ATTR_CUBE_PARAMS }) {
+				glEnableVertexAttribArray(attr);
+				glVertexAttribDivisor(attr, 1);
 			}
-			mc = tmp;
-			mc.w = arrayIndex;
 		}
+	}
 
-		if(cubeCrossVariant > 0 && (faceIndex == FI_YPOS || faceIndex == FI_YNEG)) {
-			int rotationSteps = (faceIndex == FI_YPOS) ? cubeCrossVariant : (4 - cubeCrossVariant);
-			vec4 mapCoordsCopy[4];
-			for(int i=0; i<4; ++i) {
-				mapCoordsCopy[i] = mapCoords[ (i+rotationSteps) % 4 ];
-			}
-			memcpy(mapCoords, mapCoordsCopy, sizeof(mapCoords));
+	glBindTexture(texture.glTarget, texture.glTextureHandle);
+	if(texture.palette.glHandle != 0) {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, texture.palette.glHandle);
+		glActiveTexture(GL_TEXTURE0);
+	}
+	if(texture.IsDecodedInShader()) {
+		GLint baseLevel = GetBaseMipLevel(texture);
+		float w, h;
+		texture.GetMipSize(baseLevel, &w, &h);
+		glUniform1i(decodeLinearLoc, linearFilter);
+		glUniform1i(decodeMaxLevelLoc, texture.GetNumMips() - 1 - baseLevel);
+		glUniform2i(decodeSize0Loc, (GLint)w, (GLint)h);
+	}
+	glBindVertexArray(quadVAO);
+	if(TV_GL_ARB_instanced_arrays) {
+		glBindBuffer(GL_ARRAY_BUFFER, quadInstanceVBO);
+		// orphaning the old buffer so the driver doesn't have to wait for the last frame
+		GLsizeiptr bufSize = quadInstances.size() * sizeof(QuadInstance);
+		glBufferData(GL_ARRAY_BUFFER, bufSize, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bufSize, quadInstances.data());
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, (GLsizei)quadInstances.size());
+	} else {
+		// without instanced arrays (should be very rare, it's in core OpenGL 3.3)
+		// the instance data is set as constant vertex attributes for each quad
+		// that's still a lot cheaper than changing texture parameters between the quads
+		for(const QuadInstance& q : quadInstances) {
+			glVertexAttrib4fv(ATTR_POS_SIZE, q.posSize);
+			glVertexAttrib4fv(ATTR_TEX_PARAMS, q.texParams);
+			glVertexAttrib2fv(ATTR_CUBE_PARAMS, q.cubeParams);
+			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 		}
-
-		glBegin(GL_QUADS);
-			glTexCoord4fv(mapCoords[0].vals);
-			glVertex2f(pos.x, pos.y);
-
-			glTexCoord4fv(mapCoords[1].vals);
-			glVertex2f(pos.x, pos.y + size.y);
-
-			glTexCoord4fv(mapCoords[2].vals);
-			glVertex2f(pos.x + size.x, pos.y + size.y);
-
-			glTexCoord4fv(mapCoords[3].vals);
-			glVertex2f(pos.x + size.x, pos.y);
-		glEnd();
 	}
+	glBindVertexArray(0);
+	quadInstances.clear();
 }
 
 static void DrawTexture()
@@ -675,6 +1409,7 @@ static void DrawTexture()
 		glDisable( GL_FRAMEBUFFER_SRGB );
 
 	glUseProgram(shaderProgram);
+	glUniform4fv(viewTransformLoc, 1, viewTransform);
 
 	float texW, texH;
 	tex.GetSize(&texW, &texH);
@@ -691,32 +1426,33 @@ static void DrawTexture()
 		float posX = offset;
 		float posY = 0.0f;
 		const ImVec2 size(texW, texH);
-		DrawCubeQuad(tex, -1, FI_YPOS, arrayIndex, ImVec2(posX, posY), size);
+		AddCubeQuad(tex, -1, FI_YPOS, arrayIndex, ImVec2(posX, posY), size);
 
 		posX = 0.0f;
 		posY += offset;
 		const int middleIndices[4] = { FI_XNEG, FI_ZPOS, FI_XPOS, FI_ZNEG };
 		for(int i=cubeCrossVariant, n=cubeCrossVariant+4; i < n; ++i) {
 			int faceIndex = middleIndices[i % 4];
-			DrawCubeQuad(tex, -1, faceIndex, arrayIndex, ImVec2(posX, posY), size);
+			AddCubeQuad(tex, -1, faceIndex, arrayIndex, ImVec2(posX, posY), size);
 			posX += offset;
 		}
 		posX = offset;
 		posY += offset;
 
-		DrawCubeQuad(tex, -1, FI_YNEG, arrayIndex, ImVec2(posX, posY), size);
+		AddCubeQuad(tex, -1, FI_YNEG, arrayIndex, ImVec2(posX, posY), size);
 
+		DrawQuads(tex);
 		glDisable( GL_FRAMEBUFFER_SRGB ); // make sure it's disabled or ImGui will look wrong
 		return;
 	}
 
 	if(viewMode == SINGLE) {
-		DrawQuad(tex, -1, arrayIndex, ImVec2(0, 0), ImVec2(texW, texH));
+		AddQuad(tex, -1, arrayIndex, ImVec2(0, 0), ImVec2(texW, texH));
 	} else if(viewMode == TILED) {
 		float tilesX = numTiles[0];
 		float tilesY = numTiles[1];
 		ImVec2 size(texW*tilesX, texH*tilesY);
-		DrawQuad(tex, -1, arrayIndex, ImVec2(0, 0), size, ImVec2(tilesX, tilesY));
+		AddQuad(tex, -1, arrayIndex, ImVec2(0, 0), size, ImVec2(tilesX, tilesY));
 	} else if(viewAtSameSize) {
 		int numMips = tex.GetNumMips();
 		if(viewMode == MIPMAPS_COMPACT) {
@@ -729,7 +1465,7 @@ static void DrawTexture()
 			float vOffset = texH + spacingBetweenMips;
 			int rowNum = 0;
 			for(int i=0; i < numMips; ++i) {
-				DrawQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(texW, texH));
+				AddQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(texW, texH));
 				if(((i+1) % numHor) == 0) {
 					posY += vOffset;
 					// change horizontal direction every line
@@ -747,7 +1483,7 @@ static void DrawTexture()
 			float posX = 0.0f;
 			float posY = 0.0f;
 			for(int i=0; i < numMips; ++i) {
-				DrawQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(texW, texH));
+				AddQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(texW, texH));
 				posX += hOffset;
 				posY += vOffset;
 			}
@@ -773,7 +1509,7 @@ static void DrawTexture()
 			for(int i=0; i < numMips; ++i) {
 				float w, h;
 				tex.GetMipSize(i, &w, &h);
-				DrawQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(w, h));
+				AddQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(w, h));
 
 				if( (toRight && (i & 1) == 0)
 				   || (!toRight && (i & 1) == 1) ) {
@@ -792,7 +1528,7 @@ static void DrawTexture()
 			for(int i=0; i < numMips; ++i) {
 				float w, h;
 				tex.GetMipSize(i, &w, &h);
-				DrawQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(w, h));
+				AddQuad(tex, i, arrayIndex, ImVec2(posX, posY), ImVec2(w, h));
 				if(inRow) {
 					posX += spacingBetweenMips + w;
 				} else {
@@ -804,6 +1540,7 @@ static void DrawTexture()
 		}
 	}
 
+	DrawQuads(tex);
 	glDisable( GL_FRAMEBUFFER_SRGB ); // make sure it's disabled or ImGui will look wrong
 }
 
@@ -824,16 +1561,14 @@ static void GenericFrame(GLFWwindow* window)
 	float xOffs = imguiMenuCollapsed ? 0.0f : imGuiMenuWidth * sx;
 	float winW = display_w - xOffs;
 
-	// good thing we're using a compat profile :-p
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
 	glViewport(xOffs, 0, winW, display_h);
-	glOrtho(0, winW, display_h, 0, -1, 1);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-
-	glScaled(zoomLevel, zoomLevel, 1);
-	glTranslated((transX * sx) / zoomLevel, (transY * sy) / zoomLevel, 0.0);
+	// this used to be glOrtho(0, winW, display_h, 0, -1, 1) followed by
+	// glScaled(zoomLevel, zoomLevel, 1) and glTranslated(transX*sx/zoomLevel, transY*sy/zoomLevel, 0),
+	// now the vertex shader does the equivalent with just a scale and an offset
+	viewTransform[0] = float(2.0 * zoomLevel / winW);
+	viewTransform[1] = float(-2.0 * zoomLevel / display_h);
+	viewTransform[2] = float(2.0 * transX * sx / winW - 1.0);
+	viewTransform[3] = float(1.0 - 2.0 * transY * sy / display_h);
 
 	DrawTexture();
 }
@@ -846,16 +1581,12 @@ static void OpenFilePicker() {
 		//args.filterCount = 2;
 		std::string dp;
 		if(!curTex.name.empty()) {
-			dp = curTex.name;
-			size_t lastSlash = dp.find_last_of('/');
-	#ifdef _WIN32
-			size_t lastBS = dp.find_last_of('\\');
-			if( (lastBS != std::string::npos && lastBS > lastSlash)
-			   || lastSlash == std::string::npos )
-			{
-				lastSlash = lastBS;
+			// for a texture in an archive, start in the directory the archive is in
+			std::string innerPath;
+			if(!texview::SplitArchivePath(curTex.name.c_str(), dp, innerPath)) {
+				dp = curTex.name;
 			}
-	#endif
+			size_t lastSlash = FindLastPathSeparator(dp);
 			if(lastSlash != std::string::npos) {
 				dp.resize(lastSlash);
 				args.defaultPath = dp.c_str();
@@ -875,6 +1606,151 @@ static void OpenFilePicker() {
 #endif
 }
 
+static void OpenPalettePicker() {
+#ifdef TV_USE_NFD
+		nfdu8filteritem_t filters[] = { { "Palettes", "pcx,pal,lmp" } };
+		nfdopendialogu8args_t args = {0};
+		args.filterList = filters;
+		args.filterCount = 1;
+		nfdu8char_t* outPath = nullptr;
+		nfdresult_t result = NFD_OpenDialogU8_With(&outPath, &args);
+		if(result == NFD_OKAY) {
+			std::vector<uint32_t> colors;
+			if(texview::LoadPaletteFile(outPath, colors)) {
+				curTex.SetPalette(colors, outPath);
+			}
+		}
+		if(outPath != nullptr) {
+			NFD_FreePathU8(outPath);
+		}
+#else
+		errprintf("Built without NativeFileDialog support, have no alternative (yet)!\n");
+#endif
+}
+
+static void OpenRawImportPicker() {
+#ifdef TV_USE_NFD
+		nfdopendialogu8args_t args = {0};
+		nfdu8char_t* outPath = nullptr;
+		nfdresult_t result = NFD_OpenDialogU8_With(&outPath, &args);
+		if(result == NFD_OKAY) {
+			snprintf(rawImportPath, sizeof(rawImportPath), "%s", outPath);
+		}
+		if(outPath != nullptr) {
+			NFD_FreePathU8(outPath);
+		}
+#else
+		errprintf("Built without NativeFileDialog support, have no alternative (yet)!\n");
+#endif
+}
+
+// loads the (headerless) file at path as raw data with the given params
+static void LoadRawTexture(const char* path, const texview::RawImportParams& params)
+{
+	texview::SetRawImportParams(path, params);
+	if(!texview::IsStdinPath(path)) {
+		// if it's in the cache, it was loaded with the old params (or not as raw data at all)
+		texview::Texture oldTex;
+		texCache.Take(texview::ToAbsolutePath(path), oldTex);
+	}
+	LoadTexture(path);
+}
+
+static void DrawRawImportWindow(GLFWwindow* window)
+{
+	ImGuiIO& io = ImGui::GetIO();
+
+	ImGui::SetNextWindowPos( ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.5f),
+	                         ImGuiCond_Appearing, ImVec2(0.5f, 0.5f) );
+	ImGuiWindowFlags flags = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize
+	                        | ImGuiWindowFlags_NoCollapse;
+	if(ImGui::Begin("Import Raw Data", &showRawImportWindow, flags)) {
+		static std::vector<std::pair<const char*, int>> formats;
+		if(formats.empty()) {
+			texview::GetRawImportFormats(formats);
+		}
+		if(ImGui::IsWindowAppearing() && curTex.fileType == texview::Texture::FT_RAW) {
+			// start with the settings of the current texture, so they can be tweaked
+			texview::GetRawImportParams(curTex.name, rawImportParams);
+			snprintf(rawImportPath, sizeof(rawImportPath), "%s", curTex.name.c_str());
+		}
+		ImGui::TextDisabled("For headerless files, like GPU resources dumped by capture tools.\n"
+		                    "All mip levels of the first array element come first,\n"
+		                    "then the ones of the second element etc.");
+		ImGui::Spacing();
+
+		float inputWidth = ImGui::CalcTextSize("0123456789abcdef0123456789ABCDEF").x;
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputText("##path", rawImportPath, sizeof(rawImportPath));
+		ImGui::SameLine();
+		if(ImGui::Button("Select File")) {
+			OpenRawImportPicker();
+		}
+
+		ImGui::SetNextItemWidth(inputWidth);
+		if(ImGui::BeginCombo("Format", rawImportParams.format.c_str(), ImGuiComboFlags_HeightLarge)) {
+			static ImGuiTextFilter filter;
+			if(ImGui::IsWindowAppearing()) {
+				filter.Clear();
+				ImGui::SetKeyboardFocusHere();
+			}
+			filter.Draw("##filter", -FLT_MIN);
+			for(const auto& f : formats) {
+				const char* dxgiName = (f.second != 0) ? texview::GetDXGIFormatName(f.second) : nullptr;
+				if(!filter.PassFilter(f.first) && (dxgiName == nullptr || !filter.PassFilter(dxgiName))) {
+					continue;
+				}
+				bool selected = (rawImportParams.format == f.first);
+				if(ImGui::Selectable(f.first, selected)) {
+					rawImportParams.format = f.first;
+				}
+				if(selected) {
+					ImGui::SetItemDefaultFocus();
+				}
+				if(dxgiName != nullptr) {
+					ImGui::SameLine();
+					ImGui::TextDisabled("(%s = %d)", dxgiName, f.second);
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputScalar("Width", ImGuiDataType_U32, &rawImportParams.width);
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputScalar("Height", ImGuiDataType_U32, &rawImportParams.height);
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputScalar("Mip Levels", ImGuiDataType_U32, &rawImportParams.numMips);
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputScalar("Array Size", ImGuiDataType_U32, &rawImportParams.arraySize);
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputScalar("Offset", ImGuiDataType_U64, &rawImportParams.offset);
+		ImGui::SetItemTooltip("Where the data of the first mip level starts in the file (in bytes)");
+		ImGui::SetNextItemWidth(inputWidth);
+		ImGui::InputScalar("Row Pitch", ImGuiDataType_U32, &rawImportParams.rowPitch);
+		ImGui::SetItemTooltip("Bytes from the start of one row (of blocks for compressed formats)\n"
+		                      "to the next, 0 if they're tightly packed.\n"
+		                      "Only supported for a single mip level");
+		ImGui::Spacing();
+
+		bool canImport = rawImportPath[0] != '\0' && !rawImportParams.format.empty()
+		                 && rawImportParams.width > 0 && rawImportParams.height > 0;
+		float dialogButtonWidth = ImGui::CalcTextSize( "Ok or Cancel ???" ).x;
+		ImGui::BeginDisabled(!canImport);
+		if(ImGui::Button("Import", ImVec2(dialogButtonWidth, 0))) {
+			LoadRawTexture(rawImportPath, rawImportParams);
+			showRawImportWindow = false;
+		}
+		ImGui::EndDisabled();
+		ImGui::SameLine();
+		if( ImGui::Button("Cancel", ImVec2(dialogButtonWidth, 0))
+		   || ImGui::IsKeyPressed(ImGuiKey_Escape, false) ) {
+			showRawImportWindow = false;
+		}
+	}
+	ImGui::End();
+}
+
 static void DrawAboutWindow(GLFWwindow* window)
 {
 	ImGuiIO& io = ImGui::GetIO();
@@ -978,6 +1854,23 @@ static void DrawSidebar(GLFWwindow* window)
 		if(ImGui::Button("Open File")) {
 			OpenFilePicker();
 		}
+		ImGui::SameLine();
+		if(ImGui::Button("Raw...")) {
+			showRawImportWindow = true;
+		}
+		ImGui::SetItemTooltip("Import a headerless file with a given format and size");
+		if(!curTex.name.empty()) {
+			ImGui::SameLine();
+			if(ImGui::ArrowButton("##prevFile", ImGuiDir_Left)) {
+				LoadNeighborTexture(false);
+			}
+			ImGui::SetItemTooltip("Previous file in directory (Page Up)");
+			ImGui::SameLine();
+			if(ImGui::ArrowButton("##nextFile", ImGuiDir_Right)) {
+				LoadNeighborTexture(true);
+			}
+			ImGui::SetItemTooltip("Next file in directory (Page Down)");
+		}
 		float fontWrapWidth = ImGui::CalcTextSize("0123456789abcdef0123456789ABCDEF").x;
 		ImGui::PushTextWrapPos(fontWrapWidth);
 		//ImGui::TextWrapped("File: %s", curTex.name.c_str());
@@ -985,7 +1878,86 @@ static void DrawSidebar(GLFWwindow* window)
 		ImGui::BeginDisabled(true);
 		ImGui::TextWrapped("%s", curTex.name.c_str());
 		ImGui::EndDisabled();
+		{
+			std::string loadPath;
+			const char* loadStage = nullptr;
+			float loadProgress = 0.0f;
+			if(texLoader.GetCurrentLoad(loadPath, loadStage, loadProgress)) {
+				ImGui::Spacing();
+				ImGui::Text("Loading: ");
+				ImGui::BeginDisabled(true);
+				ImGui::TextWrapped("%s", loadPath.c_str());
+				ImGui::EndDisabled();
+				// stb_image or libktx don't tell how far they are => show "indeterminate" progress bar
+				float fraction = (loadProgress >= 0.0f) ? loadProgress : -1.0f * (float)ImGui::GetTime();
+				ImGui::ProgressBar(fraction, ImVec2(fontWrapWidth - ImGui::CalcTextSize("Cancel  ").x, 0.0f), loadStage);
+				ImGui::SameLine();
+				if(ImGui::Button("Cancel")) {
+					texLoader.CancelAll();
+				}
+				ImGui::Spacing();
+			}
+			float uploadProgress = 0.0f;
+			if(uploadThread.GetCurrentUpload(loadPath, uploadProgress)) {
+				ImGui::Spacing();
+				ImGui::Text("Uploading to GPU: ");
+				ImGui::BeginDisabled(true);
+				ImGui::TextWrapped("%s", loadPath.c_str());
+				ImGui::EndDisabled();
+				ImGui::ProgressBar(uploadProgress, ImVec2(fontWrapWidth, 0.0f));
+				ImGui::Spacing();
+			}
+		}
+		if(curTex.IsUploadPending()) {
+			int numMips = curTex.GetNumMips();
+			ImGui::Text("Uploading to GPU: %d of %d mip levels done", numMips - curTex.GetFirstCompleteMip(), numMips);
+		} else if(curTex.glTextureHandle != 0) {
+			size_t upBytes = 0;
+			double upSeconds = 0.0;
+			curTex.GetUploadStats(upBytes, upSeconds);
+			double upMB = upBytes / (1024.0 * 1024.0);
+			ImGui::Text("Upload: %.1f MB in %.1f ms (%.0f MB/s)", upMB, upSeconds * 1000.0,
+			            (upSeconds > 0.0) ? upMB / upSeconds : 0.0);
+			ImGui::SetItemTooltip("Only counts the time spent in the upload code (on the main or upload thread)");
+		}
+		{
+			texview::PageFaultCounts upFaults = curTex.GetUploadFaults();
+			ImGui::Text("Page faults: load %llu (%llu major), upload %llu (%llu major)",
+			            (unsigned long long)curTex.loadFaults.minor, (unsigned long long)curTex.loadFaults.major,
+			            (unsigned long long)upFaults.minor, (unsigned long long)upFaults.major);
+			ImGui::SetItemTooltip("Major faults had to read from disk (or network), minor ones didn't.\n"
+			                      "Can be influenced with the mmap hints in the settings");
+		}
+		if(curTex.UsesImmutableStorage()) {
+			ImGui::Text("Immutable storage%s", curTex.UsesDSA() ? ", DSA" : "");
+		}
 		ImGui::Text("Format: %s", curTex.formatName.c_str());
+		if(curTex.textureFlags & texview::TF_INDEXED) {
+			ImGui::TextWrapped("Palette: %s", curTex.palette.source.c_str());
+			if(ImGui::Button("Load Palette...")) {
+				OpenPalettePicker();
+			}
+			ImGui::SetItemTooltip("256 color PCX (like Quake2's pics/colormap.pcx), JASC-PAL\n"
+			                      "or raw 768 bytes RGB (like Quake's gfx/palette.lmp)");
+			ImGui::SameLine();
+			if(ImGui::Button("Grayscale")) {
+				std::vector<uint32_t> colors;
+				texview::GetGrayscalePalette(colors);
+				curTex.SetPalette(colors, "grayscale");
+			}
+		}
+		if(curTex.container.name != nullptr) {
+			double compMB = curTex.fileSize / (1024.0 * 1024.0);
+			double decompMB = curTex.container.decompressedSize / (1024.0 * 1024.0);
+			double secs = curTex.container.decompressSeconds;
+			ImGui::Text("Compressed (%s): %.1f -> %.1f MB in %.1f ms (%.0f MB/s)", curTex.container.name,
+			            compMB, decompMB, secs * 1000.0, (secs > 0.0) ? decompMB / secs : 0.0);
+		}
+		if(curTex.transcodeTarget != nullptr) {
+			ImGui::Text("Transcoded to: %s", curTex.transcodeTarget);
+		}
+		ImGui::Text("Memory: CPU %.2f MB%s, GPU %.2f MB", curTex.cpuDataSize / (1024.0 * 1024.0),
+		            curTex.HasCPUData() ? "" : " (dropped)", curTex.GetGPUMemoryUsage() / (1024.0 * 1024.0));
 		float tw, th;
 		curTex.GetSize(&tw, &th);
 		ImGui::Text("Texture Size: %d x %d", (int)tw, (int)th);
@@ -1071,7 +2043,6 @@ static void DrawSidebar(GLFWwindow* window)
 				if(ImGui::SliderInt("Mip Level", &mipLevel, -1, maxLevel,
 				                    miplevelString, ImGuiSliderFlags_AlwaysClamp)) {
 					mipmapLevel = mipLevel;
-					SetMipmapLevel(curTex, mipLevel);
 				}
 			}
 		}
@@ -1151,6 +2122,84 @@ static void DrawSidebar(GLFWwindow* window)
 
 		ImGui::ColorEdit3("BG Color", &clear_color.x);
 		ImGui::Spacing(); ImGui::Spacing();
+		// (not uploadRing.IsAvailable(), it's only created once it's used on the main thread,
+		//  and the upload thread has its own)
+		ImGui::BeginDisabled(!TV_GL_ARB_buffer_storage);
+		ImGui::Checkbox("Upload through PBO ring", &useUploadRing);
+		ImGui::EndDisabled();
+		ImGui::SetItemTooltip(TV_GL_ARB_buffer_storage ? "Upload texture data through a persistently mapped buffer that's filled by worker threads"
+		                                               : "Needs OpenGL 4.4 or GL_ARB_buffer_storage");
+		ImGui::BeginDisabled(!TV_GL_ARB_texture_storage);
+		ImGui::Checkbox("Use immutable storage", &useImmutableStorage);
+		ImGui::EndDisabled();
+		ImGui::SetItemTooltip(TV_GL_ARB_texture_storage ? "Allocate textures with glTexStorage*() (and use DSA if available)"
+		                                                : "Needs OpenGL 4.2 or GL_ARB_texture_storage");
+		ImGui::BeginDisabled(!uploadThread.IsRunning());
+		ImGui::Checkbox("Upload in background thread", &useUploadThread);
+		ImGui::EndDisabled();
+		ImGui::SetItemTooltip(uploadThread.IsRunning() ? "Upload textures with a second OpenGL context in its own thread,\n"
+		                                                 "they're shown once the upload is complete"
+		                                               : "Couldn't create the shared OpenGL context for the upload thread");
+		{
+			int ioBackend = texview::GetFileIOBackend();
+			ImGui::Text("File access:");
+			ImGui::SameLine();
+			ImGui::RadioButton("mmap", &ioBackend, texview::FIO_MMAP);
+			ImGui::SetItemTooltip("Map texture files into memory, only the parts that are needed are read");
+			ImGui::SameLine();
+			ImGui::RadioButton("read", &ioBackend, texview::FIO_READ);
+			ImGui::SetItemTooltip("Read the whole file into memory (big files with several threads),\n"
+			                      "usually faster on network filesystems");
+			texview::SetFileIOBackend((texview::FileIOBackend)ioBackend);
+		}
+		ImGui::BeginDisabled(texview::GetFileIOBackend() != texview::FIO_MMAP);
+		{
+			uint32_t mmapHints = texview::GetMemMapHints();
+			ImGui::Text("mmap hints:");
+			ImGui::SetItemTooltip("How texture files are mapped into memory, see the page faults of the current texture.\n"
+			                      "Only affects textures loaded afterwards (except for readahead)");
+			ImGui::SameLine();
+			ImGui::CheckboxFlags("populate", &mmapHints, texview::MMH_POPULATE);
+			ImGui::SameLine();
+			ImGui::CheckboxFlags("sequential", &mmapHints, texview::MMH_SEQUENTIAL);
+			ImGui::SameLine();
+			ImGui::CheckboxFlags("willneed", &mmapHints, texview::MMH_WILLNEED);
+			ImGui::CheckboxFlags("hugepage", &mmapHints, texview::MMH_HUGEPAGE);
+			ImGui::SameLine();
+			ImGui::CheckboxFlags("readahead mips", &mmapHints, texview::MMH_READAHEAD);
+			ImGui::SetItemTooltip("Read the next mip level in the background while the current one is uploaded");
+			texview::SetMemMapHints(mmapHints);
+		}
+		ImGui::EndDisabled();
+		if(ImGui::Checkbox("Auto-reload changed files", &autoReload)) {
+			texLoader.SetComputeMipHashes(autoReload);
+			UpdateFileWatcher();
+		}
+		ImGui::SetItemTooltip("Reload the texture when its file changes (keeping zoom, swizzle etc),\n"
+		                      "only the mip levels that have changed are uploaded again");
+		ImGui::Checkbox("Drop CPU data after upload", &dropCPUDataAfterUpload);
+		ImGui::SetItemTooltip("Free the texture data in main memory once it's on the GPU,\n"
+		                      "it's loaded again (from the disk cache, if possible) when it's needed for another upload");
+		ImGui::BeginDisabled(curTex.glTextureHandle == 0 || curTex.IsUploadPending());
+		if(ImGui::Button("Upload again")) {
+			// to compare the upload speed of the different upload paths
+			if(curTex.StartOpenGLupload(useImmutableStorage)) {
+				curTex.ContinueOpenGLupload(uploadTimeBudget, GetUploadRing());
+				UpdateTextureFilter();
+				UpdateMipmapRange(curTex);
+			}
+		}
+		ImGui::EndDisabled();
+		ImGui::Text("Cache: %d textures, %.1f / %.0f MB", texCache.GetNumTextures(),
+		            texCache.GetMemoryUsage() / (1024.0 * 1024.0),
+		            texCache.GetBudget() / (1024.0 * 1024.0));
+		ImGui::Checkbox("Only redraw when needed", &redrawOnDemand);
+		ImGui::SetItemTooltip("Only render frames on input or while loading/uploading,\n"
+		                      "otherwise render continuously (with vsync)");
+		ImGui::Text("Frames rendered: %u", frameCounter);
+		ImGui::Text("Shader programs: %d (%d compiled, %d from disk cache)", (int)shaderProgramCache.size(),
+		            numShaderCompiles, numProgramBinaryLoads);
+		ImGui::Spacing();
 		ImGui::Separator();
 		ImGui::Spacing(); ImGui::Spacing();
 		float aboutButtonWidth = ImGui::CalcTextSize( "About blah" ).x; // this width looks ok
@@ -1182,6 +2231,9 @@ static void ImGuiFrame(GLFWwindow* window)
 	if(showGLSLeditWindow)
 		DrawGLSLeditWindow(window);
 
+	if(showRawImportWindow)
+		DrawRawImportWindow(window);
+
 	DrawSidebar(window);
 
 	// NOTE: ImGui::GetMouseDragDelta() is not very useful here, because
@@ -1252,6 +2304,7 @@ static void myGLFWscrollfun(GLFWwindow* window, double xoffset, double yoffset)
 	//   - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
 	//   - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
 	//   Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
+	RequestRedraw();
 	if(yoffset == 0 || ImGui::GetIO().WantCaptureMouse) {
 		return;
 	}
@@ -1265,6 +2318,7 @@ static void myGLFWkeyfun(GLFWwindow* window, int key, int scancode, int action,
 	// ImGui window has focus, even if no text input is active), this seems to
 	// do exactly what I want (i.e. let me ignore keys only if one is currently
 	// typing text into some ImGui widget)
+	RequestRedraw();
 	if(ImGui::GetIO().WantTextInput) {
 		return;
 	}
@@ -1274,11 +2328,81 @@ static void myGLFWkeyfun(GLFWwindow* window, int key, int scancode, int action,
 		transX = 10.0;
 		transY = 10.0;
 	}
+
+	if(action != GLFW_RELEASE) {
+		// ImGui uses the arrow keys to navigate its widgets, so only use them if it's not doing that
+		bool arrowsFree = !ImGui::GetIO().NavActive;
+		if(key == GLFW_KEY_PAGE_DOWN || (key == GLFW_KEY_RIGHT && arrowsFree)) {
+			LoadNeighborTexture(true);
+		} else if(key == GLFW_KEY_PAGE_UP || (key == GLFW_KEY_LEFT && arrowsFree)) {
+			LoadNeighborTexture(false);
+		}
+	}
 }
 
 void myGLFWwindowcontentscalefun(GLFWwindow* window, float xscale, float yscale)
 {
 	ImGui::GetIO().FontGlobalScale = std::max(xscale, yscale);
+	RequestRedraw();
+}
+
+// the following callbacks are only used to know when to redraw.
+// ImGui installs its own callbacks (for the mouse etc) and calls these from them
+static void myGLFWcursorposfun(GLFWwindow* window, double x, double y)
+{
+	RequestRedraw();
+}
+
+static void myGLFWmousebuttonfun(GLFWwindow* window, int button, int action, int mods)
+{
+	RequestRedraw();
+}
+
+static void myGLFWcharfun(GLFWwindow* window, unsigned int codepoint)
+{
+	RequestRedraw();
+}
+
+static void myGLFWcursorenterfun(GLFWwindow* window, int entered)
+{
+	RequestRedraw();
+}
+
+static void myGLFWwindowfocusfun(GLFWwindow* window, int focused)
+{
+	RequestRedraw();
+}
+
+static void myGLFWframebuffersizefun(GLFWwindow* window, int width, int height)
+{
+	RequestRedraw();
+}
+
+static void myGLFWwindowrefreshfun(GLFWwindow* window)
+{
+	RequestRedraw();
+}
+
+// returns true if something is going on that needs the main loop
+// to keep running (and rendering), even without any input
+static bool IsBusy()
+{
+	if(curTex.IsUploadPending() || uploadThread.IsBusy()) {
+		return true;
+	}
+	std::string loadPath;
+	const char* loadStage = nullptr;
+	float loadProgress = 0.0f;
+	if(texLoader.GetCurrentLoad(loadPath, loadStage, loadProgress)) {
+		return true; // the progress bar is animated
+	}
+	// the text cursor blinks
+	return ImGui::GetCurrentContext() != nullptr && ImGui::GetIO().WantTextInput;
+}
+
+static bool NeedRedraw()
+{
+	return !redrawOnDemand || glfwGetTime() < redrawUntil || IsBusy();
 }
 
 /*
@@ -1336,12 +2460,129 @@ GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei
 	errprintf("GLDBG %s %s %s: %s\n", sourceStr, typeStr, severityStr, message);
 }
 
+static void PrintUsage()
+{
+	errprintf("Usage: texview [file]\n"
+	          "       texview --raw-format FORMAT --raw-size WIDTHxHEIGHT [--raw-mips N] [--raw-array N]\n"
+	          "               [--raw-offset BYTES] [--raw-pitch BYTES] file\n"
+	          "       texview --raw-format list\n"
+	          "       texview --info [...] file_or_dir ...\n"
+	          "  file can be - to read from stdin\n"
+	          "  --raw-*    load the file as headerless data with the given format (like R8G8B8A8_UNORM\n"
+	          "             or BC1_UNORM_SRGB or a DXGI_FORMAT number, see --raw-format list), size,\n"
+	          "             number of mip levels (default 1), array size (default 1), offset of the\n"
+	          "             first mip level (default 0) and row pitch (default 0: tightly packed).\n"
+	          "             Numbers can also be hex (0x...)\n");
+}
+
+static void PrintRawFormats()
+{
+	std::vector<std::pair<const char*, int>> formats;
+	texview::GetRawImportFormats(formats);
+	printf("Formats for --raw-format (name, DXGI_FORMAT name or DXGI_FORMAT number):\n");
+	for(const auto& f : formats) {
+		const char* dxgiName = (f.second != 0) ? texview::GetDXGIFormatName(f.second) : nullptr;
+		if(dxgiName != nullptr) {
+			printf("  %3d  %-28s %s\n", f.second, dxgiName, f.first);
+		} else {
+			printf("       %-28s %s\n", "", f.first);
+		}
+	}
+}
+
+static bool ParseUInt(const char* str, uint64_t maxVal, uint64_t& val)
+{
+	char* end = nullptr;
+	val = strtoull(str, &end, 0);
+	return end != str && *end == '\0' && val <= maxVal;
+}
+
+// parses the commandline arguments (except for --info, see RunInfoMode()), see PrintUsage().
+// the --raw-* ones are written to rawImportParams, if there are any isRaw is set.
+// returns -1 if texview should start, otherwise the exit code
+static int ParseCommandline(int argc, char** argv, const char*& file, bool& isRaw)
+{
+	for(int i=1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+			PrintUsage();
+			return 0;
+		}
+		if(strncmp(arg, "--raw-", 6) != 0) {
+			if(file == nullptr) {
+				file = arg;
+			}
+			continue;
+		}
+		if(i + 1 == argc) {
+			errprintf("%s needs an argument!\n", arg);
+			PrintUsage();
+			return 1;
+		}
+		const char* val = argv[++i];
+		isRaw = true;
+		uint64_t num = 0;
+		bool ok = true;
+		if(strcmp(arg, "--raw-format") == 0) {
+			if(strcmp(val, "list") == 0) {
+				PrintRawFormats();
+				return 0;
+			}
+			rawImportParams.format = val;
+		} else if(strcmp(arg, "--raw-size") == 0) {
+			unsigned w = 0, h = 0;
+			char c = 0;
+			ok = sscanf(val, "%ux%u%c", &w, &h, &c) == 2;
+			rawImportParams.width = w;
+			rawImportParams.height = h;
+		} else if(strcmp(arg, "--raw-mips") == 0) {
+			ok = ParseUInt(val, UINT32_MAX, num);
+			rawImportParams.numMips = uint32_t(num);
+		} else if(strcmp(arg, "--raw-array") == 0) {
+			ok = ParseUInt(val, UINT32_MAX, num);
+			rawImportParams.arraySize = uint32_t(num);
+		} else if(strcmp(arg, "--raw-offset") == 0) {
+			ok = ParseUInt(val, UINT64_MAX, num);
+			rawImportParams.offset = num;
+		} else if(strcmp(arg, "--raw-pitch") == 0) {
+			ok = ParseUInt(val, UINT32_MAX, num);
+			rawImportParams.rowPitch = uint32_t(num);
+		} else {
+			errprintf("Unknown argument '%s'!\n", arg);
+			PrintUsage();
+			return 1;
+		}
+		if(!ok) {
+			errprintf("Invalid value '%s' for %s!\n", val, arg);
+			PrintUsage();
+			return 1;
+		}
+	}
+	if(isRaw && (rawImportParams.format.empty() || rawImportParams.width == 0 || rawImportParams.height == 0)) {
+		errprintf("Raw imports need at least --raw-format and --raw-size!\n");
+		PrintUsage();
+		return 1;
+	}
+	return -1;
+}
+
 #ifdef _WIN32
 int my_main(int argc, char** argv) // called from WinMain() in sys_win.cpp
 #else
 int main(int argc, char** argv)
 #endif
 {
+	if(argc > 1 && strcmp(argv[1], "--info") == 0) {
+		// headless mode, doesn't need a window or OpenGL
+		return texview::RunInfoMode(argc - 2, argv + 2);
+	}
+	const char* file = nullptr;
+	bool isRaw = false;
+	int exitCode = ParseCommandline(argc, argv, file, isRaw);
+	if(exitCode >= 0) {
+		return exitCode;
+	}
+
 	int ret = 0;
 	glfwSetErrorCallback(glfw_error_callback);
 	if (!glfwInit()) {
@@ -1388,6 +2629,8 @@ int main(int argc, char** argv)
 
 	glfwMakeContextCurrent(glfwWindow);
 	gladLoadGL(glfwGetProcAddress);
+	TV_LoadGLextra(glfwGetProcAddress);
+	texview::ProbeTranscodeTargets();
 
 	if(wantDebugContext) {
 		int haveDebugContext = glfwGetWindowAttrib(glfwWindow, GLFW_CONTEXT_DEBUG);
@@ -1407,9 +2650,67 @@ int main(int argc, char** argv)
 
 	glfwSetScrollCallback(glfwWindow, myGLFWscrollfun);
 	glfwSetKeyCallback(glfwWindow, myGLFWkeyfun);
+	// (these must be set before ImGui_ImplGlfw_InitForOpenGL() so ImGui chains them)
+	glfwSetCursorPosCallback(glfwWindow, myGLFWcursorposfun);
+	glfwSetMouseButtonCallback(glfwWindow, myGLFWmousebuttonfun);
+	glfwSetCharCallback(glfwWindow, myGLFWcharfun);
+	glfwSetCursorEnterCallback(glfwWindow, myGLFWcursorenterfun);
+	glfwSetWindowFocusCallback(glfwWindow, myGLFWwindowfocusfun);
+	glfwSetFramebufferSizeCallback(glfwWindow, myGLFWframebuffersizefun);
+	glfwSetWindowRefreshCallback(glfwWindow, myGLFWwindowrefreshfun);
+
+	// glfwPostEmptyEvent() can be called from any thread
+	texLoader.Init(glfwPostEmptyEvent);
+	texLoader.SetComputeMipHashes(autoReload);
+	fileWatcher.Init(glfwPostEmptyEvent);
+
+	// a hidden window whose context shares textures etc with the main one,
+	// for the upload thread
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* uploadWindow = glfwCreateWindow(16, 16, "texview upload", nullptr, glfwWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if(uploadWindow != nullptr) {
+		uploadThread.Init(uploadWindow, glfwPostEmptyEvent);
+	} else {
+		errprintf("Couldn't create shared OpenGL context for uploads, will upload in main thread\n");
+	}
 
-	if(argc > 1) {
-		LoadTexture(argv[1]);
+	const char* cacheSizeEnv = getenv("TEXVIEW_CACHE_MB");
+	if(cacheSizeEnv != nullptr) {
+		texCache.SetBudget(size_t(std::max(atoi(cacheSizeEnv), 0)) * 1024 * 1024);
+	}
+	// "mmap" (default) or "read", see texview::FileIOBackend
+	const char* ioBackendEnv = getenv("TEXVIEW_IO");
+	if(ioBackendEnv != nullptr) {
+		texview::FileIOBackend backend;
+		if(texview::ParseFileIOBackend(ioBackendEnv, backend)) {
+			texview::SetFileIOBackend(backend);
+		} else {
+			errprintf("Unknown TEXVIEW_IO backend '%s', using mmap\n", ioBackendEnv);
+		}
+	}
+	// e.g. "sequential,readahead", see texview::MemMapHints
+	const char* mmapHintsEnv = getenv("TEXVIEW_MMAP_HINTS");
+	if(mmapHintsEnv != nullptr) {
+		texview::SetMemMapHints(texview::ParseMemMapHints(mmapHintsEnv));
+	}
+	// on-disk cache of decoded/transcoded textures, 0 disables it
+	const char* diskCacheSizeEnv = getenv("TEXVIEW_DISKCACHE_MB");
+	if(diskCacheSizeEnv != nullptr) {
+		texview::SetDiskCacheBudget(size_t(std::max(atoi(diskCacheSizeEnv), 0)) * 1024 * 1024);
+	}
+
+	if(file == nullptr && texview::IsStdinRedirected()) {
+		// like cat foo.dds | texview
+		file = "-";
+	}
+	if(file != nullptr) {
+		if(isRaw) {
+			snprintf(rawImportPath, sizeof(rawImportPath), "%s", file);
+			LoadRawTexture(file, rawImportParams);
+		} else {
+			LoadTexture(file); // "-" for stdin
+		}
 	}
 
 	// Setup Dear ImGui context
@@ -1448,25 +2749,94 @@ int main(int argc, char** argv)
 		// - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
 		// - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
 		// Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-		glfwPollEvents();
+		if(NeedRedraw()) {
+			glfwPollEvents();
+		} else {
+			// nothing to do => sleep until there's an event (input, or glfwPostEmptyEvent()
+			// from the loader or upload threads). The timeout is just to be safe
+			glfwWaitEventsTimeout(1.0);
+		}
+
+		{
+			texview::Texture newTex;
+			std::string path;
+			if(fileWatcher.GetChanged(path) && path == curTex.name && path == wantedTexPath) {
+				// (if something else is about to be shown, the change doesn't matter)
+				reloadingTexPath = path;
+				texLoader.StartLoad(path.c_str());
+			}
+			bool success = false;
+			bool isPrefetch = false;
+			while(texLoader.GetFinished(newTex, path, success, isPrefetch)) {
+				RequestRedraw();
+				const bool isReload = !isPrefetch && path == reloadingTexPath;
+				if(!success) {
+					if(isReload) {
+						// maybe it's broken or was still being written, try again on the next change
+						reloadingTexPath.clear();
+					}
+					continue;
+				}
+				if(isPrefetch) {
+					// only uploaded to the GPU once it's actually shown
+					texCache.Put(newTex);
+				} else if(isReload) {
+					TextureReloaded(newTex);
+				} else {
+					ShowTexture(newTex, path.c_str());
+				}
+			}
+			while(uploadThread.GetFinished(newTex)) {
+				RequestRedraw();
+				if(newTex.name == wantedTexPath) {
+					path = newTex.name;
+					TextureLoaded(newTex, path.c_str());
+				} else {
+					// the user has moved on in the meantime
+					if(dropCPUDataAfterUpload) {
+						newTex.ReleaseCPUData();
+					}
+					texCache.Put(newTex);
+				}
+			}
+		}
+
+		ContinueTextureUpload();
+
 		if (glfwGetWindowAttrib(glfwWindow, GLFW_ICONIFIED) != 0)
 		{
 			ImGui_ImplGlfw_Sleep(32);
 			continue;
 		}
 
+		if(!NeedRedraw()) {
+			continue;
+		}
+
 		GenericFrame(glfwWindow);
 
 		ImGuiFrame(glfwWindow);
 
 		glfwSwapBuffers(glfwWindow);
+		++frameCounter;
+	}
+
+	texLoader.Shutdown();
+	fileWatcher.Shutdown();
+	uploadThread.Shutdown();
+	if(uploadWindow != nullptr) {
+		glfwDestroyWindow(uploadWindow);
 	}
 
-	if(shaderProgram != 0) { // if we already had one and want to replace it
-		glDeleteProgram(shaderProgram);
+	ClearShaderProgramCache();
+	if(quadVAO != 0) {
+		glDeleteVertexArrays(1, &quadVAO);
+		glDeleteBuffers(1, &quadInstanceVBO);
 	}
 
 	curTex.Clear(); // also frees opengl texture which must happen before shutdown
+	texCache.Clear(); // same
+	uploadRing.Shutdown(); // same for the PBO
 
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
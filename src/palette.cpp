@@ -0,0 +1,610 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * Paletted (8bit indexed) images: Quake2 WAL, PCX and 8bit BMP and TGA.
+ * Instead of expanding them to RGBA (like stb_image does for BMP and TGA),
+ * they're uploaded as GL_R8 textures with the palette in a separate 256x1 texture,
+ * the lookup happens in the fragment shader (see UpdateShaders() in main.cpp).
+ * That way the palette can be replaced without loading or decoding the image again.
+ */
+
+#include <glad/gl.h>
+
+#include "texview.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+
+#ifdef _WIN32
+	#define strcasecmp _stricmp
+#endif
+
+namespace texview {
+
+static inline uint32_t PackColor(uint32_t r, uint32_t g, uint32_t b, uint32_t a = 255)
+{
+	// so the bytes in memory are R, G, B, A
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static inline uint32_t ReadU16(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t ReadU32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+static bool HasExtension(const char* filename, const char* ext)
+{
+	const char* dot = strrchr(filename, '.');
+	return dot != nullptr && strcasecmp(dot + 1, ext) == 0;
+}
+
+void GetGrayscalePalette(std::vector<uint32_t>& colors)
+{
+	colors.resize(256);
+	for(uint32_t i=0; i < 256; ++i) {
+		colors[i] = PackColor(i, i, i);
+	}
+}
+
+// loads a file that might be inside an archive (like LoadFile() in texload.cpp does),
+// returns NULL (without complaining) if it doesn't exist
+static MemMappedFile* LoadFileIfExists(const char* path)
+{
+	std::string archivePath, innerPath;
+	if(SplitArchivePath(path, archivePath, innerPath)) {
+		if(!GetArchivedFileSizeAndModTime(path, nullptr, nullptr)) {
+			return nullptr;
+		}
+		return LoadArchivedFile(archivePath.c_str(), innerPath.c_str());
+	}
+	if(!GetFileSizeAndModTime(path, nullptr, nullptr)) {
+		return nullptr;
+	}
+	return LoadMemMappedFile(path);
+}
+
+// PCX files with 256 colors have their palette at the end: 0x0C followed by 256 * RGB
+static bool GetPCXpalette(const unsigned char* data, size_t len, std::vector<uint32_t>& colors)
+{
+	if(len < 128 + 769 || data[0] != 0x0A) {
+		return false;
+	}
+	const unsigned char* pal = data + len - 769;
+	if(pal[0] != 0x0C) {
+		return false;
+	}
+	++pal;
+	colors.resize(256);
+	for(int i=0; i < 256; ++i) {
+		colors[i] = PackColor(pal[i*3], pal[i*3 + 1], pal[i*3 + 2]);
+	}
+	return true;
+}
+
+// JASC-PAL is a text format (used by Paint Shop Pro and some Quake tools):
+// "JASC-PAL", "0100", the number of colors, then one "R G B" line per color
+static bool ParseJascPalette(const unsigned char* data, size_t len, std::vector<uint32_t>& colors)
+{
+	std::string text((const char*)data, std::min(len, size_t(64 * 1024)));
+	const char* s = text.c_str();
+	if(strncmp(s, "JASC-PAL", 8) != 0) {
+		return false;
+	}
+	s += 8;
+	int version = 0, numColors = 0, n = 0;
+	if(sscanf(s, " %d %d%n", &version, &numColors, &n) != 2 || numColors <= 0 || numColors > 256) {
+		return false;
+	}
+	s += n;
+	colors.assign(256, PackColor(0, 0, 0));
+	for(int i=0; i < numColors; ++i) {
+		int r, g, b;
+		if(sscanf(s, " %d %d %d%n", &r, &g, &b, &n) != 3) {
+			return false;
+		}
+		s += n;
+		colors[i] = PackColor(r & 0xFF, g & 0xFF, b & 0xFF);
+	}
+	return true;
+}
+
+bool LoadPaletteFile(const char* path, std::vector<uint32_t>& colors)
+{
+	std::string absPath = ToAbsolutePath(path);
+	MemMappedFile* mmf = LoadFileIfExists(absPath.c_str());
+	if(mmf == nullptr) {
+		errprintf("Couldn't open palette file '%s'\n", path);
+		return false;
+	}
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	size_t len = mmf->length;
+	bool ok = false;
+	if(len == 768 || len == 772) {
+		// raw 256 * RGB, like Quake's gfx/palette.lmp (772 is Half-Life-style with a 4 byte trailer)
+		colors.resize(256);
+		for(int i=0; i < 256; ++i) {
+			colors[i] = PackColor(data[i*3], data[i*3 + 1], data[i*3 + 2]);
+		}
+		ok = true;
+	} else {
+		ok = ParseJascPalette(data, len, colors) || GetPCXpalette(data, len, colors);
+	}
+	UnloadMemMappedFile(mmf);
+	if(!ok) {
+		errprintf("'%s' is not a supported palette file (must be a 256 color PCX, JASC-PAL or 768 bytes of RGB)\n", path);
+	}
+	return ok;
+}
+
+// Quake2 has no palettes in its .wal textures, the game uses the one of pics/colormap.pcx.
+// Look for that in all the directories above the texture (and in the pak0.pak there),
+// so it's found for both baseq2/textures/e1u1/foo.wal and baseq2/pak0.pak/textures/e1u1/foo.wal
+static bool FindQuake2Palette(const char* walPath, std::vector<uint32_t>& colors, std::string& source)
+{
+	// usually lots of .wal files from the same directory are viewed one after the other
+	static std::mutex cacheMutex;
+	static std::string cachedDir;
+	static std::vector<uint32_t> cachedColors;
+	static std::string cachedSource;
+
+	std::string dir = walPath;
+	size_t lastSlash = dir.find_last_of("/\\");
+	if(lastSlash == std::string::npos) {
+		return false;
+	}
+	dir.resize(lastSlash);
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		if(dir == cachedDir) {
+			colors = cachedColors;
+			source = cachedSource;
+			return true;
+		}
+	}
+	static const char* candidates[] = { "/pics/colormap.pcx", "/pak0.pak/pics/colormap.pcx" };
+	for(std::string d = dir; !d.empty(); ) {
+		for(const char* c : candidates) {
+			std::string path = d + c;
+			MemMappedFile* mmf = LoadFileIfExists(path.c_str());
+			if(mmf == nullptr) {
+				continue;
+			}
+			bool ok = GetPCXpalette((const unsigned char*)mmf->data, mmf->length, colors);
+			UnloadMemMappedFile(mmf);
+			if(ok) {
+				source = path;
+				std::lock_guard<std::mutex> lock(cacheMutex);
+				cachedDir = dir;
+				cachedColors = colors;
+				cachedSource = source;
+				return true;
+			}
+		}
+		size_t slash = d.find_last_of("/\\");
+		if(slash == std::string::npos) {
+			break;
+		}
+		d.resize(slash);
+	}
+	return false;
+}
+
+// what the Parse*() functions below return
+struct IndexedImage {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	int numMips = 1;
+	// for WAL: the mip levels in the file, otherwise mipData[0] = pixels
+	const unsigned char* mipData[4] = {};
+	unsigned char* pixels = nullptr; // malloc()ed, if the image had to be decoded
+	std::vector<uint32_t> palette;
+	const char* formatName = "";
+};
+
+// Quake2 .wal: 100 byte header, followed by 4 mip levels
+static bool ParseWAL(const unsigned char* data, size_t len, const char* filename, IndexedImage& img)
+{
+	if(len < 100) {
+		errprintf("'%s' is too small to be a Quake2 .wal texture\n", filename);
+		return false;
+	}
+	// char name[32]; uint32_t width, height; uint32_t offsets[4]; char animname[32]; int flags, contents, value
+	img.width = ReadU32(data + 32);
+	img.height = ReadU32(data + 36);
+	if(img.width == 0 || img.height == 0 || img.width > 16384 || img.height > 16384) {
+		errprintf("'%s' has an invalid size (%u x %u) for a .wal texture\n", filename, img.width, img.height);
+		return false;
+	}
+	img.numMips = 0;
+	for(int i=0; i < 4; ++i) {
+		uint32_t w = std::max(img.width >> i, 1u);
+		uint32_t h = std::max(img.height >> i, 1u);
+		uint32_t ofs = ReadU32(data + 40 + 4*i);
+		if(ofs < 100 || ofs > len || len - ofs < size_t(w) * h) {
+			break;
+		}
+		img.mipData[i] = data + ofs;
+		img.numMips = i + 1;
+	}
+	if(img.numMips == 0) {
+		errprintf("'%s' is not a valid .wal texture (the pixel data is missing)\n", filename);
+		return false;
+	}
+	img.formatName = "Quake2 WAL (8bit indexed)";
+	return true;
+}
+
+static bool IsPCX(const unsigned char* data, size_t len)
+{
+	// manufacturer 0x0A, encoding 1 (RLE), 8 bits per pixel, 1 plane
+	return len >= 128 && data[0] == 0x0A && data[2] == 1 && data[3] == 8 && data[65] == 1;
+}
+
+static bool ParsePCX(const unsigned char* data, size_t len, const char* filename, bool decode, IndexedImage& img)
+{
+	img.width = ReadU16(data + 8) - ReadU16(data + 4) + 1;
+	img.height = ReadU16(data + 10) - ReadU16(data + 6) + 1;
+	uint32_t bytesPerLine = ReadU16(data + 66);
+	if(img.width == 0 || img.width > 0xFFFF || img.height == 0 || img.height > 0xFFFF || bytesPerLine < img.width) {
+		errprintf("'%s' has an invalid PCX header\n", filename);
+		return false;
+	}
+	if(!GetPCXpalette(data, len, img.palette)) {
+		errprintf("'%s' has no 256 color palette, only paletted 8bit PCX files are supported\n", filename);
+		return false;
+	}
+	img.formatName = "PCX (8bit indexed)";
+	if(!decode) {
+		return true;
+	}
+	img.pixels = (unsigned char*)malloc(size_t(img.width) * img.height);
+	if(img.pixels == nullptr) {
+		errprintf("Couldn't allocate memory to decode '%s'\n", filename);
+		return false;
+	}
+	// RLE: if the top two bits are set, the lower 6 bits are the count for the next byte.
+	// runs can continue into the next line (some encoders do that), so decode the lines
+	// as one stream and only copy the visible part (bytesPerLine can be bigger than the width)
+	const unsigned char* src = data + 128;
+	const unsigned char* srcEnd = data + len - 769;
+	uint32_t runLen = 0;
+	unsigned char runVal = 0;
+	for(uint32_t y=0; y < img.height; ++y) {
+		unsigned char* dst = img.pixels + size_t(y) * img.width;
+		for(uint32_t x=0; x < bytesPerLine; ++x) {
+			if(runLen == 0) {
+				if(src >= srcEnd) {
+					errprintf("'%s' is truncated (the pixel data ends in line %u)\n", filename, y);
+					free(img.pixels);
+					img.pixels = nullptr;
+					return false;
+				}
+				unsigned char c = *src++;
+				if((c & 0xC0) == 0xC0 && src < srcEnd) {
+					runLen = c & 0x3F;
+					runVal = *src++;
+				} else {
+					runLen = 1;
+					runVal = c;
+				}
+				if(runLen == 0) {
+					continue;
+				}
+			}
+			if(x < img.width) {
+				dst[x] = runVal;
+			}
+			--runLen;
+		}
+	}
+	img.mipData[0] = img.pixels;
+	return true;
+}
+
+// only uncompressed 8bit BMPs, RLE8 and everything else is left to stb_image
+static bool IsBMP8(const unsigned char* data, size_t len)
+{
+	if(len < 14 + 40 || data[0] != 'B' || data[1] != 'M') {
+		return false;
+	}
+	uint32_t infoSize = ReadU32(data + 14);
+	return infoSize >= 40 && ReadU16(data + 14 + 14) == 8 /* bit count */
+	       && ReadU32(data + 14 + 16) == 0; /* compression: BI_RGB */
+}
+
+static bool ParseBMP8(const unsigned char* data, size_t len, const char* filename, bool decode, IndexedImage& img)
+{
+	uint32_t pixelOffset = ReadU32(data + 10);
+	uint32_t infoSize = ReadU32(data + 14);
+	int32_t w = (int32_t)ReadU32(data + 18);
+	int32_t h = (int32_t)ReadU32(data + 22);
+	uint32_t numColors = ReadU32(data + 14 + 32);
+	bool bottomUp = h > 0;
+	if(h < 0) {
+		h = -h;
+	}
+	if(numColors == 0 || numColors > 256) {
+		numColors = 256;
+	}
+	size_t palOffset = size_t(14) + infoSize;
+	uint32_t pitch = (uint32_t(w) + 3) & ~3u; // rows are padded to 4 bytes
+	if(w <= 0 || h <= 0 || w > 0xFFFF || h > 0xFFFF || palOffset + numColors * 4 > len
+	   || pixelOffset > len || (len - pixelOffset) / pitch < uint32_t(h)) {
+		errprintf("'%s' is not a valid 8bit BMP (or is truncated)\n", filename);
+		return false;
+	}
+	img.width = w;
+	img.height = h;
+	// the palette entries are B, G, R, reserved
+	img.palette.assign(256, PackColor(0, 0, 0));
+	const unsigned char* pal = data + palOffset;
+	for(uint32_t i=0; i < numColors; ++i) {
+		img.palette[i] = PackColor(pal[i*4 + 2], pal[i*4 + 1], pal[i*4]);
+	}
+	img.formatName = "BMP (8bit indexed)";
+	if(!decode) {
+		return true;
+	}
+	img.pixels = (unsigned char*)malloc(size_t(img.width) * img.height);
+	if(img.pixels == nullptr) {
+		errprintf("Couldn't allocate memory to decode '%s'\n", filename);
+		return false;
+	}
+	for(uint32_t y=0; y < img.height; ++y) {
+		uint32_t srcY = bottomUp ? (img.height - 1 - y) : y;
+		memcpy(img.pixels + size_t(y) * img.width, data + pixelOffset + size_t(srcY) * pitch, img.width);
+	}
+	img.mipData[0] = img.pixels;
+	return true;
+}
+
+// TGAs have no magic number, so this only checks if the header looks like a colormapped 8bit one
+static bool IsTGA8(const unsigned char* data, size_t len, const char* filename)
+{
+	if(len < 18 || !HasExtension(filename, "tga")) {
+		return false;
+	}
+	uint32_t firstEntry = ReadU16(data + 3);
+	uint32_t numEntries = ReadU16(data + 5);
+	// color map type 1, image type 1 (uncompressed) or 9 (RLE), 8 bits per pixel
+	return data[1] == 1 && (data[2] == 1 || data[2] == 9) && data[16] == 8
+	       && numEntries > 0 && firstEntry + numEntries <= 256
+	       && (data[7] == 15 || data[7] == 16 || data[7] == 24 || data[7] == 32);
+}
+
+static bool ParseTGA8(const unsigned char* data, size_t len, const char* filename, bool decode, IndexedImage& img)
+{
+	uint32_t idLength = data[0];
+	bool isRLE = data[2] == 9;
+	uint32_t firstEntry = ReadU16(data + 3);
+	uint32_t numEntries = ReadU16(data + 5);
+	uint32_t entryBits = data[7];
+	img.width = ReadU16(data + 12);
+	img.height = ReadU16(data + 14);
+	bool topDown = (data[17] & 0x20) != 0;
+	uint32_t entryBytes = (entryBits + 7) / 8;
+	size_t palOffset = 18 + idLength;
+	size_t pixelOffset = palOffset + numEntries * entryBytes;
+	if(img.width == 0 || img.height == 0 || pixelOffset > len) {
+		errprintf("'%s' is not a valid colormapped TGA (or is truncated)\n", filename);
+		return false;
+	}
+	img.palette.assign(256, PackColor(0, 0, 0));
+	const unsigned char* pal = data + palOffset;
+	for(uint32_t i=0; i < numEntries; ++i) {
+		const unsigned char* e = pal + i * entryBytes;
+		uint32_t c;
+		if(entryBytes == 2) {
+			// A1R5G5B5 (the alpha bit is usually garbage, so it's ignored, like most programs do)
+			uint32_t v = ReadU16(e);
+			uint32_t r = (v >> 10) & 31, g = (v >> 5) & 31, b = v & 31;
+			c = PackColor((r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2));
+		} else {
+			c = PackColor(e[2], e[1], e[0], (entryBytes == 4) ? e[3] : 255);
+		}
+		img.palette[firstEntry + i] = c;
+	}
+	img.formatName = isRLE ? "TGA RLE (8bit indexed)" : "TGA (8bit indexed)";
+	if(!decode) {
+		return true;
+	}
+	const size_t numPixels = size_t(img.width) * img.height;
+	img.pixels = (unsigned char*)malloc(numPixels);
+	if(img.pixels == nullptr) {
+		errprintf("Couldn't allocate memory to decode '%s'\n", filename);
+		return false;
+	}
+	const unsigned char* src = data + pixelOffset;
+	const unsigned char* srcEnd = data + len;
+	bool ok = true;
+	if(!isRLE) {
+		ok = size_t(srcEnd - src) >= numPixels;
+		if(ok) {
+			memcpy(img.pixels, src, numPixels);
+		}
+	} else {
+		// packets: header byte with the count - 1 in the lower 7 bits,
+		// if the top bit is set one value follows that's repeated, otherwise count values
+		for(size_t i=0; ok && i < numPixels; ) {
+			if(src >= srcEnd) {
+				ok = false;
+				break;
+			}
+			unsigned char hdr = *src++;
+			size_t count = std::min(size_t(hdr & 0x7F) + 1, numPixels - i);
+			if(hdr & 0x80) {
+				ok = src < srcEnd;
+				if(ok) {
+					memset(img.pixels + i, *src++, count);
+				}
+			} else {
+				ok = size_t(srcEnd - src) >= count;
+				if(ok) {
+					memcpy(img.pixels + i, src, count);
+					src += count;
+				}
+			}
+			i += count;
+		}
+	}
+	if(!ok) {
+		errprintf("'%s' is truncated\n", filename);
+		free(img.pixels);
+		img.pixels = nullptr;
+		return false;
+	}
+	if(!topDown) {
+		std::vector<unsigned char> tmp(img.width);
+		for(uint32_t y=0; y < img.height / 2; ++y) {
+			unsigned char* a = img.pixels + size_t(y) * img.width;
+			unsigned char* b = img.pixels + size_t(img.height - 1 - y) * img.width;
+			memcpy(tmp.data(), a, img.width);
+			memcpy(a, b, img.width);
+			memcpy(b, tmp.data(), img.width);
+		}
+	}
+	img.mipData[0] = img.pixels;
+	return true;
+}
+
+Texture::FileType Texture::GetIndexedFileType(const MemMappedFile* mmf, const char* filename)
+{
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	size_t len = mmf->length;
+	if(HasExtension(filename, "wal")) {
+		return FT_WAL; // no magic number, but nothing else has that extension
+	}
+	if(IsPCX(data, len)) {
+		return FT_PCX;
+	}
+	if(IsBMP8(data, len)) {
+		return FT_BMP;
+	}
+	if(IsTGA8(data, len, filename)) {
+		return FT_TGA;
+	}
+	return FT_NONE;
+}
+
+bool Texture::LoadIndexed(MemMappedFile* mmf, FileType type, const char* filename, LoadProgress* progress, bool infoOnly)
+{
+	if(progress != nullptr) {
+		progress->Set("Decoding");
+	}
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	size_t len = mmf->length;
+	IndexedImage img;
+	bool ok = false;
+	switch(type) {
+		case FT_WAL: ok = ParseWAL(data, len, filename, img); break;
+		case FT_PCX: ok = ParsePCX(data, len, filename, !infoOnly, img); break;
+		case FT_BMP: ok = ParseBMP8(data, len, filename, !infoOnly, img); break;
+		case FT_TGA: ok = ParseTGA8(data, len, filename, !infoOnly, img); break;
+		default: break;
+	}
+	if(!ok || (progress != nullptr && progress->IsCancelled())) {
+		free(img.pixels);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+
+	name = filename;
+	fileType = type;
+	formatName = img.formatName;
+	glTarget = GL_TEXTURE_2D;
+	dataFormat = GL_R8;
+	glFormat = GL_RED;
+	glType = GL_UNSIGNED_BYTE;
+	unpackAlignment = 1;
+
+	if(type == FT_WAL) {
+		if(!infoOnly && !FindQuake2Palette(filename, img.palette, palette.source)) {
+			errprintf("Couldn't find pics/colormap.pcx for '%s', showing it in grayscale\n", filename);
+		}
+		// the mip levels are used directly from the file
+		texData = mmf;
+		texDataFreeFun = FreeMemMappedTexData;
+		cpuDataSize = mmf->length;
+	} else {
+		UnloadMemMappedFile(mmf);
+		if(img.pixels != nullptr) {
+			texData = img.pixels;
+			texDataFreeFun = [](void* texData, intptr_t) -> void { free(texData); };
+			cpuDataSize = size_t(img.width) * img.height;
+		}
+		palette.source = "embedded";
+	}
+	if(img.palette.empty()) {
+		GetGrayscalePalette(img.palette);
+		palette.source = "grayscale";
+	}
+	textureFlags = TF_INDEXED;
+	SetPalette(img.palette, palette.source.c_str());
+
+	elements.push_back( std::vector<MipLevel>() );
+	for(int i=0; i < img.numMips; ++i) {
+		uint32_t w = std::max(img.width >> i, 1u);
+		uint32_t h = std::max(img.height >> i, 1u);
+		elements[0].push_back( MipLevel(w, h, img.mipData[i], w * h) );
+	}
+	return true;
+}
+
+void Texture::SetPalette(const std::vector<uint32_t>& colors, const char* source)
+{
+	if(colors.size() != 256) {
+		return;
+	}
+	std::string src = source; // (source might be palette.source)
+	palette.colors = colors;
+	palette.source = std::move(src);
+	bool hasAlpha = false;
+	for(uint32_t c : colors) {
+		hasAlpha |= (c >> 24) != 255;
+	}
+	if(hasAlpha) {
+		textureFlags |= TF_HAS_ALPHA;
+	} else {
+		textureFlags &= ~TF_HAS_ALPHA;
+	}
+	if(palette.glHandle != 0) {
+		UploadPalette();
+	}
+}
+
+bool Texture::UploadPalette()
+{
+	if(palette.colors.size() != 256) {
+		return false;
+	}
+	if(palette.glHandle == 0) {
+		glGenTextures(1, &palette.glHandle);
+		glBindTexture(GL_TEXTURE_2D, palette.glHandle);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette.colors.data());
+	} else {
+		glBindTexture(GL_TEXTURE_2D, palette.glHandle);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, palette.colors.data());
+	}
+	GLenum e = glGetError();
+	if(e != GL_NO_ERROR) {
+		errprintf("Uploading the palette of '%s' failed, glGetError() says 0x%x\n", name.c_str(), e);
+		return false;
+	}
+	return true;
+}
+
+} //namespace texview
@@ -5,16 +5,35 @@
  */
 #include "texview.h"
 
+#include <dirent.h> // opendir()
 #include <fcntl.h> // open()
 #include <sys/stat.h>
 #include <sys/mman.h> // mmap()
+#include <sys/resource.h> // getrusage()
+#include <sys/time.h> // utimes()
 #include <unistd.h> // close()
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace texview {
 
+static int64_t GetModTime(const struct stat& st)
+{
+#ifdef __APPLE__
+	const struct timespec& ts = st.st_mtimespec;
+#else
+	const struct timespec& ts = st.st_mtim;
+#endif
+	return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 std::string ToAbsolutePath(const char* path)
 {
 	std::string ret;
@@ -35,6 +54,12 @@ std::string ToAbsolutePath(const char* path)
 	char* absPath = realpath(path, nullptr);
 #endif
 	if(absPath == nullptr) {
+		// paths to files inside archives (like foo.pk3/textures/bar.tga) aren't real paths,
+		// but the archive itself is
+		std::string archivePath, innerPath;
+		if(errno == ENOTDIR && SplitArchivePath(path, archivePath, innerPath)) {
+			return ToAbsolutePath(archivePath.c_str()) + '/' + innerPath;
+		}
 		errprintf("realpath(%s, NULL) failed?!\n", path);
 		ret = path;
 	} else {
@@ -46,7 +71,111 @@ std::string ToAbsolutePath(const char* path)
 	return ret;
 }
 
-MemMappedFile* LoadMemMappedFile(const char* filename)
+// reads size bytes from the start of the (regular) file into buf.
+// big files are read in chunks by several threads, which is a lot faster
+// than one big read() on network filesystems (and doesn't hurt on local disks)
+static bool ReadFileChunks(int fd, void* buf, size_t size, const char* filename)
+{
+	const size_t chunkSize = 8 * 1024 * 1024;
+	const size_t numChunks = (size + chunkSize - 1) / chunkSize;
+	const size_t maxThreads = std::min(8u, std::max(1u, std::thread::hardware_concurrency()));
+	const size_t numThreads = std::min(numChunks, maxThreads);
+
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<bool> failed(false);
+	auto readFun = [&]() {
+		size_t chunk;
+		while(!failed && (chunk = nextChunk++) < numChunks) {
+			size_t offset = chunk * chunkSize;
+			size_t len = std::min(chunkSize, size - offset);
+			while(len > 0) {
+				ssize_t r = pread(fd, (char*)buf + offset, len, offset);
+				if(r < 0 && errno == EINTR) {
+					continue;
+				}
+				if(r <= 0) {
+					if(r == 0) {
+						errprintf("Couldn't read '%s': it got shorter while reading\n", filename);
+					} else {
+						errprintf("Couldn't read '%s': %d - %s\n", filename, errno, strerror(errno));
+					}
+					failed = true;
+					break;
+				}
+				offset += r;
+				len -= r;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for(size_t i=1; i < numThreads; ++i) {
+		threads.push_back(std::thread(readFun));
+	}
+	readFun(); // this thread helps as well
+	for(std::thread& t : threads) {
+		t.join();
+	}
+	return !failed;
+}
+
+// for pipes, character devices etc that don't know their size in advance.
+// the buffer grows in big steps, dataFun (if set) is called after each read()
+static MemMappedFile* ReadStream(int fd, const char* filename, StreamDataFun dataFun, void* user)
+{
+	size_t capacity = 1024 * 1024;
+	size_t size = 0;
+	char* buf = (char*)malloc(capacity);
+	while(buf != nullptr) {
+		if(size == capacity) {
+			capacity *= 2;
+			char* newBuf = (char*)realloc(buf, capacity);
+			if(newBuf == nullptr) {
+				errprintf("Couldn't allocate %zu bytes to read '%s'\n", capacity, filename);
+				break;
+			}
+			buf = newBuf;
+		}
+		ssize_t r = read(fd, buf + size, capacity - size);
+		if(r < 0 && errno == EINTR) {
+			continue;
+		}
+		if(r < 0) {
+			errprintf("Couldn't read '%s': %d - %s\n", filename, errno, strerror(errno));
+			break;
+		}
+		size += r;
+		if(dataFun != nullptr && !dataFun(buf, size, r == 0, user)) {
+			break;
+		}
+		if(r == 0) {
+			if(size == 0) {
+				errprintf("Can't load '%s', it's empty!\n", filename);
+				break;
+			}
+			MemMappedFile* ret = new MemMappedFile;
+			ret->data = ret->readBuffer = buf;
+			ret->length = size;
+			return ret;
+		}
+	}
+	free(buf);
+	return nullptr;
+}
+
+MemMappedFile* ReadStdin(StreamDataFun dataFun, void* user)
+{
+	return ReadStream(STDIN_FILENO, "stdin", dataFun, user);
+}
+
+bool IsStdinRedirected()
+{
+	// when started from a desktop environment, stdin is often /dev/null,
+	// that's not supposed to be loaded, but pipes and regular files are
+	struct stat st = {};
+	return fstat(STDIN_FILENO, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISREG(st.st_mode));
+}
+
+MemMappedFile* LoadMemMappedFile(const char* filename, FileIOBackend backend, uint32_t hints)
 {
 	int fd = open(filename, O_RDONLY);
 	if(fd == -1) {
@@ -60,28 +189,76 @@ MemMappedFile* LoadMemMappedFile(const char* filename)
 		close(fd);
 		return nullptr;
 	}
-	if(!S_ISREG(st.st_mode)) {
-		errprintf("Can't load '%s', it's not a regular file! mode: 0x%x\n", filename, st.st_mode & S_IFMT);
+	if(S_ISDIR(st.st_mode)) {
+		errprintf("Can't load '%s', it's a directory!\n", filename);
 		close(fd);
 		return nullptr;
 	}
+	if(!S_ISREG(st.st_mode)) {
+		// pipes and the like can't be mapped, so just read everything
+		MemMappedFile* ret = ReadStream(fd, filename, nullptr, nullptr);
+		close(fd);
+		if(ret != nullptr) {
+			ret->modTime = GetModTime(st);
+		}
+		return ret;
+	}
 	if(st.st_size <= 0) {
 		errprintf("Can't load '%s', stat reports invalid size %ld!\n", filename, st.st_size);
 		close(fd);
 		return nullptr;
 	}
 
-	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(backend == FIO_READ) {
+		void* buf = malloc(st.st_size);
+		if(buf == nullptr) {
+			errprintf("Couldn't allocate %zu bytes to read '%s'\n", (size_t)st.st_size, filename);
+			close(fd);
+			return nullptr;
+		}
+		bool ok = ReadFileChunks(fd, buf, st.st_size, filename);
+		close(fd);
+		if(!ok) {
+			free(buf);
+			return nullptr;
+		}
+		MemMappedFile* ret = new MemMappedFile;
+		ret->data = ret->readBuffer = buf;
+		ret->length = st.st_size;
+		ret->modTime = GetModTime(st);
+		return ret;
+	}
+
+	int mapFlags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	if(hints & MMH_POPULATE) {
+		mapFlags |= MAP_POPULATE;
+	}
+#endif
+	void* data = mmap(NULL, st.st_size, PROT_READ, mapFlags, fd, 0);
 	if(data == MAP_FAILED) {
 		errprintf("Can't mmap() '%s': %d - %s\n", filename, errno, strerror(errno));
 		close(fd);
 		return nullptr;
 	}
+	// these are just hints, so errors are ignored
+	if(hints & MMH_SEQUENTIAL) {
+		madvise(data, st.st_size, MADV_SEQUENTIAL);
+	}
+	if(hints & MMH_WILLNEED) {
+		madvise(data, st.st_size, MADV_WILLNEED);
+	}
+#ifdef MADV_HUGEPAGE
+	if(hints & MMH_HUGEPAGE) {
+		madvise(data, st.st_size, MADV_HUGEPAGE);
+	}
+#endif
 
 	MemMappedFile* ret = new MemMappedFile;
 
 	ret->data = data;
 	ret->length = st.st_size;
+	ret->modTime = GetModTime(st);
 	ret->fd = fd;
 
 	return ret;
@@ -89,7 +266,13 @@ MemMappedFile* LoadMemMappedFile(const char* filename)
 
 void UnloadMemMappedFile(MemMappedFile* mmf)
 {
-	if(mmf->data != nullptr) {
+	if(mmf->archive != nullptr) {
+		ReleaseArchivedFile(mmf);
+		return;
+	}
+	if(mmf->readBuffer != nullptr) {
+		free(mmf->readBuffer);
+	} else if(mmf->data != nullptr) {
 		munmap((void*)mmf->data, mmf->length);
 	}
 	if(mmf->fd >= 0) {
@@ -98,4 +281,188 @@ void UnloadMemMappedFile(MemMappedFile* mmf)
 	delete mmf;
 }
 
+void ReadAheadMemMappedFile(const MemMappedFile* mmf, size_t offset, size_t length)
+{
+	if((GetMemMapHints() & MMH_READAHEAD) == 0 || mmf->readBuffer != nullptr || offset >= mmf->length) {
+		return; // (if it has been read, it's already in memory)
+	}
+	length = std::min(length, mmf->length - offset);
+#ifdef __linux__
+	// unlike madvise() this doesn't need a page-aligned address and doesn't block
+	// (at least on some filesystems MADV_WILLNEED waits for the first pages)
+	// files in archives don't have their own fd though, they're just a part of the archive's mapping
+	if(mmf->fd >= 0) {
+		readahead(mmf->fd, offset, length);
+		return;
+	}
+#endif
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t alignedOffset = offset - (offset % pageSize);
+	madvise((char*)mmf->data + alignedOffset, length + (offset - alignedOffset), MADV_WILLNEED);
+}
+
+bool GetPageFaultCounts(PageFaultCounts& counts)
+{
+#ifdef RUSAGE_THREAD
+	const int who = RUSAGE_THREAD; // Linux
+#else
+	const int who = RUSAGE_SELF;
+#endif
+	struct rusage ru = {};
+	if(getrusage(who, &ru) != 0) {
+		return false;
+	}
+	counts.minor = ru.ru_minflt;
+	counts.major = ru.ru_majflt;
+	return true;
+}
+
+bool GetFileSizeAndModTime(const char* path, uint64_t* size, int64_t* modTime)
+{
+	struct stat st = {};
+	if(stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+		return false;
+	}
+	if(size != nullptr) {
+		*size = st.st_size;
+	}
+	if(modTime != nullptr) {
+		*modTime = GetModTime(st);
+	}
+	return true;
+}
+
+bool ListDirectory(const char* dirPath, std::vector<std::string>& fileNames,
+                   std::vector<std::string>* dirNames)
+{
+	DIR* dir = opendir(dirPath);
+	if(dir == nullptr) {
+		errprintf("Couldn't open directory '%s': %d - %s\n", dirPath, errno, strerror(errno));
+		return false;
+	}
+	std::string path;
+	while(struct dirent* ent = readdir(dir)) {
+		if(ent->d_type == DT_DIR) {
+			if(dirNames != nullptr && strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+				dirNames->push_back(ent->d_name);
+			}
+			continue;
+		}
+		if(ent->d_type != DT_REG) {
+			// might be a symlink to a file, or a filesystem that doesn't set d_type
+			// (symlinks to directories are not followed, to avoid loops)
+			path = dirPath;
+			path += '/';
+			path += ent->d_name;
+			struct stat st = {};
+			if(ent->d_type == DT_UNKNOWN && dirNames != nullptr && lstat(path.c_str(), &st) == 0
+			   && S_ISDIR(st.st_mode)) {
+				dirNames->push_back(ent->d_name);
+				continue;
+			}
+			if(stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+				continue;
+			}
+		}
+		fileNames.push_back(ent->d_name);
+	}
+	closedir(dir);
+	return true;
+}
+
+// like mkdir -p
+static bool CreateDirectories(const std::string& path)
+{
+	struct stat st = {};
+	if(stat(path.c_str(), &st) == 0) {
+		return S_ISDIR(st.st_mode);
+	}
+	size_t lastSlash = path.find_last_of('/');
+	if(lastSlash != std::string::npos && lastSlash > 0) {
+		if(!CreateDirectories(path.substr(0, lastSlash))) {
+			return false;
+		}
+	}
+	if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+		errprintf("Couldn't create directory '%s': %d - %s\n", path.c_str(), errno, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+static std::string InitCacheDir()
+{
+	std::string dir;
+#ifdef __APPLE__
+	const char* home = getenv("HOME");
+	if(home != nullptr && home[0] != '\0') {
+		dir = home;
+		dir += "/Library/Caches/texview";
+	}
+#else
+	const char* xdgCache = getenv("XDG_CACHE_HOME");
+	const char* home = getenv("HOME");
+	if(xdgCache != nullptr && xdgCache[0] == '/') {
+		dir = xdgCache;
+		dir += "/texview";
+	} else if(home != nullptr && home[0] != '\0') {
+		dir = home;
+		dir += "/.cache/texview";
+	}
+#endif
+	if(dir.empty()) {
+		errprintf("Couldn't determine cache directory, HOME is not set?!\n");
+	} else if(!CreateDirectories(dir)) {
+		dir.clear();
+	}
+	return dir;
+}
+
+std::string GetCacheDir()
+{
+	// called from the loader threads as well, initializing a function-local
+	// static is thread-safe (since C++11), so it's only done once
+	static const std::string cacheDir = InitCacheDir();
+	return cacheDir;
+}
+
+bool WriteWholeFile(const char* path, const DataChunk* chunks, size_t numChunks)
+{
+	std::string tmpPath(path);
+	tmpPath += ".tmp";
+	FILE* f = fopen(tmpPath.c_str(), "wb");
+	if(f == nullptr) {
+		errprintf("Couldn't open '%s' for writing: %d - %s\n", tmpPath.c_str(), errno, strerror(errno));
+		return false;
+	}
+	bool ok = true;
+	for(size_t i=0; i < numChunks && ok; ++i) {
+		ok = fwrite(chunks[i].data, 1, chunks[i].size, f) == chunks[i].size;
+	}
+	ok = (fclose(f) == 0) && ok;
+	if(!ok || rename(tmpPath.c_str(), path) != 0) {
+		errprintf("Couldn't write '%s': %d - %s\n", path, errno, strerror(errno));
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool WriteWholeFile(const char* path, const void* data, size_t size)
+{
+	DataChunk chunk = { data, size };
+	return WriteWholeFile(path, &chunk, 1);
+}
+
+bool RemoveFile(const char* path)
+{
+	return unlink(path) == 0;
+}
+
+bool TouchFile(const char* path)
+{
+	// NULL => set access and modification time to now
+	return utimes(path, nullptr) == 0;
+}
+
 } //namespace texview
@@ -8,10 +8,17 @@
  * zlib license, see below and/or Licenses.txt
  */
 
+#define NOMINMAX // so std::min() and std::max() work
 #include "windows.h"
 
 #include "texview.h"
 
+#include <stdlib.h> // _wgetenv()
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace texview {
 
 // remember to free() the returned buffer!
@@ -72,13 +79,180 @@ std::string ToAbsolutePath(const char* path)
 }
 
 
-MemMappedFile* LoadMemMappedFile(const char* filename)
+// PrefetchVirtualMemory() only exists since Windows 8, so it's looked up at runtime.
+// (WIN32_MEMORY_RANGE_ENTRY is only defined if _WIN32_WINNT is high enough, so it has its own definition)
+struct TV_MemoryRangeEntry {
+	PVOID VirtualAddress;
+	SIZE_T NumberOfBytes;
+};
+typedef BOOL (WINAPI *PrefetchVirtualMemoryFun)(HANDLE hProcess, ULONG_PTR numEntries, TV_MemoryRangeEntry* entries, ULONG flags);
+
+static void PrefetchMemory(const void* data, size_t length)
+{
+	static PrefetchVirtualMemoryFun prefetchVirtualMemory = (PrefetchVirtualMemoryFun)(void*)
+		GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory");
+	if (prefetchVirtualMemory != nullptr) {
+		TV_MemoryRangeEntry range = { (PVOID)data, length };
+		prefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+}
+
+// reads size bytes from the start of the file into buf, big files in chunks
+// by several threads (faster on network shares), like in sys_posix.cpp
+static bool ReadFileChunks(HANDLE fileHandle, void* buf, size_t size, const char* filename)
+{
+	const size_t chunkSize = 8 * 1024 * 1024;
+	const size_t numChunks = (size + chunkSize - 1) / chunkSize;
+	const size_t maxThreads = std::min(8u, std::max(1u, std::thread::hardware_concurrency()));
+	const size_t numThreads = std::min(numChunks, maxThreads);
+
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<bool> failed(false);
+	auto readFun = [&]() {
+		size_t chunk;
+		while (!failed && (chunk = nextChunk++) < numChunks) {
+			size_t offset = chunk * chunkSize;
+			size_t len = std::min(chunkSize, size - offset);
+			while (len > 0) {
+				// with an OVERLAPPED, ReadFile() reads at the given offset without
+				// using (or changing) the shared file pointer
+				OVERLAPPED ov = {};
+				ov.Offset = DWORD(offset & 0xFFFFFFFF);
+				ov.OffsetHigh = DWORD(uint64_t(offset) >> 32);
+				DWORD numRead = 0;
+				if (!ReadFile(fileHandle, (char*)buf + offset, (DWORD)len, &numRead, &ov) || numRead == 0) {
+					errprintf("Couldn't read '%s'! GetLastError(): %d\n", filename, GetLastError());
+					failed = true;
+					break;
+				}
+				offset += numRead;
+				len -= numRead;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < numThreads; ++i) {
+		threads.push_back(std::thread(readFun));
+	}
+	readFun(); // this thread helps as well
+	for (std::thread& t : threads) {
+		t.join();
+	}
+	return !failed;
+}
+
+// for pipes and the like that can't be mapped and don't know their size in advance.
+// dataFun (if set) is called after each ReadFile()
+static void* ReadWholeStream(HANDLE fileHandle, size_t* outSize, const char* filename,
+                             StreamDataFun dataFun = nullptr, void* user = nullptr)
+{
+	size_t capacity = 1024 * 1024;
+	size_t size = 0;
+	char* buf = (char*)malloc(capacity);
+	while (buf != nullptr) {
+		if (size == capacity) {
+			capacity *= 2;
+			char* newBuf = (char*)realloc(buf, capacity);
+			if (newBuf == nullptr) {
+				errprintf("Couldn't allocate %zu bytes to read '%s'\n", capacity, filename);
+				break;
+			}
+			buf = newBuf;
+		}
+		DWORD toRead = (DWORD)std::min(capacity - size, size_t(1) << 30);
+		DWORD numRead = 0;
+		if (!ReadFile(fileHandle, buf + size, toRead, &numRead, NULL)) {
+			if (GetLastError() == ERROR_BROKEN_PIPE) {
+				numRead = 0; // that's how the end of a pipe is reported
+			} else {
+				errprintf("Couldn't read '%s'! GetLastError(): %d\n", filename, GetLastError());
+				break;
+			}
+		}
+		size += numRead;
+		if (dataFun != nullptr && !dataFun(buf, size, numRead == 0, user)) {
+			break;
+		}
+		if (numRead == 0) {
+			*outSize = size;
+			return buf;
+		}
+	}
+	free(buf);
+	return nullptr;
+}
+
+MemMappedFile* ReadStdin(StreamDataFun dataFun, void* user)
+{
+	size_t size = 0;
+	void* buf = ReadWholeStream(GetStdHandle(STD_INPUT_HANDLE), &size, "stdin", dataFun, user);
+	if (buf == nullptr) {
+		return nullptr;
+	}
+	if (size == 0) {
+		errprintf("Can't load stdin, it's empty!\n");
+		free(buf);
+		return nullptr;
+	}
+	MemMappedFile* ret = new MemMappedFile;
+	ret->data = ret->readBuffer = buf;
+	ret->length = size;
+	return ret;
+}
+
+bool IsStdinRedirected()
+{
+	HANDLE h = GetStdHandle(STD_INPUT_HANDLE);
+	if (h == NULL || h == INVALID_HANDLE_VALUE) {
+		return false; // no console, nothing redirected
+	}
+	DWORD type = GetFileType(h);
+	return type == FILE_TYPE_PIPE || type == FILE_TYPE_DISK;
+}
+
+// for FIO_READ and files that can't be mapped. Closes fileHandle
+static MemMappedFile* ReadWholeFile(HANDLE fileHandle, bool isDiskFile, size_t size, const char* filename)
+{
+	void* buf = nullptr;
+	if (isDiskFile) {
+		buf = malloc(size);
+		if (buf == nullptr) {
+			errprintf("Couldn't allocate %zu bytes to read '%s'\n", size, filename);
+		} else if (!ReadFileChunks(fileHandle, buf, size, filename)) {
+			free(buf);
+			buf = nullptr;
+		}
+	} else {
+		buf = ReadWholeStream(fileHandle, &size, filename);
+	}
+	FILETIME modTime = {};
+	GetFileTime(fileHandle, NULL, NULL, &modTime);
+	CloseHandle(fileHandle);
+	if (buf == nullptr) {
+		return nullptr;
+	}
+	if (size == 0) {
+		errprintf("Can't load '%s', it's empty!\n", filename);
+		free(buf);
+		return nullptr;
+	}
+	MemMappedFile* ret = new MemMappedFile;
+	ret->data = ret->readBuffer = buf;
+	ret->length = size;
+	ret->modTime = (int64_t(modTime.dwHighDateTime) << 32) | modTime.dwLowDateTime;
+	return ret;
+}
+
+MemMappedFile* LoadMemMappedFile(const char* filename, FileIOBackend backend, uint32_t hints)
 {
 	HANDLE fileHandle = INVALID_HANDLE_VALUE;
+	// MMH_POPULATE and MMH_HUGEPAGE have no equivalent for mapped files on Windows,
+	// MMH_SEQUENTIAL at least makes the cache manager read ahead more aggressively
+	const DWORD accessFlag = (hints & MMH_SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
 	// convert filename to WCHAR and try to open the file
 	{
 		WCHAR* wFilename = Utf8ToUtf16(filename);
-		fileHandle = CreateFileW(wFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+		fileHandle = CreateFileW(wFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, accessFlag, NULL);
 		if (fileHandle == INVALID_HANDLE_VALUE) {
 			errprintf("Couldn't open '%s'! GetLastError(): %d\n", filename, GetLastError());
 			free(wFilename);
@@ -87,6 +261,11 @@ MemMappedFile* LoadMemMappedFile(const char* filename)
 		free(wFilename);
 	}
 
+	if (GetFileType(fileHandle) != FILE_TYPE_DISK) {
+		// pipes and the like can't be mapped, so just read everything
+		return ReadWholeFile(fileHandle, false, 0, filename);
+	}
+
 	LARGE_INTEGER size = { 0 };
 	if (!GetFileSizeEx(fileHandle, &size)) {
 		errprintf("Couldn't get size of file '%s'!\n", filename);
@@ -99,6 +278,10 @@ MemMappedFile* LoadMemMappedFile(const char* filename)
 		return nullptr;
 	}
 
+	if (backend == FIO_READ) {
+		return ReadWholeFile(fileHandle, true, size.QuadPart, filename);
+	}
+
 	// create file mapping object
 	HANDLE fileMapping = CreateFileMappingW(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
 	if (fileMapping == NULL) {
@@ -116,9 +299,17 @@ MemMappedFile* LoadMemMappedFile(const char* filename)
 		return nullptr;
 	}
 
+	if (hints & (MMH_POPULATE | MMH_WILLNEED)) {
+		PrefetchMemory(data, size.QuadPart);
+	}
+
+	FILETIME modTime = {};
+	GetFileTime(fileHandle, NULL, NULL, &modTime);
+
 	MemMappedFile* ret = new MemMappedFile;
 	ret->data = data;
 	ret->length = size.QuadPart;
+	ret->modTime = (int64_t(modTime.dwHighDateTime) << 32) | modTime.dwLowDateTime;
 	ret->fileHandle = fileHandle;
 	ret->mappingObjectHandle = fileMapping;
 
@@ -127,10 +318,14 @@ MemMappedFile* LoadMemMappedFile(const char* filename)
 
 void UnloadMemMappedFile(MemMappedFile* mmf)
 {
-	if (mmf != nullptr) {
+	if (mmf != nullptr && mmf->archive != nullptr) {
+		ReleaseArchivedFile(mmf);
+	} else if (mmf != nullptr) {
 		HANDLE fh = (HANDLE)mmf->fileHandle;
 		HANDLE moh = (HANDLE)mmf->mappingObjectHandle;
-		if (mmf->data != nullptr) {
+		if (mmf->readBuffer != nullptr) {
+			free(mmf->readBuffer);
+		} else if (mmf->data != nullptr) {
 			UnmapViewOfFile(mmf->data);
 		}
 		if (moh != NULL) {
@@ -143,6 +338,188 @@ void UnloadMemMappedFile(MemMappedFile* mmf)
 	}
 }
 
+bool GetFileSizeAndModTime(const char* path, uint64_t* size, int64_t* modTime)
+{
+	WCHAR* wPath = Utf8ToUtf16(path);
+	if (wPath == nullptr) {
+		return false;
+	}
+	WIN32_FILE_ATTRIBUTE_DATA attr = {};
+	BOOL ok = GetFileAttributesExW(wPath, GetFileExInfoStandard, &attr);
+	free(wPath);
+	if (!ok || (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return false;
+	}
+	if (size != nullptr) {
+		*size = (uint64_t(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+	}
+	if (modTime != nullptr) {
+		*modTime = (int64_t(attr.ftLastWriteTime.dwHighDateTime) << 32) | attr.ftLastWriteTime.dwLowDateTime;
+	}
+	return true;
+}
+
+bool ListDirectory(const char* dirPath, std::vector<std::string>& fileNames,
+                   std::vector<std::string>* dirNames)
+{
+	std::string pattern(dirPath);
+	pattern += "\\*";
+	WCHAR* wPattern = Utf8ToUtf16(pattern.c_str());
+	if (wPattern == nullptr) {
+		return false;
+	}
+	WIN32_FIND_DATAW fd = {};
+	HANDLE findHandle = FindFirstFileW(wPattern, &fd);
+	free(wPattern);
+	if (findHandle == INVALID_HANDLE_VALUE) {
+		errprintf("Couldn't open directory '%s'! GetLastError(): %d\n", dirPath, GetLastError());
+		return false;
+	}
+	do {
+		bool isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		if (isDir && (dirNames == nullptr || wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0
+		              || (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))) {
+			// skip . and .. and junctions/symlinks to directories (to avoid loops)
+			continue;
+		}
+		char* name = Utf16ToUtf8(fd.cFileName);
+		if (name != nullptr) {
+			if (isDir) {
+				dirNames->push_back(name);
+			} else {
+				fileNames.push_back(name);
+			}
+			free(name);
+		}
+	} while (FindNextFileW(findHandle, &fd));
+	FindClose(findHandle);
+	return true;
+}
+
+static std::string InitCacheDir()
+{
+	std::string cacheDir;
+	const wchar_t* localAppData = _wgetenv(L"LOCALAPPDATA");
+	if (localAppData == nullptr || localAppData[0] == L'\0') {
+		errprintf("Couldn't determine cache directory, LOCALAPPDATA is not set?!\n");
+		return cacheDir;
+	}
+	std::wstring wDir(localAppData);
+	wDir += L"\\texview";
+	if (!CreateDirectoryW(wDir.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) {
+		errprintf("Couldn't create cache directory! GetLastError(): %d\n", GetLastError());
+		return cacheDir;
+	}
+	char* dir = Utf16ToUtf8(wDir.c_str());
+	if (dir != nullptr) {
+		cacheDir = dir;
+		free(dir);
+	}
+	return cacheDir;
+}
+
+std::string GetCacheDir()
+{
+	// called from the loader threads as well, initializing a function-local
+	// static is thread-safe (since C++11), so it's only done once
+	static const std::string cacheDir = InitCacheDir();
+	return cacheDir;
+}
+
+bool WriteWholeFile(const char* path, const DataChunk* chunks, size_t numChunks)
+{
+	std::string tmpPath(path);
+	tmpPath += ".tmp";
+	WCHAR* wTmpPath = Utf8ToUtf16(tmpPath.c_str());
+	WCHAR* wPath = Utf8ToUtf16(path);
+	if (wTmpPath == nullptr || wPath == nullptr) {
+		free(wTmpPath);
+		free(wPath);
+		return false;
+	}
+	bool ok = false;
+	HANDLE fh = CreateFileW(wTmpPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fh != INVALID_HANDLE_VALUE) {
+		ok = true;
+		for (size_t i = 0; i < numChunks && ok; ++i) {
+			const char* dataPtr = (const char*)chunks[i].data;
+			size_t size = chunks[i].size;
+			while (ok && size > 0) {
+				DWORD toWrite = (DWORD)std::min(size, (size_t)1 << 30);
+				DWORD written = 0;
+				ok = WriteFile(fh, dataPtr, toWrite, &written, nullptr) && written == toWrite;
+				dataPtr += written;
+				size -= written;
+			}
+		}
+		CloseHandle(fh);
+		ok = ok && MoveFileExW(wTmpPath, wPath, MOVEFILE_REPLACE_EXISTING);
+	}
+	if (!ok) {
+		errprintf("Couldn't write '%s'! GetLastError(): %d\n", path, GetLastError());
+		DeleteFileW(wTmpPath);
+	}
+	free(wTmpPath);
+	free(wPath);
+	return ok;
+}
+
+bool WriteWholeFile(const char* path, const void* data, size_t size)
+{
+	DataChunk chunk = { data, size };
+	return WriteWholeFile(path, &chunk, 1);
+}
+
+bool RemoveFile(const char* path)
+{
+	WCHAR* wPath = Utf8ToUtf16(path);
+	if (wPath == nullptr) {
+		return false;
+	}
+	// fails if the file is still mapped somewhere, that's ok
+	BOOL ok = DeleteFileW(wPath);
+	free(wPath);
+	return ok != FALSE;
+}
+
+void ReadAheadMemMappedFile(const MemMappedFile* mmf, size_t offset, size_t length)
+{
+	if ((GetMemMapHints() & MMH_READAHEAD) == 0 || mmf->readBuffer != nullptr || offset >= mmf->length) {
+		return;
+	}
+	if (length > mmf->length - offset) {
+		length = mmf->length - offset;
+	}
+	PrefetchMemory((const char*)mmf->data + offset, length);
+}
+
+bool GetPageFaultCounts(PageFaultCounts& counts)
+{
+	// Windows only has a per-process count (GetProcessMemoryInfo()) that doesn't
+	// tell soft faults from hard faults, so that's not useful for comparing the hints
+	(void)counts;
+	return false;
+}
+
+bool TouchFile(const char* path)
+{
+	WCHAR* wPath = Utf8ToUtf16(path);
+	if (wPath == nullptr) {
+		return false;
+	}
+	HANDLE fh = CreateFileW(wPath, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+	                        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	free(wPath);
+	if (fh == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	BOOL ok = SetFileTime(fh, nullptr, nullptr, &now);
+	CloseHandle(fh);
+	return ok != FALSE;
+}
+
 } //namespace texview
 
 // For WinMain() I stole some code from SDL_main/SDL_RunApp() to convert
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ */
+
+#include "texview.h"
+
+namespace texview {
+
+void TextureCache::SetBudget(size_t bytes)
+{
+	budget = bytes;
+	EvictToBudget(budget);
+}
+
+void TextureCache::Put(Texture& tex)
+{
+	if(tex.name.empty()) {
+		tex.Clear();
+		return;
+	}
+	// if an older version of that texture is cached, it's outdated now
+	for(auto it = entries.begin(); it != entries.end(); ++it) {
+		if(it->name == tex.name) {
+			memUsage -= it->GetMemoryUsage();
+			entries.erase(it); // destructor frees the texture
+			break;
+		}
+	}
+	size_t texMem = tex.GetMemoryUsage();
+	if(texMem > budget) {
+		// doesn't fit at all, and throwing out everything else for it makes no sense
+		tex.Clear();
+		return;
+	}
+	EvictToBudget(budget - texMem);
+
+	entries.emplace_front(std::move(tex));
+	memUsage += texMem;
+}
+
+bool TextureCache::Take(const std::string& path, Texture& tex)
+{
+	for(auto it = entries.begin(); it != entries.end(); ++it) {
+		if(it->name != path) {
+			continue;
+		}
+		memUsage -= it->GetMemoryUsage();
+
+		uint64_t size = 0;
+		int64_t modTime = 0;
+		bool exists = GetFileSizeAndModTime(path.c_str(), &size, &modTime)
+		              || GetArchivedFileSizeAndModTime(path.c_str(), &size, &modTime);
+		if(!exists || size != it->fileSize || modTime != it->fileModTime)
+		{
+			// file has changed (or is gone), so the cached texture is useless
+			entries.erase(it);
+			return false;
+		}
+		tex = std::move(*it);
+		entries.erase(it);
+		return true;
+	}
+	return false;
+}
+
+bool TextureCache::Contains(const std::string& path) const
+{
+	for(const Texture& t : entries) {
+		if(t.name == path) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void TextureCache::Clear()
+{
+	entries.clear();
+	memUsage = 0;
+}
+
+void TextureCache::EvictToBudget(size_t budgetToReach)
+{
+	while(memUsage > budgetToReach && !entries.empty()) {
+		memUsage -= entries.back().GetMemoryUsage();
+		entries.pop_back();
+	}
+}
+
+} //namespace texview
@@ -7,6 +7,7 @@
 #define STBI_NO_STDIO
 #include "libs/stb_image.h"
 #include <glad/gl.h>
+#include "gl_extra.h"
 
 #include "libs/dg_libktx_extra.h"
 
@@ -21,12 +22,140 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
 #ifdef _WIN32
 	#define strcasecmp _stricmp
+	#define strncasecmp _strnicmp
 #endif
 
 namespace texview {
 
+static std::atomic<uint32_t> memMapHints( MMH_NONE );
+
+void SetMemMapHints(uint32_t hints)
+{
+	memMapHints = hints;
+}
+
+uint32_t GetMemMapHints()
+{
+	return memMapHints;
+}
+
+uint32_t ParseMemMapHints(const char* str)
+{
+	static const struct { const char* name; uint32_t hint; } hintNames[] = {
+		{ "none", MMH_NONE },
+		{ "populate", MMH_POPULATE },
+		{ "sequential", MMH_SEQUENTIAL },
+		{ "willneed", MMH_WILLNEED },
+		{ "hugepage", MMH_HUGEPAGE },
+		{ "readahead", MMH_READAHEAD },
+	};
+	uint32_t ret = MMH_NONE;
+	while(*str != '\0') {
+		size_t len = strcspn(str, ",");
+		bool found = false;
+		for(const auto& hn : hintNames) {
+			if(strlen(hn.name) == len && strncmp(str, hn.name, len) == 0) {
+				ret |= hn.hint;
+				found = true;
+				break;
+			}
+		}
+		if(!found && len > 0) {
+			errprintf("Ignoring unknown mmap hint '%.*s'\n", (int)len, str);
+		}
+		str += len;
+		if(*str == ',') {
+			++str;
+		}
+	}
+	return ret;
+}
+
+static std::atomic<uint32_t> fileIOBackend( FIO_MMAP );
+
+static const char* fileIOBackendNames[_FIO_NUM] = { "mmap", "read" };
+
+void SetFileIOBackend(FileIOBackend backend)
+{
+	fileIOBackend = backend;
+}
+
+FileIOBackend GetFileIOBackend()
+{
+	return (FileIOBackend)fileIOBackend.load();
+}
+
+const char* GetFileIOBackendName(FileIOBackend backend)
+{
+	return (backend < _FIO_NUM) ? fileIOBackendNames[backend] : "invalid";
+}
+
+bool ParseFileIOBackend(const char* name, FileIOBackend& backend)
+{
+	for(uint32_t i=0; i < _FIO_NUM; ++i) {
+		if(strcmp(name, fileIOBackendNames[i]) == 0) {
+			backend = (FileIOBackend)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void AddPageFaultsSince(const PageFaultCounts& start, PageFaultCounts& sum)
+{
+	PageFaultCounts now;
+	if(GetPageFaultCounts(now)) {
+		sum.minor += now.minor - start.minor;
+		sum.major += now.major - start.major;
+	}
+}
+
+void Texture::FreeMemMappedTexData(void* texData, intptr_t)
+{
+	UnloadMemMappedFile((MemMappedFile*)texData);
+}
+
+void Texture::FreeKTXandMemMappedTexData(void* texData, intptr_t cookie)
+{
+	ktxTexture_Destroy((ktxTexture*)(void*)cookie);
+	UnloadMemMappedFile((MemMappedFile*)texData);
+}
+
+const MemMappedFile* Texture::GetMemMappedFile() const
+{
+	if(texDataFreeFun == FreeMemMappedTexData || texDataFreeFun == FreeKTXandMemMappedTexData) {
+		return (const MemMappedFile*)texData;
+	}
+	return nullptr;
+}
+
+void Texture::ReadAheadMipLevel(int mipIdx)
+{
+	if((GetMemMapHints() & MMH_READAHEAD) == 0 || mipIdx < 0) {
+		return;
+	}
+	const MemMappedFile* mmf = GetMemMappedFile();
+	if(mmf == nullptr) {
+		return;
+	}
+	const unsigned char* start = (const unsigned char*)mmf->data;
+	for(const std::vector<MipLevel>& mips : elements) {
+		const MipLevel& mip = mips[mipIdx];
+		const unsigned char* data = (const unsigned char*)mip.data;
+		// for KTX loaded with libktx the data is somewhere else
+		if(data >= start && data + mip.size <= start + mmf->length) {
+			ReadAheadMemMappedFile(mmf, data - start, mip.size);
+		}
+	}
+}
+
 void Texture::Clear()
 {
 	formatName.clear();
@@ -35,6 +164,10 @@ void Texture::Clear()
 		glDeleteTextures(1, &glTextureHandle);
 		glTextureHandle = 0;
 	}
+	if(palette.glHandle > 0) {
+		glDeleteTextures(1, &palette.glHandle);
+	}
+	palette = Palette();
 	if(texDataFreeFun != nullptr) {
 		texDataFreeFun( (void*)texData, texDataFreeCookie );
 		texDataFreeFun = nullptr;
@@ -42,12 +175,24 @@ void Texture::Clear()
 	}
 	glFormat = glType = glTarget = 0;
 	defaultSwizzle = nullptr;
+	transcodeTarget = nullptr;
+	packedFormat = PF_NONE;
+	unpackAlignment = 1;
+	unpackRowLength = 0;
 	texData = nullptr;
+	ktxTex = nullptr; // if it was set, texDataFreeFun destroyed it
 
 	name.clear();
 	fileType = FT_NONE;
 	textureFlags = 0;
 	dataFormat = 0;
+	cpuDataSize = 0;
+	fileSize = 0;
+	fileModTime = 0;
+	loadFaults = PageFaultCounts();
+	mipHashes.clear();
+	container = ContainerInfo();
+	upload = UploadState();
 }
 
 static const char* getGLerrorString(GLenum e)
@@ -86,7 +231,7 @@ bool Texture::UploadTexture2D(uint32_t target, int internalFormat, int level,
 			return false;
 		}
 	} else {
-		glTexImage2D(target, level, internalFormat, mipLevel.width,
+		glTexImage2D(target, level, internalFormat, GetGLWidth(mipLevel.width),
 					 mipLevel.height, 0, glFormat, glType,
 					 mipLevel.data);
 		GLenum e = glGetError();
@@ -114,7 +259,7 @@ bool Texture::UploadTexture3Dslice(uint32_t target, int internalFormat, int leve
 			return false;
 		}
 	} else {
-		glTexSubImage3D(glTarget, level, 0, 0, elemIdx, mipLevel.width,
+		glTexSubImage3D(glTarget, level, 0, 0, elemIdx, GetGLWidth(mipLevel.width),
 		                mipLevel.height, 1, glFormat, glType, mipLevel.data);
 		int e = glGetError();
 		if(e != GL_NO_ERROR) {
@@ -127,20 +272,305 @@ bool Texture::UploadTexture3Dslice(uint32_t target, int internalFormat, int leve
 	return true;
 }
 
+// for textures with immutable storage: upload mipLevel to the given level and layer
+// (layer is the cube face for cubemaps, and the array index incl. faces for arrays)
+bool Texture::UploadSubImage(int level, int layer, int cubeFace, bool isCompressed, const Texture::MipLevel& mipLevel)
+{
+	const bool is3D = IsArray() || IsCubemap(); // DSA treats cubemaps like arrays with 6 layers
+	const char* funName = nullptr;
+	const uint32_t width = GetGLWidth(mipLevel.width);
+	if(upload.useDSA) {
+		GLuint tex = glTextureHandle;
+		if(isCompressed) {
+			if(is3D) {
+				funName = "glCompressedTextureSubImage3D";
+				glCompressedTextureSubImage3D(tex, level, 0, 0, layer, width, mipLevel.height, 1,
+				                              dataFormat, mipLevel.size, mipLevel.data);
+			} else {
+				funName = "glCompressedTextureSubImage2D";
+				glCompressedTextureSubImage2D(tex, level, 0, 0, width, mipLevel.height,
+				                              dataFormat, mipLevel.size, mipLevel.data);
+			}
+		} else {
+			if(is3D) {
+				funName = "glTextureSubImage3D";
+				glTextureSubImage3D(tex, level, 0, 0, layer, width, mipLevel.height, 1,
+				                    glFormat, glType, mipLevel.data);
+			} else {
+				funName = "glTextureSubImage2D";
+				glTextureSubImage2D(tex, level, 0, 0, width, mipLevel.height,
+				                    glFormat, glType, mipLevel.data);
+			}
+		}
+	} else if(IsArray()) {
+		return UploadTexture3Dslice(glTarget, dataFormat, level, layer, isCompressed, mipLevel);
+	} else {
+		GLenum target = IsCubemap() ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + cubeFace : glTarget;
+		if(isCompressed) {
+			funName = "glCompressedTexSubImage2D";
+			glCompressedTexSubImage2D(target, level, 0, 0, width, mipLevel.height,
+			                          dataFormat, mipLevel.size, mipLevel.data);
+		} else {
+			funName = "glTexSubImage2D";
+			glTexSubImage2D(target, level, 0, 0, width, mipLevel.height,
+			                glFormat, glType, mipLevel.data);
+		}
+	}
+	GLenum e = glGetError();
+	if(e != GL_NO_ERROR) {
+		errprintf("Sending data from '%s', layer %d for mipmap level %d to the GPU with %s() failed. "
+		          "Format is '%s', glGetError() says '%s'\n",
+		          name.c_str(), layer, level, funName, formatName.c_str(), getGLerrorString(e));
+		return false;
+	}
+	return true;
+}
+
+// glTexStorage*() only accepts sized internal formats, but for uncompressed textures
+// dataFormat is often an unsized one (like GL_RGBA) => find the sized equivalent.
+// returns 0 if there is none (or I don't know it), then the old upload path is used
+static GLenum GetSizedInternalFormat(GLenum dataFormat, GLenum glType)
+{
+	// returns the first, second, third or fourth argument depending on the
+	// number of components of the unsized format
+	GLenum comps = 0;
+	switch(dataFormat) {
+		case GL_RED:  comps = 1; break;
+		case GL_RG:   comps = 2; break;
+		case GL_RGB:  comps = 3; break;
+		case GL_RGBA: comps = 4; break;
+		case GL_SRGB:
+			return (glType == GL_UNSIGNED_BYTE) ? GL_SRGB8 : 0;
+		case GL_SRGB_ALPHA:
+			return (glType == GL_UNSIGNED_BYTE) ? GL_SRGB8_ALPHA8 : 0;
+		case GL_DEPTH_COMPONENT:
+			switch(glType) {
+				case GL_UNSIGNED_SHORT: return GL_DEPTH_COMPONENT16;
+				case GL_UNSIGNED_INT:   return GL_DEPTH_COMPONENT24;
+				case GL_FLOAT:          return GL_DEPTH_COMPONENT32F;
+			}
+			return 0;
+		case GL_DEPTH_STENCIL:
+			switch(glType) {
+				case GL_UNSIGNED_INT_24_8: return GL_DEPTH24_STENCIL8;
+				case GL_FLOAT_32_UNSIGNED_INT_24_8_REV: return GL_DEPTH32F_STENCIL8;
+			}
+			return 0;
+		case GL_ALPHA:
+		case GL_LUMINANCE:
+		case GL_LUMINANCE_ALPHA:
+			// legacy formats, only in compatibility profiles, no sized variants
+			// that can be used with glTexStorage
+			return 0;
+		default:
+			// most likely already a sized format (or a compressed one)
+			return dataFormat;
+	}
+
+	#define BY_COMPS(R, RG, RGB, RGBA) \
+		((comps == 1) ? R : ((comps == 2) ? RG : ((comps == 3) ? RGB : RGBA)))
+
+	switch(glType) {
+		case GL_UNSIGNED_BYTE:  return BY_COMPS(GL_R8, GL_RG8, GL_RGB8, GL_RGBA8);
+		case GL_BYTE:           return BY_COMPS(GL_R8_SNORM, GL_RG8_SNORM, GL_RGB8_SNORM, GL_RGBA8_SNORM);
+		case GL_UNSIGNED_SHORT: return BY_COMPS(GL_R16, GL_RG16, GL_RGB16, GL_RGBA16);
+		case GL_SHORT:          return BY_COMPS(GL_R16_SNORM, GL_RG16_SNORM, GL_RGB16_SNORM, GL_RGBA16_SNORM);
+		case GL_HALF_FLOAT:     return BY_COMPS(GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F);
+		case GL_FLOAT:          return BY_COMPS(GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F);
+
+		// packed formats
+		case GL_UNSIGNED_INT_10_10_10_2:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+			return (comps == 4) ? GL_RGB10_A2 : 0;
+		case GL_UNSIGNED_SHORT_5_5_5_1:
+		case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+			return (comps == 4) ? GL_RGB5_A1 : 0;
+		case GL_UNSIGNED_SHORT_4_4_4_4:
+		case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+			return (comps == 4) ? GL_RGBA4 : 0;
+		case GL_UNSIGNED_INT_10F_11F_11F_REV:
+			return (comps == 3) ? GL_R11F_G11F_B10F : 0;
+		case GL_UNSIGNED_INT_5_9_9_9_REV:
+			return (comps == 3) ? GL_RGB9_E5 : 0;
+	}
+	#undef BY_COMPS
+	// GL_RGB565 would be the right one for GL_UNSIGNED_SHORT_5_6_5 but is GL 4.1+ only,
+	// for anything else that's unknown just use the old path
+	return 0;
+}
+
+bool Texture::AllocImmutableStorage(uint32_t sizedFormat)
+{
+	const int numMips = GetNumMips();
+	const uint32_t width = GetGLWidth(elements[0][0].width);
+	const uint32_t height = elements[0][0].height;
+	const bool useDSA = TV_GL_ARB_direct_state_access;
+	// arrays (incl. cubemap arrays) are allocated as 3D textures, with 6 layers per cubemap
+	int numLayers = 0;
+	if(IsArray()) {
+		numLayers = GetNumElements() * (IsCubemap() ? 6 : 1);
+	}
+
+	glGetError();
+	if(useDSA) {
+		glCreateTextures(glTarget, 1, &glTextureHandle);
+		if(numLayers > 0) {
+			glTextureStorage3D(glTextureHandle, numMips, sizedFormat, width, height, numLayers);
+		} else {
+			glTextureStorage2D(glTextureHandle, numMips, sizedFormat, width, height);
+		}
+	} else {
+		glGenTextures(1, &glTextureHandle);
+		glBindTexture(glTarget, glTextureHandle);
+		if(numLayers > 0) {
+			glTexStorage3D(glTarget, numMips, sizedFormat, width, height, numLayers);
+		} else {
+			glTexStorage2D(glTarget, numMips, sizedFormat, width, height);
+		}
+	}
+	GLenum e = glGetError();
+	if(e != GL_NO_ERROR) {
+		// can happen if the mip chain is longer than OpenGL allows, for example
+		errprintf("Allocating immutable storage for '%s' (format '%s', %d mips, %u x %u) failed, "
+		          "glGetError() says '%s' - will try the old way\n", name.c_str(), formatName.c_str(),
+		          numMips, width, height, getGLerrorString(e));
+		glDeleteTextures(1, &glTextureHandle);
+		glTextureHandle = 0;
+		return false;
+	}
+	upload.immutableStorage = true;
+	upload.useDSA = useDSA;
+	return true;
+}
+
+void Texture::ReleaseOpenGLtexture()
+{
+	if(glTextureHandle != 0) {
+		glDeleteTextures(1, &glTextureHandle);
+		glTextureHandle = 0;
+	}
+	if(palette.glHandle != 0) {
+		glDeleteTextures(1, &palette.glHandle);
+		palette.glHandle = 0;
+	}
+	upload = UploadState();
+}
+
+void Texture::ReleaseCPUData()
+{
+	if(texData == nullptr || glTextureHandle == 0 || IsUploadPending()) {
+		return;
+	}
+	if(IsStdinPath(name.c_str())) {
+		return; // it can't be read again
+	}
+	if(texDataFreeFun != nullptr) {
+		texDataFreeFun( (void*)texData, texDataFreeCookie );
+	}
+	texDataFreeFun = nullptr;
+	texDataFreeCookie = 0;
+	texData = nullptr;
+	ktxTex = nullptr; // if it was set, texDataFreeFun destroyed it
+	cpuDataSize = 0;
+	// the mip levels are still needed for their sizes
+	for(std::vector<MipLevel>& mips : elements) {
+		for(MipLevel& mip : mips) {
+			mip.data = nullptr;
+		}
+	}
+}
+
+bool Texture::ReloadCPUData()
+{
+	// just load it again - for DDS and KTX that's only an mmap, for decoded or
+	// transcoded textures it's hopefully in the disk cache (see diskcache.cpp)
+	Texture tmp;
+	if(!tmp.Load(name.c_str())) {
+		return false;
+	}
+	bool same = tmp.fileSize == fileSize && tmp.fileModTime == fileModTime
+	            && tmp.dataFormat == dataFormat && tmp.glFormat == glFormat && tmp.glType == glType
+	            && tmp.elements.size() == elements.size();
+	for(size_t e=0; same && e < elements.size(); ++e) {
+		same = tmp.elements[e].size() == elements[e].size();
+		for(size_t m=0; same && m < elements[e].size(); ++m) {
+			same = tmp.elements[e][m].size == elements[e][m].size;
+		}
+	}
+	if(!same) {
+		errprintf("Can't upload '%s' again, the file has changed since it was loaded\n", name.c_str());
+		return false;
+	}
+	elements = std::move(tmp.elements);
+	texData = tmp.texData;
+	texDataFreeCookie = tmp.texDataFreeCookie;
+	texDataFreeFun = tmp.texDataFreeFun;
+	ktxTex = tmp.ktxTex;
+	cpuDataSize = tmp.cpuDataSize;
+	// now this texture owns the data
+	tmp.texData = nullptr;
+	tmp.texDataFreeFun = nullptr;
+	tmp.ktxTex = nullptr;
+	return true;
+}
+
+void Texture::SetParameter(uint32_t pname, int value)
+{
+	if(glTextureHandle == 0) {
+		return;
+	}
+	if(upload.useDSA) {
+		glTextureParameteri(glTextureHandle, pname, value);
+	} else {
+		glBindTexture(glTarget, glTextureHandle);
+		glTexParameteri(glTarget, pname, value);
+	}
+}
+
 bool Texture::CreateOpenGLtexture()
 {
+	if(!StartOpenGLupload()) {
+		return false;
+	}
+	while(!ContinueOpenGLupload(1000.0))
+		;
+	return upload.anySuccess;
+}
+
+bool Texture::StartOpenGLupload(bool allowImmutableStorage)
+{
+	if(texData == nullptr && !elements.empty() && !ReloadCPUData()) {
+		// the CPU copy was dropped after the last upload (ReleaseCPUData()), but it's needed now
+		return false;
+	}
 	if(glTextureHandle != 0) {
 		glDeleteTextures(1, &glTextureHandle);
 		glTextureHandle = 0;
 	}
+	upload = UploadState();
 
 	if(elements.empty())
 		return false;
 
+	if((textureFlags & TF_INDEXED) != 0) {
+		// the palette is tiny, just upload it right away
+		glGetError();
+		if(!UploadPalette()) {
+			return false;
+		}
+	}
+
 	if(ktxTex != nullptr) {
+		if(!PrepareKTXforUpload()) {
+			return false;
+		}
 		GLenum target = 0;
 		GLenum glErr = 0;
+		using clock = std::chrono::steady_clock;
+		const clock::time_point startTime = clock::now();
 		KTX_error_code res = ktxTexture_GLUpload(ktxTex, &glTextureHandle, &target, &glErr);
+		upload.secondsSpent = std::chrono::duration<double>(clock::now() - startTime).count();
+		upload.bytesUploaded = ktxTexture_GetDataSize(ktxTex);
 		if(res != KTX_SUCCESS) {
 			glTextureHandle = 0;
 			errprintf("Sending data from '%s' to the GPU with ktxTexture_GLUpload() failed. "
@@ -151,104 +581,372 @@ bool Texture::CreateOpenGLtexture()
 		GLint intFmt = 0;
 		GLenum baseFmt = 0;
 		ktxTexture_GetOpenGLFormat(ktxTex, &intFmt, &baseFmt, NULL, NULL);
+		upload.anySuccess = true;
 		return true;
 	}
 
-	glGenTextures(1, &glTextureHandle);
-	glBindTexture(glTarget, glTextureHandle);
+	// if possible allocate the whole texture (incl. all mips) at once with glTexStorage*(),
+	// so the driver doesn't have to (re)validate it for each level
+	GLenum sizedFormat = 0;
+	if(allowImmutableStorage && TV_GL_ARB_texture_storage) {
+		sizedFormat = GetSizedInternalFormat(dataFormat, glType);
+	}
+	if(sizedFormat == 0 || !AllocImmutableStorage(sizedFormat)) {
+		glGenTextures(1, &glTextureHandle);
+		glBindTexture(glTarget, glTextureHandle);
+	}
 
-	GLenum internalFormat = dataFormat;
 	int numMips = GetNumMips();
+	// make sure the texture is complete with just the smallest mip levels uploaded
+	// (GL_TEXTURE_BASE_LEVEL must be set to GetFirstCompleteMip() for that, of course)
+	SetParameter(GL_TEXTURE_MAX_LEVEL, numMips - 1);
+
+	upload.nextMip = numMips - 1;
+	upload.nextElem = 0;
+	upload.firstCompleteMip = numMips;
+	// the following mip levels are read ahead in ContinueOpenGLupload()
+	ReadAheadMipLevel(upload.nextMip);
 
 	glGetError();
-	bool anySuccess = false;
+	return true;
+}
 
-	const bool isArray = IsArray();
-	const bool isCubemap = IsCubemap();
-	const bool isCompressed = (textureFlags & TF_COMPRESSED) != 0;
-	if(!isArray) {
-		if(isCubemap) {
-			int elemIdx = 0;
-			for(int cf=0; cf < 6; ++cf) {
-				if(textureFlags & (TF_CUBEMAP_XPOS << cf)) {
-					GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + cf;
-					std::vector<MipLevel>& mipLevels = elements[elemIdx];
-					for(int i=0; i < numMips; ++i) {
-						if(UploadTexture2D(target, internalFormat, i, isCompressed, mipLevels[i])) {
-							anySuccess = true;
-						}
-					}
-					++elemIdx;
-				}
+bool Texture::PrepareKTXforUpload()
+{
+	if(ktxTex->pData != nullptr || ktxTexture_isActiveStream(ktxTex)) {
+		return true;
+	}
+	// the image data wasn't loaded into memory and libktx closes its stream once
+	// ktxTexture_IterateLoadLevelFaces() is done, so to upload it again (e.g. after
+	// a cancelled upload or when the texture comes back from the TextureCache)
+	// the ktxTexture must be recreated from the mmap that's still around
+	const MemMappedFile* mmf = (const MemMappedFile*)texData;
+	ktxTexture* newKtxTex = nullptr;
+	KTX_error_code res = ktxTexture_CreateFromMemory((const ktx_uint8_t*)mmf->data, mmf->length,
+	                                                 KTX_TEXTURE_CREATE_NO_FLAGS, &newKtxTex);
+	if(res != KTX_SUCCESS) {
+		errprintf("libktx couldn't reopen '%s' for uploading: %s (%d)\n", name.c_str(), ktxErrorString(res), res);
+		return false;
+	}
+	ktxTexture_Destroy(ktxTex);
+	ktxTex = newKtxTex;
+	texDataFreeCookie = (intptr_t)newKtxTex;
+	return true;
+}
+
+bool Texture::ContinueOpenGLupload(double maxSeconds, UploadRing* ring)
+{
+	if(upload.nextMip < 0) {
+		return true;
+	}
+	using clock = std::chrono::steady_clock;
+	const clock::time_point startTime = clock::now();
+	PageFaultCounts startFaults;
+	GetPageFaultCounts(startFaults);
+	const int numElements = int(elements.size()); // incl. cubemap faces
+	if(ring != nullptr && !ring->IsAvailable()) {
+		ring = nullptr;
+	}
+
+	// with the ring buffer, the next element is already copied into it (by its worker
+	// threads) while the current one is uploaded
+	UploadRing::Ticket nextTicket;
+	UploadRing::Ticket ticket;
+	// how long uploading the last element took, to guess if there's time for the next one
+	double lastElemSeconds = 0.0;
+
+	if(!upload.useDSA) {
+		glBindTexture(glTarget, glTextureHandle);
+	}
+	// (set each time because other code, like ktxTexture_GLUpload(), might change it)
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, unpackRowLength);
+	do {
+		const clock::time_point elemStartTime = clock::now();
+		int mipIdx = upload.nextMip;
+		int elemIdx = upload.nextElem;
+		// for arrays, the memory for all elements of a mip level must be allocated first
+		// (unless it's already been allocated with glTexStorage3D())
+		if(elemIdx == 0 && IsArray() && !upload.immutableStorage && !AllocTexture3Dlevel(mipIdx)) {
+			upload.nextMip = -1;
+			break;
+		}
+		if(elemIdx == 0) {
+			// so the next (bigger) mip level is hopefully in memory when it's needed
+			ReadAheadMipLevel(mipIdx - 1);
+		}
+		const MipLevel& mipLevel = elements[elemIdx][mipIdx];
+		if(ring != nullptr) {
+			ticket = std::move(nextTicket);
+			if(ticket == nullptr) {
+				ticket = ring->Enqueue(mipLevel.data, mipLevel.size);
 			}
-		} else { // Texture2D
-			std::vector<MipLevel>& mipLevels = elements[0];
-			for(int i=0; i < numMips; ++i) {
-				if(UploadTexture2D(glTarget, internalFormat, i, isCompressed, mipLevels[i])) {
-					anySuccess = true;
-				}
+			int nextElem = elemIdx + 1;
+			int nextMip = mipIdx;
+			if(nextElem == numElements) {
+				nextElem = 0;
+				--nextMip;
+			}
+			// don't bother if the time is (probably) up after this element, the copy
+			// would only be thrown away because the ring buffer isn't kept between calls
+			double secondsAfterElem = std::chrono::duration<double>(elemStartTime - startTime).count()
+			                          + lastElemSeconds;
+			if(nextMip >= 0 && secondsAfterElem < maxSeconds) {
+				const MipLevel& nextMipLevel = elements[nextElem][nextMip];
+				nextTicket = ring->Enqueue(nextMipLevel.data, nextMipLevel.size);
+			}
+		}
+		if(UploadElement(mipIdx, elemIdx, (ticket != nullptr) ? ring : nullptr, ticket)) {
+			upload.anySuccess = true;
+		}
+		ticket = nullptr;
+		upload.bytesUploaded += mipLevel.size;
+		if(++upload.nextElem == numElements) {
+			// cubemaps are only complete with all faces, arrays only with all elements,
+			// so only now this mip level can be used
+			upload.firstCompleteMip = mipIdx;
+			upload.nextElem = 0;
+			--upload.nextMip;
+		}
+		lastElemSeconds = std::chrono::duration<double>(clock::now() - elemStartTime).count();
+	} while(upload.nextMip >= 0
+	        && std::chrono::duration<double>(clock::now() - startTime).count() < maxSeconds);
+
+	if(unpackRowLength != 0) {
+		// unlike the alignment, libktx doesn't set this, so it must be reset
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
+
+	if(nextTicket != nullptr) {
+		// it'll be copied again in the next frame, the ring buffer isn't kept between calls.
+		// this also makes sure the copy threads are done with the data, as the texture
+		// might be freed (or evicted from the cache) before the next call
+		ring->Release(nextTicket);
+	}
+
+	upload.secondsSpent += std::chrono::duration<double>(clock::now() - startTime).count();
+	AddPageFaultsSince(startFaults, upload.faults);
+
+	return upload.nextMip < 0;
+}
+
+bool Texture::AllocTexture3Dlevel(int mipIdx)
+{
+	// somewhat helpful: https://ferransole.wordpress.com/2014/06/09/array-textures/
+	uint32_t width = GetGLWidth(elements[0][mipIdx].width);
+	uint32_t height = elements[0][mipIdx].height;
+	int numElements = GetNumElements();
+
+	// cubemap arrays are loaded like normal arrays but with 6 times the elements,
+	// loading always all faces of one cubemap and then the same for the next cubemap
+	// incomplete cubemaps are not allowed in arrays
+	// see also https://www.khronos.org/opengl/wiki/Cubemap_Texture#Cubemap_array_textures
+	// (if this happens, I'll just leave the memory of missing faces uninitialized)
+	uint32_t numLogicalElements = numElements;
+	if(IsCubemap()) {
+		numLogicalElements *= 6;
+	}
+	// according to https://community.khronos.org/t/glcompressedteximage2d-and-null-data/41505/8
+	// one can't pass data=NULL to glCompressedTexImage*(), but to just reserve space
+	// compressed internal formats can be passed to glTexImage3D (unlike when uploading data)
+	glTexImage3D(glTarget, mipIdx, dataFormat, width, height, numLogicalElements, 0, glFormat, glType, nullptr);
+	GLenum e = glGetError();
+	if(e != GL_NO_ERROR) {
+		errprintf("Allocating GPU memory for mipmap level %d (%u x %u) of texture '%s' with "
+		          "%d array elements for format '%s' on the GPU with glTexImage3D() failed. "
+		          "(glGetError() says '%s')\n",
+		          mipIdx, width, height, name.c_str(), numElements,
+		          formatName.c_str(), getGLerrorString(e));
+		return false;
+	}
+	return true;
+}
+
+// uploads mip level mipIdx of elements[elemIdx]
+// if ring is set, the data is taken from it (ticket must be for this element then)
+bool Texture::UploadElement(int mipIdx, int elemIdx, UploadRing* ring, const UploadRing::Ticket& ticket)
+{
+	MipLevel mipLevel = elements[elemIdx][mipIdx];
+	if(ring != nullptr) {
+		mipLevel.data = ring->WaitForCopy(ticket);
+	}
+	const bool isCompressed = (textureFlags & TF_COMPRESSED) != 0;
+	GLenum internalFormat = dataFormat;
+
+	int cubeFace = 0;
+	int logicalElemIdx = GetLayer(elemIdx, cubeFace);
+
+	bool ret = false;
+	if(upload.immutableStorage) {
+		ret = UploadSubImage(mipIdx, logicalElemIdx, cubeFace, isCompressed, mipLevel);
+	} else if(IsArray()) {
+		ret = UploadTexture3Dslice(glTarget, internalFormat, mipIdx, logicalElemIdx, isCompressed, mipLevel);
+	} else {
+		GLenum target = IsCubemap() ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + cubeFace : glTarget;
+		ret = UploadTexture2D(target, internalFormat, mipIdx, isCompressed, mipLevel);
+	}
+	if(ring != nullptr) {
+		ring->Issued(ticket); // also unbinds the PBO
+	}
+	return ret;
+}
+
+int Texture::GetLayer(int elemIdx, int& cubeFace) const
+{
+	cubeFace = 0;
+	if(!IsCubemap()) {
+		return elemIdx;
+	}
+	// elements only contains the cubemap faces that are available, so find out
+	// which face elemIdx is (it's the faceNum'th set cubemap face flag)
+	const int numCubeFaces = GetNumCubemapFaces();
+	int faceNum = elemIdx % numCubeFaces;
+	for(int cf=0; cf < 6; ++cf) {
+		if(textureFlags & (TF_CUBEMAP_XPOS << cf)) {
+			if(faceNum == 0) {
+				cubeFace = cf;
+				break;
 			}
+			--faceNum;
 		}
-	} else { // it's an array
-		// somewhat helpful: https://ferransole.wordpress.com/2014/06/09/array-textures/
-		const int numElements = GetNumElements();
-		const int numCubeFaces = GetNumCubemapFaces();
-		for(int mipIdx=0; mipIdx < numMips; ++mipIdx) {
-			uint32_t width = elements[0][mipIdx].width;
-			uint32_t height = elements[0][mipIdx].height;
-
-			// first allocate the space for all array elements of this mipmap level
-
-			// cubemap arrays are loaded like normal arrays but with 6 times the elements,
-			// loading always all faces of one cubemap and then the same for the next cubemap
-			// incomplete cubemaps are not allowed in arrays
-			// see also https://www.khronos.org/opengl/wiki/Cubemap_Texture#Cubemap_array_textures
-			// (if this happens, I'll just leave the memory of missing faces uninitialized)
-			uint32_t numLogicalElements = numElements;
-			if(isCubemap) {
-				numLogicalElements *= 6;
+	}
+	// logical index assuming (like OpenGL does) that all 6 cubemap faces are available
+	return (elemIdx / numCubeFaces) * 6 + cubeFace;
+}
+
+// not a cryptographic hash, just fast (four independent 64bit lanes so the multiplications
+// don't wait for each other) and good enough to tell if the data of a mip level has changed
+static uint64_t HashMipData(const unsigned char* data, size_t len)
+{
+	const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+	uint64_t h[4] = { len, len ^ 0x2545F4914F6CDD1DULL, len ^ 0xff51afd7ed558ccdULL, len ^ 0xc4ceb9fe1a85ec53ULL };
+	size_t i = 0;
+	for( ; i + 32 <= len; i += 32) {
+		uint64_t v[4];
+		memcpy(v, data + i, 32);
+		for(int l=0; l < 4; ++l) {
+			h[l] = (h[l] ^ v[l]) * prime;
+			h[l] ^= h[l] >> 31;
+		}
+	}
+	uint64_t ret = h[0] ^ (h[1] * 3) ^ (h[2] * 5) ^ (h[3] * 7);
+	for( ; i < len; ++i) {
+		ret = (ret ^ data[i]) * 0x100000001b3ULL;
+	}
+	ret ^= ret >> 29;
+	return ret * prime;
+}
+
+void Texture::ComputeMipHashes()
+{
+	const int numMips = GetNumMips();
+	mipHashes.assign(elements.size() * numMips, 0);
+	for(size_t e=0; e < elements.size(); ++e) {
+		for(int m=0; m < numMips; ++m) {
+			const MipLevel& mip = elements[e][m];
+			if(mip.data == nullptr) {
+				// probably a KTX that's uploaded by libktx, can't be compared
+				mipHashes.clear();
+				return;
 			}
-			// according to https://community.khronos.org/t/glcompressedteximage2d-and-null-data/41505/8
-			// one can't pass data=NULL to glCompressedTexImage*(), but to just reserve space
-			// compressed internal formats can be passed to glTexImage3D (unlike when uploading data)
-			glTexImage3D(glTarget, mipIdx, internalFormat, width, height, numLogicalElements, 0, glFormat, glType, nullptr);
-			GLenum e = glGetError();
-			if(e != GL_NO_ERROR) {
-				errprintf("Allocating GPU memory for mipmap level %d (%u x %u) of texture '%s' with "
-				          "%d array elements for format '%s' on the GPU with glTexImage3D() failed. "
-				          "(glGetError() says '%s')\n",
-				          mipIdx, width, height, name.c_str(), numElements,
-				          formatName.c_str(), getGLerrorString(e));
+			mipHashes[e * numMips + m] = HashMipData((const unsigned char*)mip.data, mip.size);
+		}
+	}
+}
+
+bool Texture::UpdateFromReloaded(Texture& newTex, int& numChanged)
+{
+	numChanged = 0;
+	// libktx does its own uploads, so that's not supported for KTX (and BasisU).
+	// everything else must match exactly, or the existing OpenGL texture doesn't fit
+	if( glTextureHandle == 0 || IsUploadPending() || ktxTex != nullptr || newTex.ktxTex != nullptr
+	   || newTex.texData == nullptr || newTex.name != name
+	   || newTex.dataFormat != dataFormat || newTex.glFormat != glFormat || newTex.glType != glType
+	   || newTex.glTarget != glTarget || newTex.textureFlags != textureFlags
+	   || newTex.packedFormat != packedFormat || newTex.elements.size() != elements.size()
+	   || newTex.GetNumMips() != GetNumMips() ) {
+		return false;
+	}
+	const int numMips = GetNumMips();
+	for(size_t e=0; e < elements.size(); ++e) {
+		for(int m=0; m < numMips; ++m) {
+			const MipLevel& oldMip = elements[e][m];
+			const MipLevel& newMip = newTex.elements[e][m];
+			if(newMip.data == nullptr || newMip.width != oldMip.width
+			   || newMip.height != oldMip.height || newMip.size != oldMip.size) {
 				return false;
 			}
+		}
+	}
 
-			// now upload the data of all array elements
-			for(int elemIdx=0; elemIdx < numElements; ++elemIdx) {
-				if(isCubemap) {
-					int realElemIdx = elemIdx * numCubeFaces; // in elements array
-					// logical index assuming (like OpenGL does) that all 6 cubemap faces are available
-					int logicalElemIdx = elemIdx * 6;
-					for(int cf=0; cf < 6; ++cf) {
-						if(textureFlags & (TF_CUBEMAP_XPOS << cf)) {
-							const MipLevel& mipLevel = elements[realElemIdx][mipIdx];
-							if(UploadTexture3Dslice(glTarget, internalFormat, mipIdx, logicalElemIdx, isCompressed, mipLevel)) {
-								anySuccess = true;
-							}
-							++realElemIdx;
-						}
-						++logicalElemIdx;
-					}
-				} else {
-					const MipLevel& mipLevel = elements[elemIdx][mipIdx];
-					if(UploadTexture3Dslice(glTarget, internalFormat, mipIdx, elemIdx, isCompressed, mipLevel)) {
-						anySuccess = true;
-					}
-				}
-			} // for elemIdx
-		} // for mipIdx
+	using clock = std::chrono::steady_clock;
+	const clock::time_point startTime = clock::now();
+	const size_t numHashes = elements.size() * numMips;
+	const bool canCompare = mipHashes.size() == numHashes && newTex.mipHashes.size() == numHashes;
+	const bool isCompressed = (textureFlags & TF_COMPRESSED) != 0;
+	size_t bytesUploaded = 0;
+
+	if(!upload.useDSA) {
+		glBindTexture(glTarget, glTextureHandle);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, newTex.unpackAlignment);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, newTex.unpackRowLength);
+	glGetError();
+	for(int m=0; m < numMips; ++m) {
+		for(size_t e=0; e < elements.size(); ++e) {
+			size_t hashIdx = e * numMips + m;
+			if(canCompare && mipHashes[hashIdx] == newTex.mipHashes[hashIdx]) {
+				continue;
+			}
+			int cubeFace = 0;
+			int layer = GetLayer(int(e), cubeFace);
+			const MipLevel& newMip = newTex.elements[e][m];
+			// (UploadSubImage() prints an error if it fails, there's not much else to do about it)
+			UploadSubImage(m, layer, cubeFace, isCompressed, newMip);
+			bytesUploaded += newMip.size;
+			++numChanged;
+		}
+	}
+	if(newTex.unpackRowLength != 0) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 	}
 
-	return anySuccess;
+	if((textureFlags & TF_INDEXED) != 0 && newTex.palette.source == palette.source
+	   && newTex.palette.colors != palette.colors) {
+		// only if the palette wasn't replaced by the user
+		SetPalette(newTex.palette.colors, newTex.palette.source.c_str());
+	}
+
+	// take over the data of newTex, but keep the OpenGL texture (and palette)
+	if(texDataFreeFun != nullptr) {
+		texDataFreeFun( (void*)texData, texDataFreeCookie );
+	}
+	texData = newTex.texData;
+	texDataFreeCookie = newTex.texDataFreeCookie;
+	texDataFreeFun = newTex.texDataFreeFun;
+	newTex.texData = nullptr;
+	newTex.texDataFreeCookie = 0;
+	newTex.texDataFreeFun = nullptr;
+	elements = std::move(newTex.elements);
+	mipHashes = std::move(newTex.mipHashes);
+	formatName = std::move(newTex.formatName);
+	fileType = newTex.fileType;
+	defaultSwizzle = newTex.defaultSwizzle;
+	transcodeTarget = newTex.transcodeTarget;
+	unpackAlignment = newTex.unpackAlignment;
+	unpackRowLength = newTex.unpackRowLength;
+	cpuDataSize = newTex.cpuDataSize;
+	fileSize = newTex.fileSize;
+	fileModTime = newTex.fileModTime;
+	loadFaults = newTex.loadFaults;
+	container = newTex.container;
+	newTex.Clear();
+
+	// the upload statistics are for this upload now
+	upload.bytesUploaded = bytesUploaded;
+	upload.secondsSpent = std::chrono::duration<double>(clock::now() - startTime).count();
+	upload.faults = PageFaultCounts();
+	return true;
 }
 
 Texture::~Texture() {
@@ -258,6 +956,9 @@ Texture::~Texture() {
 	if(glTextureHandle > 0) {
 		glDeleteTextures(1, &glTextureHandle);
 	}
+	if(palette.glHandle > 0) {
+		glDeleteTextures(1, &palette.glHandle);
+	}
 }
 
 const char* Texture::GetIntTexInfo(bool& isUnsigned)
@@ -317,14 +1018,113 @@ const char* Texture::GetIntTexInfo(bool& isUnsigned)
 	return ret;
 }
 
-bool Texture::Load(const char* filename)
+bool HasSupportedFileExtension(const char* fileName)
+{
+	const char* ext = strrchr(fileName, '.');
+	if(ext == nullptr) {
+		return false;
+	}
+	++ext;
+	// compressed files like foo.dds.zst are supported if the inner extension is
+	static const char* compressedExts[] = { "zst", "zstd", "gz" };
+	for(const char* ce : compressedExts) {
+		if(strcasecmp(ext, ce) == 0) {
+			std::string inner(fileName, ext - 1 - fileName);
+			return HasSupportedFileExtension(inner.c_str());
+		}
+	}
+	static const char* supportedExts[] = {
+		"dds", "ktx", "ktx2",
+		// paletted formats, see palette.cpp
+		"wal", "pcx",
+		// formats supported by stb_image
+		"png", "jpg", "jpeg", "tga", "bmp", "psd", "gif", "hdr", "pic", "pnm", "ppm", "pgm"
+	};
+	for(const char* se : supportedExts) {
+		if(strcasecmp(ext, se) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Texture::Load(const char* filename, LoadProgress* progress, bool infoOnly)
+{
+	PageFaultCounts startFaults;
+	GetPageFaultCounts(startFaults);
+	bool ret = LoadFile(filename, progress, infoOnly);
+	AddPageFaultsSince(startFaults, loadFaults);
+	return ret;
+}
+
+struct StdinState {
+	LoadProgress* progress;
+	bool headerChecked;
+};
+
+// called by ReadStdin() whenever more data has arrived. Checks if it's something
+// that can be loaded as soon as the header is there, so (for example) when
+// accidentally piping in some huge non-texture file it doesn't have to be read completely
+static bool StdinDataReceived(const void* data, size_t size, bool finished, void* user)
+{
+	StdinState* state = (StdinState*)user;
+	if(state->progress != nullptr) {
+		if(state->progress->IsCancelled()) {
+			return false;
+		}
+		state->progress->Set("Reading stdin");
+	}
+	if(state->headerChecked) {
+		return true;
+	}
+	const unsigned char* d = (const unsigned char*)data;
+	// "«KTX " is the start of both KTX1 and KTX2 identifiers
+	if( (size >= 4 && memcmp(d, "DDS ", 4) == 0) || (size >= 5 && memcmp(d, "\xABKTX ", 5) == 0)
+	   || GetCompressedContainerName(d, size) != nullptr ) {
+		state->headerChecked = true;
+		return true;
+	}
+	int w, h, comp;
+	if(stbi_info_from_memory(d, (int)std::min(size, size_t(INT_MAX)), &w, &h, &comp)) {
+		state->headerChecked = true;
+		return true;
+	}
+	// stb_image might need more data (JPEGs can have big EXIF blocks before the size),
+	// but if there's no known header in the first megabyte, it's hopeless
+	if(finished || size >= 1024 * 1024) {
+		errprintf("The data from stdin doesn't look like a supported texture format!\n");
+		return false;
+	}
+	return true;
+}
+
+bool Texture::LoadFile(const char* filename, LoadProgress* progress, bool infoOnly)
 {
 	Clear();
 
-	std::string fname( ToAbsolutePath(filename) );
-	filename = fname.c_str(); // from here on filename has an absolute path.
+	MemMappedFile* mmf = nullptr;
+	std::string fname;
+	if(IsStdinPath(filename)) {
+		// "-" stays the name, it's used as key in the TextureCache etc
+		// raw data has no header that could be checked
+		RawImportParams rawParams;
+		StdinState stdinState = { progress, GetRawImportParams(filename, rawParams) };
+		mmf = ReadStdin(StdinDataReceived, &stdinState);
+	} else {
+		fname = ToAbsolutePath(filename);
+		filename = fname.c_str(); // from here on filename has an absolute path.
 
-	MemMappedFile* mmf = LoadMemMappedFile(filename);
+		if(progress != nullptr) {
+			progress->Set("Opening");
+		}
+
+		std::string archivePath, innerPath;
+		if(SplitArchivePath(filename, archivePath, innerPath)) {
+			mmf = LoadArchivedFile(archivePath.c_str(), innerPath.c_str());
+		} else {
+			mmf = LoadMemMappedFile(filename);
+		}
+	}
 	if(mmf == nullptr) {
 		return false;
 	}
@@ -332,9 +1132,38 @@ bool Texture::Load(const char* filename)
 		errprintf("File '%s' is too small (%d) to contain useful image data!\n",
 		          filename, (int)mmf->length);
 	}
+	if(progress != nullptr && progress->IsCancelled()) {
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+	fileSize = mmf->length;
+	fileModTime = mmf->modTime;
+
+	const char* containerName = GetCompressedContainerName(mmf->data, mmf->length);
+	if(containerName != nullptr) {
+		// decompress it into memory and load that like the uncompressed file
+		using clock = std::chrono::steady_clock;
+		const clock::time_point startTime = clock::now();
+		MemMappedFile* decompressed = DecompressMemMappedFile(mmf, filename, progress);
+		UnloadMemMappedFile(mmf);
+		if(decompressed == nullptr) {
+			return false;
+		}
+		mmf = decompressed;
+		container.name = containerName;
+		container.decompressedSize = mmf->length;
+		container.decompressSeconds = std::chrono::duration<double>(clock::now() - startTime).count();
+	}
+
+	// if the user said that the file is raw data, it's loaded as such even if it happens
+	// to start with something that looks like a header
+	RawImportParams rawParams;
+	if(GetRawImportParams(filename, rawParams)) {
+		return LoadRaw(mmf, rawParams, filename, progress, infoOnly);
+	}
 
 	if(memcmp(mmf->data, "DDS ", 4) == 0) {
-		return LoadDDS(mmf, filename);
+		return LoadDDS(mmf, filename, progress, infoOnly);
 	}
 
 	static const unsigned char ktx1identifier[] = {
@@ -347,7 +1176,14 @@ bool Texture::Load(const char* filename)
 	if( mmf->length > 12 && (memcmp(mmf->data, ktx1identifier, 12) == 0
 	                         || memcmp(mmf->data, ktx2identifier, 12) == 0) )
 	{
-		return LoadKTX(mmf, filename);
+		return LoadKTX(mmf, filename, progress, infoOnly);
+	}
+
+	// paletted images are kept as they are (instead of letting stb_image expand them to RGBA),
+	// the palette lookup happens in the shader
+	FileType indexedType = GetIndexedFileType(mmf, filename);
+	if(indexedType != FT_NONE) {
+		return LoadIndexed(mmf, indexedType, filename, progress, infoOnly);
 	}
 
 	// some other kind of file, try throwing it at stb_image
@@ -356,6 +1192,13 @@ bool Texture::Load(const char* filename)
 		UnloadMemMappedFile(mmf);
 		return false;
 	}
+	// decoding takes a while, so if it was decoded before, just use that
+	const uint64_t cacheKey = infoOnly ? 0 : GetDiskCacheKey(mmf, filename, 0);
+	if(cacheKey != 0 && LoadFromDiskCache(cacheKey, filename)) {
+		UnloadMemMappedFile(mmf);
+		name = filename;
+		return true;
+	}
 	const unsigned char* data = (const unsigned char*)mmf->data;
 	int len = mmf->length;
 	int w, h, comp;
@@ -367,84 +1210,238 @@ bool Texture::Load(const char* filename)
 	}
 	// we want either 8 or 16, 32, 64 or 96 bit pixels, not 24 or 48 (I think?)
 	int numChans = comp < 3 ? comp : 4;
+	// these only look at the header
 	if(stbi_is_hdr_from_memory(data, len)) {
 		numChans = comp; // for float32 channels RGB (96bit) is also fine, I think?
-		pix = stbi_loadf_from_memory(data, len, &w, &h, &comp, numChans);
 		// TODO: should HDR be rendered with sRGB framebuffer enabled?
 		// TODO: TF_HDR flag?
 		formatName = "STB HDR (F32) ";
 		glType = GL_FLOAT;
 	} else if(stbi_is_16_bit_from_memory(data, len)) {
-		pix = stbi_load_16_from_memory(data, len, &w, &h, &comp, numChans);
 		formatName = "STB UNORM16 ";
 		glType = GL_UNSIGNED_SHORT;
 	} else {
-		pix = stbi_load_from_memory(data, len, &w, &h, &comp, numChans);
 		formatName = "STB UNORM8 ";
 		glType = GL_UNSIGNED_BYTE;
 	}
 
-	if(pix != nullptr) {
-		// mmf is not needed anymore, decoded image data is in pix
-		UnloadMemMappedFile(mmf);
-		mmf = nullptr;
-
-		name = filename;
-		fileType = FT_STB;
-		glTarget = GL_TEXTURE_2D;
+	if(!infoOnly) {
+		if(progress != nullptr) {
+			// stb_image doesn't report progress (and can't be interrupted)
+			progress->Set("Decoding");
+		}
+		if(glType == GL_FLOAT) {
+			pix = stbi_loadf_from_memory(data, len, &w, &h, &comp, numChans);
+		} else if(glType == GL_UNSIGNED_SHORT) {
+			pix = stbi_load_16_from_memory(data, len, &w, &h, &comp, numChans);
+		} else {
+			pix = stbi_load_from_memory(data, len, &w, &h, &comp, numChans);
+		}
+
+		if(pix == nullptr) {
+			formatName.clear();
+			glType = 0;
+			errprintf("Couldn't load '%s', maybe the filetype is unsupported?\n", filename);
+			UnloadMemMappedFile(mmf);
+			return false;
+		}
+	}
+
+	// mmf is not needed anymore, decoded image data is in pix
+	// (or, in infoOnly mode, no image data is needed at all)
+	UnloadMemMappedFile(mmf);
+	mmf = nullptr;
 
-		switch(numChans) {
-			case 4:
-				formatName += (comp == 3) ? "RGB(X)" : "RGBA";
-				dataFormat = GL_RGBA;
-				glFormat = GL_RGBA;
-				break;
-			case 3:
-				formatName += "RGB";
-				dataFormat = GL_RGB;
-				glFormat = GL_RGB;
-				break;
-			case 2:
-				formatName += "Luminance+Alpha";
-				dataFormat = GL_LUMINANCE_ALPHA;
-				glFormat = GL_LUMINANCE_ALPHA;
-				break;
-			case 1:
-				formatName += "Luminance";
-				dataFormat = GL_LUMINANCE;
-				glFormat = GL_LUMINANCE;
-				break;
+	if(progress != nullptr && progress->IsCancelled()) {
+		if(pix != nullptr) {
+			stbi_image_free(pix);
 		}
+		formatName.clear();
+		glType = 0;
+		return false;
+	}
 
-		if(comp == STBI_rgb_alpha || comp == STBI_grey_alpha)
-			textureFlags |= TF_HAS_ALPHA;
+	name = filename;
+	fileType = FT_STB;
+	glTarget = GL_TEXTURE_2D;
+
+	switch(numChans) {
+		case 4:
+			formatName += (comp == 3) ? "RGB(X)" : "RGBA";
+			dataFormat = GL_RGBA;
+			glFormat = GL_RGBA;
+			break;
+		case 3:
+			formatName += "RGB";
+			dataFormat = GL_RGB;
+			glFormat = GL_RGB;
+			break;
+		case 2:
+			formatName += "Luminance+Alpha";
+			dataFormat = GL_LUMINANCE_ALPHA;
+			glFormat = GL_LUMINANCE_ALPHA;
+			break;
+		case 1:
+			formatName += "Luminance";
+			dataFormat = GL_LUMINANCE;
+			glFormat = GL_LUMINANCE;
+			break;
+	}
+
+	if(comp == STBI_rgb_alpha || comp == STBI_grey_alpha)
+		textureFlags |= TF_HAS_ALPHA;
+	if(pix != nullptr) {
 		texData = pix;
 		texDataFreeFun = [](void* texData, intptr_t) -> void { stbi_image_free(texData); };
+	}
 
-		elements.push_back( std::vector<MipLevel>() );
-		elements[0].push_back( Texture::MipLevel(w, h, pix) );
+	int bytesPerChan = (glType == GL_FLOAT) ? 4 : ((glType == GL_UNSIGNED_SHORT) ? 2 : 1);
+	uint32_t size = uint32_t(w) * uint32_t(h) * numChans * bytesPerChan;
+	cpuDataSize = (pix != nullptr) ? size : 0;
 
+	elements.push_back( std::vector<MipLevel>() );
+	elements[0].push_back( Texture::MipLevel(w, h, pix, size) );
+
+	if(cacheKey != 0) {
+		SaveToDiskCache(cacheKey, filename);
+	}
+
+	return true;
+}
+
+// gets the offset of each mip level's first image in a KTX1 or KTX2 file,
+// returns false if the file is broken or the data isn't stored as is
+static bool GetKTXlevelFileOffsets(const ktxTexture* ktxTex, const MemMappedFile* mmf,
+                                   std::vector<uint64_t>& offsets)
+{
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	const uint32_t numLevels = ktxTex->numLevels;
+	offsets.resize(numLevels);
+	if(ktxTex->classId == ktxTexture2_c) {
+		// the level index with 3 uint64 per level (byteOffset, byteLength,
+		// uncompressedByteLength) comes right after the 80 bytes header
+		if(80 + uint64_t(numLevels) * 24 > mmf->length) {
+			return false;
+		}
+		for(uint32_t i=0; i < numLevels; ++i) {
+			uint64_t levelIndex[3];
+			memcpy(levelIndex, data + 80 + i * 24, sizeof(levelIndex));
+			if(levelIndex[0] > mmf->length || levelIndex[1] > mmf->length - levelIndex[0]) {
+				return false;
+			}
+			offsets[i] = levelIndex[0];
+		}
 		return true;
-	} else {
-		formatName = nullptr;
-		glType = 0;
 	}
+	// KTX1: header (64 bytes), key/value data, then for each level its imageSize
+	// followed by the images. if the endianness doesn't match, libktx must swap the data
+	uint32_t endianness, kvdSize;
+	memcpy(&endianness, data + 12, 4);
+	memcpy(&kvdSize, data + 60, 4);
+	if(endianness != 0x04030201) {
+		return false;
+	}
+	const bool isCubeNotArray = ktxTex->isCubemap && !ktxTex->isArray;
+	uint64_t pos = 64 + uint64_t(kvdSize);
+	for(uint32_t i=0; i < numLevels; ++i) {
+		uint32_t imageSize = 0;
+		if(pos + 4 > mmf->length) {
+			return false;
+		}
+		memcpy(&imageSize, data + pos, 4);
+		pos += 4;
+		offsets[i] = pos;
+		// for non-array cubemaps imageSize is the size of one face, each padded to 4 bytes
+		// (like libktx, assume that mip levels need no extra padding, uncompressed rows are
+		//  padded to 4 bytes and compressed blocks are multiples of 4 bytes anyway)
+		const uint64_t paddedSize = (uint64_t(imageSize) + 3) & ~uint64_t(3);
+		pos += isCubeNotArray ? paddedSize * ktxTex->numFaces : paddedSize;
+		if(pos > mmf->length) {
+			return false;
+		}
+	}
+	return true;
+}
 
-	// TODO: anything else to try?
+// if the KTX file's image data is stored as is (not supercompressed, no byte
+// swapping needed), this sets the mip levels up to point to it in the mmap (instead of
+// the dummy levels), so it can be uploaded with the normal upload code instead of
+// ktxTexture_GLUpload() - which would first load it into a copy on the heap
+bool Texture::SetKTXmipPointers(ktxTexture* ktxTex, const MemMappedFile* mmf)
+{
+	if(ktxTex->classId == ktxTexture2_c
+	   && ((ktxTexture2*)ktxTex)->supercompressionScheme != KTX_SS_NONE) {
+		return false;
+	}
+	if(ktxTex->baseDepth > 1 || ktxTexture_NeedsTranscoding(ktxTex)) {
+		return false; // 3D textures aren't supported by the own upload code (yet)
+	}
+	GLint intFmt = 0;
+	GLenum baseFmt = 0, fmt = 0, type = 0;
+	if(!ktxTexture_GetOpenGLFormat(ktxTex, &intFmt, &baseFmt, &fmt, &type) || intFmt == 0
+	   || (!ktxTex->isCompressed && (fmt == 0 || type == 0))) {
+		return false;
+	}
+	std::vector<uint64_t> levelOffsets;
+	if(!GetKTXlevelFileOffsets(ktxTex, mmf, levelOffsets)) {
+		return false;
+	}
+	const unsigned char* data = (const unsigned char*)mmf->data;
+	const uint32_t numFaces = ktxTex->numFaces;
+	for(size_t e=0; e < elements.size(); ++e) {
+		const uint32_t layer = uint32_t(e / numFaces);
+		const uint32_t face = uint32_t(e % numFaces);
+		std::vector<MipLevel>& mipLevels = elements[e];
+		for(uint32_t level=0; level < mipLevels.size(); ++level) {
+			// the images in a level are laid out like in libktx's pData
+			ktx_size_t levelStart = 0, imgOffset = 0;
+			if(ktxTexture_GetImageOffset(ktxTex, level, 0, 0, &levelStart) != KTX_SUCCESS
+			   || ktxTexture_GetImageOffset(ktxTex, level, layer, face, &imgOffset) != KTX_SUCCESS) {
+				return false;
+			}
+			const uint64_t fileOffset = levelOffsets[level] + (imgOffset - levelStart);
+			if(fileOffset > mmf->length || mipLevels[level].size > mmf->length - fileOffset) {
+				return false;
+			}
+			mipLevels[level].data = data + fileOffset;
+		}
+	}
 
-	errprintf("Couldn't load '%s', maybe the filetype is unsupported?\n", filename);
-	UnloadMemMappedFile(mmf);
-	return false;
+	dataFormat = intFmt;
+	if(ktxTex->isCompressed) {
+		// like for DDS, only needed for glTexImage3D(..., NULL)
+		glFormat = baseFmt;
+		glType = GL_UNSIGNED_BYTE;
+	} else {
+		glFormat = fmt;
+		glType = type;
+		// KTX1 pads rows of uncompressed data to 4 bytes, KTX2 doesn't
+		unpackAlignment = (ktxTex->classId == ktxTexture1_c) ? 4 : 1;
+	}
+	if(IsArray()) {
+		glTarget = IsCubemap() ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_2D_ARRAY;
+	} else {
+		glTarget = IsCubemap() ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	}
+	return true;
 }
 
-bool Texture::LoadKTX(MemMappedFile* mmf, const char* filename)
+bool Texture::LoadKTX(MemMappedFile* mmf, const char* filename, LoadProgress* progress, bool infoOnly)
 {
 	ktxTexture* ktxTex = nullptr;
 	const unsigned char* data = (const unsigned char*)mmf->data;
 	ktx_error_code_e res;
 
-	res = ktxTexture_CreateFromMemory(data, mmf->length,
-						   KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTex);
+	if(progress != nullptr) {
+		progress->Set("Loading KTX");
+	}
+
+	// the image data is *not* loaded here, libktx only parses the header (and the key/value data).
+	// if the data isn't supercompressed, it's uploaded directly from the mmap (see SetKTXmipPointers()),
+	// otherwise ktxTexture_GLUpload() loads (and inflates) the levels one at a time directly from
+	// the mmap (with ktxTexture_IterateLoadLevelFaces()), so even for huge supercompressed
+	// textures only the memory for one level is needed
+	res = ktxTexture_CreateFromMemory(data, mmf->length, KTX_TEXTURE_CREATE_NO_FLAGS, &ktxTex);
 
 	if(res != KTX_SUCCESS) {
 		errprintf("libktx couldn't load '%s': %s (%d)\n", filename, ktxErrorString(res), res);
@@ -457,31 +1454,96 @@ bool Texture::LoadKTX(MemMappedFile* mmf, const char* filename)
 		ktxTex2 = (ktxTexture2*)ktxTex;
 	}
 
-	if(ktxTexture_NeedsTranscoding(ktxTex)) {
-		res = ktxTexture2_TranscodeBasis(ktxTex2, KTX_TTF_BC7_RGBA, 0);
+	if(progress != nullptr && progress->IsCancelled()) {
+		ktxTexture_Destroy(ktxTex);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+
+	bool needsTranscoding = ktxTexture_NeedsTranscoding(ktxTex);
+	// transcoding takes a while, so if this was transcoded before, just use that.
+	// the transcoded data depends on the target format (and thus the GPU)
+	uint64_t cacheKey = 0;
+	if(needsTranscoding && !infoOnly) {
+		int targetFmt = ChooseBasisTarget(ktxTex2, nullptr);
+		cacheKey = (targetFmt >= 0) ? GetDiskCacheKey(mmf, filename, uint32_t(targetFmt)) : 0;
+		if(cacheKey != 0 && LoadFromDiskCache(cacheKey, filename)) {
+			name = filename;
+			ktxTexture_Destroy(ktxTex);
+			UnloadMemMappedFile(mmf);
+			return true;
+		}
+	}
+	// BasisU transcoding needs all the data in memory. Furthermore libktx's level-by-level
+	// loading is broken for zlib supercompression (it compares the still compressed size
+	// to the uncompressed size), so in those cases all levels are loaded right away
+	bool loadAllNow = needsTranscoding
+		|| (ktxTex2 != nullptr && ktxTex2->supercompressionScheme == KTX_SS_ZLIB);
+	if(loadAllNow && !infoOnly) {
+		res = ktxTexture_LoadImageData(ktxTex, nullptr, 0);
+		if(res != KTX_SUCCESS) {
+			errprintf("libktx couldn't load the image data of '%s': %s (%d)\n", filename, ktxErrorString(res), res);
+			ktxTexture_Destroy(ktxTex);
+			UnloadMemMappedFile(mmf);
+			return false;
+		}
+	}
+	// usually the BasisU data is transcoded with several threads by TranscodeBasis()
+	// (in transcode.cpp), the things that can't handle are left to libktx
+	bool ownTranscode = needsTranscoding && !infoOnly && CanTranscodeBasis(ktxTex2);
+	if(needsTranscoding && !infoOnly && !ownTranscode) {
+		if(progress != nullptr) {
+			progress->Set("Transcoding");
+		}
+		const char* targetName = nullptr;
+		int targetFmt = ChooseBasisTarget(ktxTex2, &targetName);
+		if(targetFmt < 0) {
+			errprintf("Can't transcode '%s', found no format that's supported by both the GPU and the transcoder\n", filename);
+			ktxTexture_Destroy(ktxTex);
+			UnloadMemMappedFile(mmf);
+			return false;
+		}
+		res = ktxTexture2_TranscodeBasis(ktxTex2, (ktx_transcode_fmt_e)targetFmt, 0);
 		if(res != KTX_SUCCESS) {
 			errprintf("libktx couldn't transcode '%s': %s (%d)\n", filename, ktxErrorString(res), res);
 			ktxTexture_Destroy(ktxTex);
 			UnloadMemMappedFile(mmf);
 			return false;
 		}
+		transcodeTarget = targetName;
+		if(progress != nullptr && progress->IsCancelled()) {
+			ktxTexture_Destroy(ktxTex);
+			UnloadMemMappedFile(mmf);
+			return false;
+		}
 	}
 	name = filename;
 	// TODO: maybe using GL-like names like the DDS loader uses would be nicer?
 	//   for that https://github.com/KhronosGroup/KTX-Specification/blob/main/formats.json could help
 	formatName = (ktxTex->classId == ktxTexture2_c) ? "KTX2 " : "KTX ";
-	formatName += ktxTexture_GetFormatName(ktxTex);
+	// BasisU textures that haven't been transcoded (yet) don't have a VkFormat
+	// (TranscodeBasis() sets the flags and transcodeTarget)
+	const bool isBasisU = needsTranscoding && (infoOnly || ownTranscode);
+	if(isBasisU) {
+		formatName += (ktxTex2->supercompressionScheme == KTX_SS_BASIS_LZ) ? "BasisU ETC1S" : "BasisU UASTC";
+		if(infoOnly) {
+			formatName += " (not transcoded)";
+		}
+	} else {
+		formatName += ktxTexture_GetFormatName(ktxTex);
+	}
 
-	this->ktxTex = ktxTex;
 	fileType = FT_KTX;
-	if(ktxTex->isCompressed)
-		textureFlags |= TF_COMPRESSED;
-	if(ktxTexture_FormatHasAlpha(ktxTex))
-		textureFlags |= TF_HAS_ALPHA;
-	else if(ktxTex2 != nullptr && ktxTexture2_GetPremultipliedAlpha(ktxTex2))
+	if(!isBasisU) {
+		if(ktxTex->isCompressed)
+			textureFlags |= TF_COMPRESSED;
+		if(ktxTexture_FormatHasAlpha(ktxTex))
+			textureFlags |= TF_HAS_ALPHA;
+		if(ktxTexture_FormatIsSRGB(ktxTex))
+			textureFlags |= TF_SRGB;
+	}
+	if((textureFlags & TF_HAS_ALPHA) == 0 && ktxTex2 != nullptr && ktxTexture2_GetPremultipliedAlpha(ktxTex2))
 		textureFlags |= TF_PREMUL_ALPHA;
-	if(ktxTexture_FormatIsSRGB(ktxTex))
-		textureFlags |= TF_SRGB;
 
 	int numMips = ktxTex->numLevels;
 	int numElements = 1;
@@ -509,21 +1571,43 @@ bool Texture::LoadKTX(MemMappedFile* mmf, const char* filename)
 		int w = ktxTex->baseWidth;
 		int h = ktxTex->baseHeight;
 		for(int i=0; i < numMips; ++i) {
-			// just use dummy miplevels for easy access to the mip sizes
-			mipLevels.push_back(MipLevel(w, h));
+			// just use dummy miplevels for easy access to the mip sizes (and the size in bytes).
+			// SetKTXmipPointers() sets the data, otherwise ktxTexture_GLUpload() does the upload
+			mipLevels.push_back(MipLevel(w, h, nullptr, (uint32_t)ktxTexture_GetImageSize(ktxTex, i)));
 			w = std::max(w/2, 1);
 			h = std::max(h/2, 1);
 		}
 	}
 
-	texData = mmf;
-	texDataFreeCookie = (intptr_t)ktxTex;
-	texDataFreeFun = [](void* texData, intptr_t cookie) -> void {
-		MemMappedFile* mmf = (MemMappedFile*)texData;
-		ktxTexture* ktxTex = (ktxTexture*)(void*)cookie;
+	if(ownTranscode) {
+		bool ok = TranscodeBasis(ktxTex2, filename, progress);
+		if(ok && cacheKey != 0) {
+			SaveToDiskCache(cacheKey, filename);
+		}
+		// the transcoded data in texData is all that's needed from now on
 		ktxTexture_Destroy(ktxTex);
 		UnloadMemMappedFile(mmf);
-	};
+		return ok;
+	}
+
+	if(!infoOnly && SetKTXmipPointers(ktxTex, mmf)) {
+		// libktx isn't needed anymore, the data is uploaded directly from the mmap
+		ktxTexture_Destroy(ktxTex);
+		texData = mmf;
+		cpuDataSize = mmf->length;
+		texDataFreeCookie = 0;
+		texDataFreeFun = FreeMemMappedTexData;
+		return true;
+	}
+
+	this->ktxTex = ktxTex;
+	texData = mmf;
+	cpuDataSize = mmf->length;
+	if(ktxTex->pData != nullptr) {
+		cpuDataSize += ktxTexture_GetDataSize(ktxTex);
+	}
+	texDataFreeCookie = (intptr_t)ktxTex;
+	texDataFreeFun = FreeKTXandMemMappedTexData;
 
 	return true;
 }
@@ -716,11 +1800,12 @@ struct UncomprFormatInfo {
 	uint32_t glIntFormat;
 	uint32_t glFormat;
 	uint32_t glType;
-	uint32_t bitsPerPixel;
+	int32_t pitchTypeOrBitsPPixel; // usually bits per pixel, WEIRD_LEGACY for the PF_* pixel pair formats
 
 	const char* name;
 
 	uint8_t ourFlags;
+	PackedFormat packedFormat; // for formats that are unpacked in the shader
 };
 
 #ifndef GL_RGB10_A2UI // GL3.3+ - I don't wanna bump the min GL version for one obscure format...
@@ -738,7 +1823,7 @@ const UncomprFormatInfo uncomprFormatTable[] = {
 	// encoded in many DDS files so I have this "duplicate" entry that has a ? in the name
 	// (and if the dds contains DXGI_FORMAT_R10G10B10A2_UNORM it gets a name without '?')
 	{ D3DFMT_A2B10G10R10, 0,  GL_RGBA,    GL_RGBA,    GL_UNSIGNED_INT_2_10_10_10_REV,  32, "RGB10A2 UNORM ?" },
-	{ D3DFMT_X1R5G5B5, 0,     GL_RGBA,    GL_BGRA,    GL_UNSIGNED_SHORT_1_5_5_5_REV,    8, "RGB5X1 UNORM", _TF_NOALPHA },
+	{ D3DFMT_X1R5G5B5, 0,     GL_RGBA,    GL_BGRA,    GL_UNSIGNED_SHORT_1_5_5_5_REV,   16, "RGB5X1 UNORM", _TF_NOALPHA },
 	{ D3DFMT_X8B8G8R8, 0,     GL_RGBA,    GL_RGBA,    GL_UNSIGNED_BYTE,                32, "RGBX8 UNORM", _TF_NOALPHA },
 	{ D3DFMT_R8G8B8,   0,     GL_RGB,     GL_BGR,     GL_UNSIGNED_BYTE,                24, "BGR8 UNORM" },
 	// I added D3DFMT_B8G8R8, it's non-standard. we use 220 for it (and so does Gimp), dxwrapper uses 19
@@ -892,8 +1977,18 @@ const UncomprFormatInfo uncomprFormatTable[] = {
 	     DXGI_FORMAT_B4G4R4A4_UNORM,        GL_RGBA4,      GL_BGRA,  GL_UNSIGNED_SHORT_4_4_4_4_REV, 16, "BGRA4" },
 
 	// TODO: DXGI_FORMAT_R1_UNORM = 66, (1bit format?! I don't think OpenGL supports that?)
-	// TODO: DXGI_FORMAT_R8G8_B8G8_UNORM (and the identical PIXEL_FMT_R8G8_B8G8)
-	// TODO: DXGI_FORMAT_G8R8_G8B8_UNORM (and the identical PIXEL_FMT_G8R8_G8B8)
+
+	// formats OpenGL doesn't have: uploaded as they are and unpacked in the shader (see PackedFormat).
+	// the pixel pair formats have one RGBA8UI texel for two pixels (with the same R and B, or U and V)
+	{ PIXEL_FMT_R8G8_B8G8,
+	     DXGI_FORMAT_R8G8_B8G8_UNORM,       GL_RGBA8UI,    GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, WEIRD_LEGACY, "RGBG8 (R8G8_B8G8) UNORM", _TF_NOALPHA, PF_R8G8_B8G8 },
+	{ PIXEL_FMT_G8R8_G8B8,
+	     DXGI_FORMAT_G8R8_G8B8_UNORM,       GL_RGBA8UI,    GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, WEIRD_LEGACY, "GRGB8 (G8R8_G8B8) UNORM", _TF_NOALPHA, PF_G8R8_G8B8 },
+	{ PIXEL_FMT_YUY2,
+	     DXGI_FORMAT_YUY2,                  GL_RGBA8UI,    GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, WEIRD_LEGACY, "YUY2 (YUV 4:2:2)", _TF_NOALPHA, PF_YUY2 },
+	{ PIXEL_FMT_UYVY, 0,                    GL_RGBA8UI,    GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, WEIRD_LEGACY, "UYVY (YUV 4:2:2)", _TF_NOALPHA, PF_UYVY },
+	{ D3DFMT_A8R3G3B2, 0,                   GL_R16UI,      GL_RED_INTEGER,  GL_UNSIGNED_SHORT, 16, "A8R3G3B2 UNORM", TF_HAS_ALPHA, PF_A8R3G3B2 },
+	{ D3DFMT_A4L4, 0,                       GL_R8UI,       GL_RED_INTEGER,  GL_UNSIGNED_BYTE,   8, "Alpha4 Luminance4", TF_HAS_ALPHA, PF_A4L4 },
 
 	// TODO: the remaining formats (DXGI_FORMAT_AYUV until DXGI_FORMAT_V408, except DXGI_FORMAT_B4G4R4A4_UNORM),
 	//       which are all YUV and similar formats for video, I think?
@@ -944,18 +2039,17 @@ const MaskToDxFormat maskToDxFormatTable[] = {
 	{ DDPF_RGBA, 16,   0xf00,       0xf0,       0xf,        0xf000,       D3DFMT_A4R4G4B4,     0 },
 	{ DDPF_RGBA, 16,   0xf00,       0xf0,       0xf,        0,            D3DFMT_X4R4G4B4,     0 },
 
-	{ DDPF_RGBA, 16,   0xe0,        0x1c,       0x3,        0xff00,       D3DFMT_A8R3G3B2,  0 }, // TODO: no opengl equivalent
+	{ DDPF_RGBA, 16,   0xe0,        0x1c,       0x3,        0xff00,       D3DFMT_A8R3G3B2,  0 }, // no opengl equivalent, unpacked in shader
 
 	{ DDPF_LUMINANCE, 16, 0xff,     0,          0,          0xff00,       D3DFMT_A8L8,         0 },
 	{ DDPF_LUMINANCE, 16, 0xffff,   0,          0,          0,            D3DFMT_L16,          0 },
 	// TODO: gli/data/kueken7_l8_unorm.dds doesn't load - but it *is* incomplete, even if VS2022 can display it.
 	{ DDPF_LUMINANCE,  8, 0xff,     0,          0,          0,            D3DFMT_L8,           0 },
 
-	{ DDPF_LUMINANCE,  8, 0x0f,     0,          0,          0xf0,         D3DFMT_A4L4,  0 }, // TODO: no opengl equivalent
+	{ DDPF_LUMINANCE|DDPF_ALPHAPIXELS, 8, 0x0f, 0, 0,      0xf0,         D3DFMT_A4L4,  0 }, // no opengl equivalent, unpacked in shader
 
 	// TODO: D3DFMT_CxV8U8, whatever *that* is
-	// TODO: what about PIXEL_FMT_R8G8_B8G8 and PIXEL_FMT_G8R8_G8B8 ?
-	// TODO: what about PIXEL_FMT_UYVY and PIXEL_FMT_YUY2 ?
+	// (PIXEL_FMT_R8G8_B8G8, PIXEL_FMT_G8R8_G8B8, PIXEL_FMT_UYVY and PIXEL_FMT_YUY2 are always FourCCs)
 };
 
 
@@ -1074,13 +2168,40 @@ static uint32_t CalcASTCmipSize(uint32_t w, uint32_t h, uint32_t blockW, uint32_
 	return std::max(1u, (w+blockW-1)/blockW) * std::max(1u, (h+blockH-1)/blockH) * 16;
 }
 
-bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
+int Texture::GetNumUsableMips(int width, int numMips, const char* filename) const
+{
+	// the OpenGL textures of pixel pair formats are half as wide (see GetGLWidth()), and halving
+	// that width for the next mip level doesn't always fit the halved width in pixels
+	// (6 -> 3 pixels need 3 -> 2 texels, but OpenGL's next level is 1 texel wide),
+	// so the mip levels from the first one that doesn't fit on can't be used
+	for(int i=1; i < numMips; ++i) {
+		uint32_t mipGLwidth = std::max(GetGLWidth(width) >> i, 1u);
+		if(GetGLWidth(std::max(width >> i, 1)) != mipGLwidth) {
+			errprintf("'%s' has a width (%d) that doesn't allow more than %d mip levels for format '%s', ignoring the others\n",
+			          filename, width, i, formatName.c_str());
+			return i;
+		}
+	}
+	return numMips;
+}
+
+// (infoOnly doesn't make a difference here, the pixel data is only referenced, not read.
+//  the memory mapped file is kept, but its pages for the pixel data are never touched)
+bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename, LoadProgress* progress, bool infoOnly)
 {
 	const unsigned char* data = (const unsigned char*)mmf->data;
 	const size_t len = mmf->length;
 	const unsigned char* dataEnd = data + len;
 	size_t dataOffset = 4 + sizeof(DDS_HEADER);
 
+	// NOTE: until texData is set to mmf below, mmf must be unloaded before returning false
+	//  (otherwise it leaks, which is especially bad when scanning lots of files in --info mode)
+	if(len < dataOffset) {
+		errprintf("Invalid DDS file `%s`, it's too small (%d bytes) for the DDS header!\n", filename, (int)len);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+
 	const DDS_HEADER* header = (const DDS_HEADER*)(data+4); // skip magic number ("DDF ")
 	const DDS_HEADER_DXT10* dx10header = nullptr;
 	int w = header->dwWidth;
@@ -1096,6 +2217,7 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 	if(fourcc == PIXEL_FMT_DX10) {
 		if(len < 148) {
 			errprintf("Invalid DDS file `%s`, says it has DX10 header but is only %d bytes!\n", filename, (int)len);
+			UnloadMemMappedFile(mmf);
 			return false;
 		}
 		dx10header = (const DDS_HEADER_DXT10*)(data + dataOffset);
@@ -1140,6 +2262,7 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 		} else if(fourcc == PIXEL_FMT_DX10) {
 			errprintf("Couldn't detect data format of '%s' - its dxgiFormat (%d) is in the ASTC-range, but apparently didn't match any actual format\n",
 			          filename, dxgiFmt);
+			UnloadMemMappedFile(mmf);
 			return false;
 		} // otherwise it was the "fourcc starts with 'AS'" case, for that also try the regular format table
 
@@ -1179,7 +2302,8 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 			glFormat = uncomprInfo.glFormat;
 			glType = uncomprInfo.glType;
 			formatName = uncomprInfo.name;
-			pitchTypeOrBitsPerPixel = uncomprInfo.bitsPerPixel;
+			pitchTypeOrBitsPerPixel = uncomprInfo.pitchTypeOrBitsPPixel;
+			packedFormat = uncomprInfo.packedFormat;
 			ourFlags = uncomprInfo.ourFlags;
 		}
 
@@ -1198,6 +2322,7 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 		                   char((fourcc >> 16) & 0xff), char((fourcc >> 24) & 0xff), 0 };
 		errprintf( "Couldn't detect data format of '%s' - FourCC: 0x%x ('%s' %d) dxgiFormat: %d\n",
 		           filename, fourcc, fccstr, fourcc, dxgiFmt );
+		UnloadMemMappedFile(mmf);
 		return false;
 	}
 	formatName.insert(0, "DDS ");
@@ -1230,6 +2355,13 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 		numCubeFaces = 6;
 		ourFlags |= TF_CUBEMAP_MASK;
 	}
+	if(isCubemap && packedFormat != PF_NONE) {
+		// the shader that unpacks those only supports 2D textures and 2D arrays
+		errprintf("'%s' is a cubemap in format '%s', which isn't supported (yet)\n",
+		          filename, formatName.c_str());
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
 
 	int numElements = 1;
 	// some kind of sanity check for the array size, there was a texture that had 0xffffffff set..
@@ -1272,11 +2404,20 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 	name = filename;
 	fileType = FT_DDS;
 	texData = mmf;
-	texDataFreeFun = [](void* texData, intptr_t) -> void { UnloadMemMappedFile( (MemMappedFile*)texData ); };
+	cpuDataSize = mmf->length;
+	texDataFreeFun = FreeMemMappedTexData;
+
+	const int numUsableMips = GetNumUsableMips(w, numMips, filename);
 
 	const unsigned char* dataCur = data + dataOffset;
 	elements.resize(numElements);
 	for(int e=0; e < numElements; ++e) {
+		if(progress != nullptr) {
+			if(progress->IsCancelled()) {
+				return false;
+			}
+			progress->Set("Parsing DDS", float(e) / numElements);
+		}
 		std::vector<MipLevel>& mipLevels = elements[e];
 		mipLevels.reserve(numMips);
 
@@ -1302,7 +2443,9 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 				// we can display the file despite the error
 				return (i > 0);
 			}
-			mipLevels.push_back( MipLevel(mipW, mipH, dataCur, mipSize) );
+			if(i < numUsableMips) {
+				mipLevels.push_back( MipLevel(mipW, mipH, dataCur, mipSize) );
+			}
 			if(mipW == 1 && mipH == 1 && i < numMips-1) {
 				errprintf( "Texture '%s' claimed to have %d MipMap levels, but we're already done after %d levels\n", filename, numMips, i+1 );
 				// don't break, I think - because for texture arrays it's important
@@ -1319,4 +2462,362 @@ bool Texture::LoadDDS(MemMappedFile* mmf, const char* filename)
 	return true;
 }
 
+
+// ##### Raw Import ######
+
+static std::mutex rawImportMutex;
+static std::unordered_map<std::string, RawImportParams> rawImports;
+
+void SetRawImportParams(const std::string& path, const RawImportParams& params)
+{
+	std::string absPath = IsStdinPath(path.c_str()) ? path : ToAbsolutePath(path.c_str());
+	std::lock_guard<std::mutex> lock(rawImportMutex);
+	rawImports[absPath] = params;
+}
+
+bool GetRawImportParams(const std::string& path, RawImportParams& params)
+{
+	std::lock_guard<std::mutex> lock(rawImportMutex);
+	auto it = rawImports.find(path);
+	if(it == rawImports.end()) {
+		return false;
+	}
+	params = it->second;
+	return true;
+}
+
+void GetRawImportFormats(std::vector<std::pair<const char*, int>>& formats)
+{
+	// several table entries can have the same name (like the DX10 and FourCC variants of
+	// a format), only the first one is found by FindRawFormat() anyway
+	auto addFormat = [&formats](const char* name, int dxgiFormat) {
+		for(auto& f : formats) {
+			if(strcmp(f.first, name) == 0) {
+				if(f.second == 0)
+					f.second = dxgiFormat;
+				return;
+			}
+		}
+		formats.push_back(std::make_pair(name, dxgiFormat));
+	};
+	for(const ComprFormatInfo& fi : comprFormatTable) {
+		addFormat(fi.name, fi.dxgiFormat);
+	}
+	for(const ASTCInfo& ai : astcFormatTable) {
+		addFormat(ai.name, ai.dxgiFormat);
+	}
+	for(const UncomprFormatInfo& fi : uncomprFormatTable) {
+		addFormat(fi.name, fi.dxgiFormat);
+	}
+}
+
+// the names tools like RenderDoc use for the formats of the resources they dump
+static const struct { int dxgiFormat; const char* name; } dxgiFormatNames[] = {
+#define DXGI_NAME(X) { DXGI_FORMAT_ ## X, #X }
+	DXGI_NAME(R32G32B32A32_TYPELESS), DXGI_NAME(R32G32B32A32_FLOAT), DXGI_NAME(R32G32B32A32_UINT),
+	DXGI_NAME(R32G32B32A32_SINT), DXGI_NAME(R32G32B32_TYPELESS), DXGI_NAME(R32G32B32_FLOAT),
+	DXGI_NAME(R32G32B32_UINT), DXGI_NAME(R32G32B32_SINT), DXGI_NAME(R16G16B16A16_TYPELESS),
+	DXGI_NAME(R16G16B16A16_FLOAT), DXGI_NAME(R16G16B16A16_UNORM), DXGI_NAME(R16G16B16A16_UINT),
+	DXGI_NAME(R16G16B16A16_SNORM), DXGI_NAME(R16G16B16A16_SINT), DXGI_NAME(R32G32_TYPELESS),
+	DXGI_NAME(R32G32_FLOAT), DXGI_NAME(R32G32_UINT), DXGI_NAME(R32G32_SINT), DXGI_NAME(R32G8X24_TYPELESS),
+	DXGI_NAME(D32_FLOAT_S8X24_UINT), DXGI_NAME(R32_FLOAT_X8X24_TYPELESS), DXGI_NAME(X32_TYPELESS_G8X24_UINT),
+	DXGI_NAME(R10G10B10A2_TYPELESS), DXGI_NAME(R10G10B10A2_UNORM), DXGI_NAME(R10G10B10A2_UINT),
+	DXGI_NAME(R11G11B10_FLOAT), DXGI_NAME(R8G8B8A8_TYPELESS), DXGI_NAME(R8G8B8A8_UNORM),
+	DXGI_NAME(R8G8B8A8_UNORM_SRGB), DXGI_NAME(R8G8B8A8_UINT), DXGI_NAME(R8G8B8A8_SNORM),
+	DXGI_NAME(R8G8B8A8_SINT), DXGI_NAME(R16G16_TYPELESS), DXGI_NAME(R16G16_FLOAT), DXGI_NAME(R16G16_UNORM),
+	DXGI_NAME(R16G16_UINT), DXGI_NAME(R16G16_SNORM), DXGI_NAME(R16G16_SINT), DXGI_NAME(R32_TYPELESS),
+	DXGI_NAME(D32_FLOAT), DXGI_NAME(R32_FLOAT), DXGI_NAME(R32_UINT), DXGI_NAME(R32_SINT),
+	DXGI_NAME(R24G8_TYPELESS), DXGI_NAME(D24_UNORM_S8_UINT), DXGI_NAME(R24_UNORM_X8_TYPELESS),
+	DXGI_NAME(X24_TYPELESS_G8_UINT), DXGI_NAME(R8G8_TYPELESS), DXGI_NAME(R8G8_UNORM), DXGI_NAME(R8G8_UINT),
+	DXGI_NAME(R8G8_SNORM), DXGI_NAME(R8G8_SINT), DXGI_NAME(R16_TYPELESS), DXGI_NAME(R16_FLOAT),
+	DXGI_NAME(D16_UNORM), DXGI_NAME(R16_UNORM), DXGI_NAME(R16_UINT), DXGI_NAME(R16_SNORM),
+	DXGI_NAME(R16_SINT), DXGI_NAME(R8_TYPELESS), DXGI_NAME(R8_UNORM), DXGI_NAME(R8_UINT),
+	DXGI_NAME(R8_SNORM), DXGI_NAME(R8_SINT), DXGI_NAME(A8_UNORM), DXGI_NAME(R1_UNORM),
+	DXGI_NAME(R9G9B9E5_SHAREDEXP), DXGI_NAME(R8G8_B8G8_UNORM), DXGI_NAME(G8R8_G8B8_UNORM),
+	DXGI_NAME(BC1_TYPELESS), DXGI_NAME(BC1_UNORM), DXGI_NAME(BC1_UNORM_SRGB), DXGI_NAME(BC2_TYPELESS),
+	DXGI_NAME(BC2_UNORM), DXGI_NAME(BC2_UNORM_SRGB), DXGI_NAME(BC3_TYPELESS), DXGI_NAME(BC3_UNORM),
+	DXGI_NAME(BC3_UNORM_SRGB), DXGI_NAME(BC4_TYPELESS), DXGI_NAME(BC4_UNORM), DXGI_NAME(BC4_SNORM),
+	DXGI_NAME(BC5_TYPELESS), DXGI_NAME(BC5_UNORM), DXGI_NAME(BC5_SNORM), DXGI_NAME(B5G6R5_UNORM),
+	DXGI_NAME(B5G5R5A1_UNORM), DXGI_NAME(B8G8R8A8_UNORM), DXGI_NAME(B8G8R8X8_UNORM),
+	DXGI_NAME(R10G10B10_XR_BIAS_A2_UNORM), DXGI_NAME(B8G8R8A8_TYPELESS), DXGI_NAME(B8G8R8A8_UNORM_SRGB),
+	DXGI_NAME(B8G8R8X8_TYPELESS), DXGI_NAME(B8G8R8X8_UNORM_SRGB), DXGI_NAME(BC6H_TYPELESS),
+	DXGI_NAME(BC6H_UF16), DXGI_NAME(BC6H_SF16), DXGI_NAME(BC7_TYPELESS), DXGI_NAME(BC7_UNORM),
+	DXGI_NAME(BC7_UNORM_SRGB), DXGI_NAME(AYUV), DXGI_NAME(Y410), DXGI_NAME(Y416), DXGI_NAME(NV12),
+	DXGI_NAME(P010), DXGI_NAME(P016), DXGI_NAME(420_OPAQUE), DXGI_NAME(YUY2), DXGI_NAME(Y210),
+	DXGI_NAME(Y216), DXGI_NAME(NV11), DXGI_NAME(AI44), DXGI_NAME(IA44), DXGI_NAME(P8), DXGI_NAME(A8P8),
+	DXGI_NAME(B4G4R4A4_UNORM), DXGI_NAME(P208), DXGI_NAME(V208), DXGI_NAME(V408),
+	DXGI_NAME(ASTC_4X4_TYPELESS), DXGI_NAME(ASTC_4X4_UNORM), DXGI_NAME(ASTC_4X4_UNORM_SRGB),
+	DXGI_NAME(ASTC_5X4_TYPELESS), DXGI_NAME(ASTC_5X4_UNORM), DXGI_NAME(ASTC_5X4_UNORM_SRGB),
+	DXGI_NAME(ASTC_5X5_TYPELESS), DXGI_NAME(ASTC_5X5_UNORM), DXGI_NAME(ASTC_5X5_UNORM_SRGB),
+	DXGI_NAME(ASTC_6X5_TYPELESS), DXGI_NAME(ASTC_6X5_UNORM), DXGI_NAME(ASTC_6X5_UNORM_SRGB),
+	DXGI_NAME(ASTC_6X6_TYPELESS), DXGI_NAME(ASTC_6X6_UNORM), DXGI_NAME(ASTC_6X6_UNORM_SRGB),
+	DXGI_NAME(ASTC_8X5_TYPELESS), DXGI_NAME(ASTC_8X5_UNORM), DXGI_NAME(ASTC_8X5_UNORM_SRGB),
+	DXGI_NAME(ASTC_8X6_TYPELESS), DXGI_NAME(ASTC_8X6_UNORM), DXGI_NAME(ASTC_8X6_UNORM_SRGB),
+	DXGI_NAME(ASTC_8X8_TYPELESS), DXGI_NAME(ASTC_8X8_UNORM), DXGI_NAME(ASTC_8X8_UNORM_SRGB),
+	DXGI_NAME(ASTC_10X5_TYPELESS), DXGI_NAME(ASTC_10X5_UNORM), DXGI_NAME(ASTC_10X5_UNORM_SRGB),
+	DXGI_NAME(ASTC_10X6_TYPELESS), DXGI_NAME(ASTC_10X6_UNORM), DXGI_NAME(ASTC_10X6_UNORM_SRGB),
+	DXGI_NAME(ASTC_10X8_TYPELESS), DXGI_NAME(ASTC_10X8_UNORM), DXGI_NAME(ASTC_10X8_UNORM_SRGB),
+	DXGI_NAME(ASTC_10X10_TYPELESS), DXGI_NAME(ASTC_10X10_UNORM), DXGI_NAME(ASTC_10X10_UNORM_SRGB),
+	DXGI_NAME(ASTC_12X10_TYPELESS), DXGI_NAME(ASTC_12X10_UNORM), DXGI_NAME(ASTC_12X10_UNORM_SRGB),
+	DXGI_NAME(ASTC_12X12_TYPELESS), DXGI_NAME(ASTC_12X12_UNORM), DXGI_NAME(ASTC_12X12_UNORM_SRGB),
+#undef DXGI_NAME
+};
+
+const char* GetDXGIFormatName(int dxgiFormat)
+{
+	for(const auto& dn : dxgiFormatNames) {
+		if(dn.dxgiFormat == dxgiFormat)
+			return dn.name;
+	}
+	return nullptr;
+}
+
+// format is either the name of a format from one of the tables, a DXGI_FORMAT name
+// (with or without the DXGI_FORMAT_ prefix) or number.
+// sets the info of the table it's from (the others keep glFormat == 0), returns false if not found
+static bool FindRawFormat(const std::string& format, ComprFormatInfo& comprInfo,
+                          ASTCInfo& astcInfo, UncomprFormatInfo& uncomprInfo)
+{
+	char* end = nullptr;
+	long dxgiFmt = strtol(format.c_str(), &end, 10);
+	if(format.empty() || *end != '\0') {
+		dxgiFmt = -1;
+		const char* name = format.c_str();
+		if(strncasecmp(name, "DXGI_FORMAT_", 12) == 0)
+			name += 12;
+		for(const auto& dn : dxgiFormatNames) {
+			if(strcasecmp(dn.name, name) == 0) {
+				dxgiFmt = dn.dxgiFormat;
+				break;
+			}
+		}
+	}
+	if(dxgiFmt >= 0) {
+		if(dxgiFmt == 0)
+			return false;
+		astcInfo = FindASTCFormat(DX10, dxgiFmt);
+		if(astcInfo.glFormat != 0)
+			return true;
+		comprInfo = FindComprFormat(DX10, dxgiFmt, 0, 0);
+		if(comprInfo.glFormat != 0)
+			return true;
+		uncomprInfo = FindUncomprFourCCFormat(0, dxgiFmt);
+		return uncomprInfo.glFormat != 0;
+	}
+
+	for(const ComprFormatInfo& fi : comprFormatTable) {
+		if(strcasecmp(fi.name, format.c_str()) == 0) {
+			comprInfo = fi;
+			comprInfo.ourFlags |= TF_COMPRESSED;
+			return true;
+		}
+	}
+	for(const ASTCInfo& ai : astcFormatTable) {
+		if(strcasecmp(ai.name, format.c_str()) == 0) {
+			astcInfo = ai;
+			astcInfo.ourFlags |= TF_COMPRESSED;
+			return true;
+		}
+	}
+	for(const UncomprFormatInfo& fi : uncomprFormatTable) {
+		if(strcasecmp(fi.name, format.c_str()) == 0) {
+			uncomprInfo = fi;
+			return true;
+		}
+	}
+	return false;
+}
+
+// the data is laid out like in a DDS file without header: all mip levels of the first
+// array element, then all mip levels of the second one, etc. Like for DDS, the MipLevels
+// point right into the mmap, so it doesn't matter how big the file is
+bool Texture::LoadRaw(MemMappedFile* mmf, const RawImportParams& params, const char* filename,
+                      LoadProgress* progress, bool infoOnly)
+{
+	(void)infoOnly; // the pixel data is only referenced, not read, so no difference here
+
+	// NOTE: like in LoadDDS(), mmf must be unloaded before returning false, until texData is set
+	ComprFormatInfo comprInfo = {};
+	ASTCInfo astcInfo = {};
+	UncomprFormatInfo uncomprInfo = {};
+	if(!FindRawFormat(params.format, comprInfo, astcInfo, uncomprInfo)) {
+		errprintf("Unknown format '%s' for raw import of '%s' (run texview --raw-format list to see the supported ones)\n",
+		          params.format.c_str(), filename);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+	const uint32_t w = params.width;
+	const uint32_t h = params.height;
+	if(w == 0 || h == 0 || params.numMips == 0 || params.arraySize == 0 || w > 65536 || h > 65536) {
+		errprintf("Invalid size for raw import of '%s': %u x %u, %u mip levels, array size %u\n",
+		          filename, w, h, params.numMips, params.arraySize);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+	int maxMips = 1;
+	while((std::max(w, h) >> maxMips) > 0)
+		++maxMips;
+	if(params.numMips > (uint32_t)maxMips) {
+		errprintf("Raw import of '%s': a %u x %u texture can't have more than %d mip levels, not %u\n",
+		          filename, w, h, maxMips, params.numMips);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+
+	uint32_t ourFlags = 0;
+	int32_t pitchTypeOrBitsPerPixel = 0; // unused for ASTC
+	const bool isASTC = (astcInfo.glFormat != 0);
+	if(isASTC) {
+		dataFormat = astcInfo.glFormat;
+		formatName = astcInfo.name;
+		ourFlags = astcInfo.ourFlags;
+	} else if(comprInfo.glFormat != 0) {
+		dataFormat = comprInfo.glFormat;
+		formatName = comprInfo.name;
+		pitchTypeOrBitsPerPixel = comprInfo.pitchTypeOrBitsPPixel;
+		ourFlags = comprInfo.ourFlags;
+	} else {
+		dataFormat = uncomprInfo.glIntFormat;
+		glFormat = uncomprInfo.glFormat;
+		glType = uncomprInfo.glType;
+		formatName = uncomprInfo.name;
+		pitchTypeOrBitsPerPixel = uncomprInfo.pitchTypeOrBitsPPixel;
+		packedFormat = uncomprInfo.packedFormat;
+		ourFlags = uncomprInfo.ourFlags;
+	}
+	const bool isCompressed = (ourFlags & TF_COMPRESSED) != 0;
+	if(isCompressed) {
+		// see LoadDDS()
+		glFormat = dg_glGetBaseInternalFormat(dataFormat);
+		glType = GL_UNSIGNED_BYTE;
+	}
+	formatName.insert(0, "Raw ");
+	if((ourFlags & _TF_NOALPHA) == 0 && dg_glInternalFormatHasAlpha(dataFormat)) {
+		ourFlags |= TF_HAS_ALPHA;
+	}
+	ourFlags &= ~_TF_NOALPHA;
+
+	// size of a row (of blocks for compressed formats) of the first mip level and how many there are
+	uint32_t rowSize = 0;
+	uint32_t numRows = h;
+	if(isASTC) {
+		rowSize = CalcASTCmipSize(w, astcInfo.blockH, astcInfo.blockW, astcInfo.blockH);
+		numRows = (h + astcInfo.blockH - 1) / astcInfo.blockH;
+	} else if(isCompressed) {
+		rowSize = CalcSize(w, 4, pitchTypeOrBitsPerPixel);
+		numRows = (h + 3) / 4;
+	} else {
+		rowSize = CalcSize(w, 1, pitchTypeOrBitsPerPixel);
+	}
+	uint32_t rowPitch = rowSize;
+	if(params.rowPitch != 0 && params.rowPitch != rowSize) {
+		const char* err = nullptr;
+		rowPitch = params.rowPitch;
+		if(params.numMips > 1) {
+			err = "a row pitch can only be set for a single mip level";
+		} else if(rowPitch < rowSize) {
+			err = "the row pitch is smaller than a row";
+		} else if(isCompressed) {
+			err = "a row pitch (other than the row size) is only supported for uncompressed formats";
+		} else {
+			// the usual 4 or 8 byte alignments can be done with GL_UNPACK_ALIGNMENT,
+			// other pitches need GL_UNPACK_ROW_LENGTH, which is in texels
+			for(uint32_t a = 2; a <= 8; a *= 2) {
+				if(((rowSize + a - 1) & ~(a - 1)) == rowPitch) {
+					unpackAlignment = a;
+					break;
+				}
+			}
+			uint32_t bytesPerTexel = (pitchTypeOrBitsPerPixel == WEIRD_LEGACY) ? 4 : pitchTypeOrBitsPerPixel / 8;
+			if(unpackAlignment > 1) {
+				// already done
+			} else if(pitchTypeOrBitsPerPixel > 0 && (pitchTypeOrBitsPerPixel % 8) != 0) {
+				err = "the pixels of this format aren't whole bytes, so they can't have a row pitch";
+			} else if(rowPitch % bytesPerTexel != 0) {
+				err = "the row pitch must be a multiple of the texel size";
+			} else {
+				unpackRowLength = rowPitch / bytesPerTexel;
+			}
+		}
+		if(err != nullptr) {
+			errprintf("Raw import of '%s' (%s, %u x %u, row size %u bytes) with row pitch %u failed: %s\n",
+			          filename, formatName.c_str(), w, h, rowSize, rowPitch, err);
+			UnloadMemMappedFile(mmf);
+			return false;
+		}
+	}
+
+	// the size (in bytes, incl. the row pitch padding) each mip level of an element takes in the file
+	std::vector<uint64_t> mipSizes(params.numMips);
+	uint64_t elementSize = 0;
+	for(uint32_t i=0; i < params.numMips; ++i) {
+		uint32_t mipW = std::max(w >> i, 1u);
+		uint32_t mipH = std::max(h >> i, 1u);
+		if(i == 0) {
+			// the last row doesn't need to be padded
+			mipSizes[i] = uint64_t(rowPitch) * (numRows - 1) + rowSize;
+		} else if(isASTC) {
+			mipSizes[i] = CalcASTCmipSize(mipW, mipH, astcInfo.blockW, astcInfo.blockH);
+		} else {
+			mipSizes[i] = CalcSize(mipW, mipH, pitchTypeOrBitsPerPixel);
+		}
+		elementSize += (i == 0) ? uint64_t(rowPitch) * numRows : mipSizes[i];
+	}
+	// (and the last row of the last element doesn't need to be padded either)
+	const uint64_t padding = uint64_t(rowPitch) * numRows - mipSizes[0];
+	// the offset and array size come from the user and can be huge, so watch out for overflows
+	uint64_t dataSize = UINT64_MAX; // of all elements, stays UINT64_MAX if it doesn't fit
+	if(params.arraySize <= UINT64_MAX / elementSize) {
+		dataSize = elementSize * params.arraySize - padding;
+	}
+	const bool tooSmall = params.offset > mmf->length || dataSize > mmf->length - params.offset;
+	// (only for the error message)
+	const uint64_t neededSize = (dataSize > UINT64_MAX - params.offset) ? UINT64_MAX : params.offset + dataSize;
+	if(mipSizes[0] > UINT32_MAX || tooSmall) {
+		errprintf("'%s' is too small for a %s texture of %u x %u with %u mip levels and array size %u at offset %llu: needs %llu bytes, but has %llu\n",
+		          filename, formatName.c_str(), w, h, params.numMips, params.arraySize,
+		          (unsigned long long)params.offset, (unsigned long long)neededSize, (unsigned long long)mmf->length);
+		UnloadMemMappedFile(mmf);
+		return false;
+	}
+
+	if(params.arraySize > 1) {
+		ourFlags |= TF_IS_ARRAY;
+		glTarget = GL_TEXTURE_2D_ARRAY;
+	} else {
+		glTarget = GL_TEXTURE_2D;
+	}
+	textureFlags = ourFlags;
+
+	name = filename;
+	fileType = FT_RAW;
+	texData = mmf;
+	cpuDataSize = mmf->length;
+	texDataFreeFun = FreeMemMappedTexData;
+
+	const int numUsableMips = GetNumUsableMips(w, params.numMips, filename);
+	const unsigned char* dataCur = (const unsigned char*)mmf->data + params.offset;
+	elements.resize(params.arraySize);
+	for(uint32_t e=0; e < params.arraySize; ++e) {
+		if(progress != nullptr) {
+			if(progress->IsCancelled()) {
+				return false;
+			}
+			progress->Set("Parsing raw data", float(e) / params.arraySize);
+		}
+		std::vector<MipLevel>& mipLevels = elements[e];
+		mipLevels.reserve(numUsableMips);
+		for(int i=0; i < numUsableMips; ++i) {
+			uint32_t mipW = std::max(w >> i, 1u);
+			uint32_t mipH = std::max(h >> i, 1u);
+			mipLevels.push_back( MipLevel(mipW, mipH, dataCur, (uint32_t)mipSizes[i]) );
+			dataCur += (i == 0) ? uint64_t(rowPitch) * numRows : mipSizes[i];
+		}
+		for(size_t i=numUsableMips; i < mipSizes.size(); ++i) {
+			dataCur += mipSizes[i];
+		}
+	}
+	return true;
+}
+
 } //namespace texview
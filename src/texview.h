@@ -8,7 +8,14 @@
 #define _TEXVIEW_H
 
 #include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -20,6 +27,8 @@
 #define errprintf(...) fprintf(stderr, __VA_ARGS__)
 
 struct ktxTexture;
+struct ktxTexture2;
+struct GLFWwindow;
 
 namespace texview {
 
@@ -33,9 +42,23 @@ inline int NumBitsSet(uint32_t x) {
 #endif
 }
 
+class Archive; // archive.cpp
+
+// the contents of a file, usually mmap()ed, but depending on the FileIOBackend
+// (and for things that can't be mapped, like pipes) it may have been read into memory
 struct MemMappedFile {
 	const void* data = nullptr;
 	size_t length = 0;
+	// last modification time in some OS-specific unit,
+	// only useful to compare it with another modTime of the same file
+	int64_t modTime = 0;
+	// if the file has been read into memory instead of mapped, data points to this
+	// malloc()ed buffer and the file is already closed
+	void* readBuffer = nullptr;
+	// for files inside an archive (see archive.cpp) data points into the archive's mapping
+	// (or into a pooled readBuffer the file was inflated into). This keeps the archive open,
+	// UnloadMemMappedFile() hands it to ReleaseArchivedFile()
+	std::shared_ptr<Archive> archive;
 #ifdef _WIN32
 	// using void* instead of HANDLE to avoid dragging in windows.h
 	// (HANDLE is just a void* anyway)
@@ -48,10 +71,117 @@ struct MemMappedFile {
 
 extern std::string ToAbsolutePath(const char* path);
 
-extern MemMappedFile* LoadMemMappedFile(const char* filename);
+// how LoadMemMappedFile() gets the file contents
+enum FileIOBackend : uint32_t {
+	FIO_MMAP, // map the file (default), only the parts that are accessed are actually read
+	// read the whole file into memory, big files in parallel chunks (with pread()).
+	// usually faster on network filesystems (NFS, SMB, FUSE) where page faults are expensive
+	FIO_READ,
+	_FIO_NUM
+};
+
+extern void SetFileIOBackend(FileIOBackend backend);
+extern FileIOBackend GetFileIOBackend();
+// returns the name of the backend ("mmap" or "read")
+extern const char* GetFileIOBackendName(FileIOBackend backend);
+// returns false if name is not "mmap" or "read"
+extern bool ParseFileIOBackend(const char* name, FileIOBackend& backend);
+
+// called by ReadStdin() each time more data has arrived, with everything that has
+// been read so far (finished is set once the stream has ended). return false to stop reading
+typedef bool (*StreamDataFun)(const void* data, size_t size, bool finished, void* user);
+
+// reads from stdin (usually a pipe) until it's closed, into a buffer that grows in big steps.
+// returns a MemMappedFile with readBuffer set, or NULL on error or if dataFun returned false
+extern MemMappedFile* ReadStdin(StreamDataFun dataFun, void* user);
+
+// returns true if stdin is a pipe or redirected from a file
+// (and not a terminal or something like /dev/null)
+extern bool IsStdinRedirected();
+
+// Texture::Load() reads from stdin if the filename is "-"
+inline bool IsStdinPath(const char* path) {
+	return path[0] == '-' && path[1] == '\0';
+}
 
 extern void UnloadMemMappedFile(MemMappedFile* mmf);
 
+// gets size and modification time (same unit as MemMappedFile::modTime) of a regular file
+// returns false if it doesn't exist or isn't a regular file
+extern bool GetFileSizeAndModTime(const char* path, uint64_t* size, int64_t* modTime);
+
+// returns the names (not full paths) of all regular files in the directory dirPath
+// in unspecified order. returns false if the directory can't be opened
+// if dirNames is set, the names of subdirectories (except for . and ..) are added to it
+extern bool ListDirectory(const char* dirPath, std::vector<std::string>& fileNames,
+                          std::vector<std::string>* dirNames = nullptr);
+
+// returns true if fileName has an extension of a file type texview can (probably) load
+extern bool HasSupportedFileExtension(const char* fileName);
+
+// returns the directory texview should put its cache files in (without trailing slash),
+// creates it if necessary. returns an empty string if that failed
+extern std::string GetCacheDir();
+
+// writes data to the file at path (replacing it, if it exists).
+// writes to a temporary file first and then renames it, so there's never a half-written file at path
+extern bool WriteWholeFile(const char* path, const void* data, size_t size);
+
+struct DataChunk {
+	const void* data;
+	size_t size;
+};
+
+// like WriteWholeFile() above, but the chunks are written one after the other,
+// so the data doesn't have to be copied into one buffer first
+extern bool WriteWholeFile(const char* path, const DataChunk* chunks, size_t numChunks);
+
+// deletes the file at path, returns false if that failed
+extern bool RemoveFile(const char* path);
+
+// sets the modification time of the file at path to now
+extern bool TouchFile(const char* path);
+
+// hints for how LoadMemMappedFile() maps files and how the mapped data will be accessed,
+// can be combined. Which ones help (if any) depends a lot on the filesystem (local SSD
+// vs network share), so they're configurable (TEXVIEW_MMAP_HINTS environment variable)
+enum MemMapHints : uint32_t {
+	MMH_NONE       = 0,
+	MMH_POPULATE   = 1, // read the whole file when mapping it (MAP_POPULATE, Linux only)
+	MMH_SEQUENTIAL = 2, // the file is mostly read front to back (MADV_SEQUENTIAL)
+	MMH_WILLNEED   = 4, // start reading the whole file in the background (MADV_WILLNEED)
+	MMH_HUGEPAGE   = 8, // use huge pages if possible (MADV_HUGEPAGE, Linux only)
+	MMH_READAHEAD  = 16, // read the next mip level in the background while the current one is uploaded
+};
+
+extern void SetMemMapHints(uint32_t hints);
+extern uint32_t GetMemMapHints();
+// parses a comma-separated list of hints like "sequential,readahead" (the MMH_* names
+// in lowercase, "none" for MMH_NONE). Unknown names are ignored (with a warning)
+extern uint32_t ParseMemMapHints(const char* str);
+
+// tells the OS that the given part of the mapped file will be read soon,
+// so it can be read in the background. Does nothing unless MMH_READAHEAD is set
+extern void ReadAheadMemMappedFile(const MemMappedFile* mmf, size_t offset, size_t length);
+
+// opens the file and maps it into memory with the given MemMapHints (or reads it, if backend
+// is FIO_READ). Files that can't be mapped (like named pipes or character devices) are always read
+extern MemMappedFile* LoadMemMappedFile(const char* filename, FileIOBackend backend, uint32_t memMapHints);
+
+// same as above with the FileIOBackend and MemMapHints set by the user
+inline MemMappedFile* LoadMemMappedFile(const char* filename) {
+	return LoadMemMappedFile(filename, GetFileIOBackend(), GetMemMapHints());
+}
+
+struct PageFaultCounts {
+	uint64_t minor = 0; // the page was already in memory (e.g. in the page cache)
+	uint64_t major = 0; // the page had to be read from disk (or network)
+};
+
+// page faults of the calling thread so far (of the whole process on systems that
+// don't count them per thread). returns false if they're not available (Windows)
+extern bool GetPageFaultCounts(PageFaultCounts& counts);
+
 enum TextureFlags : uint32_t {
 	TF_NONE         = 0,
 	TF_SRGB         = 1,
@@ -63,6 +193,8 @@ enum TextureFlags : uint32_t {
 	_TF_NOALPHA     = 1 << 7, // formats that use GL_RGBA or similar, but are RGBX (or similar) - just for the format tables!
 
 	TF_IS_ARRAY     = 1 << 8,
+	// 8bit indexed GL_R8 texture, the colors are in Texture::palette (looked up in the shader)
+	TF_INDEXED      = 1 << 9,
 
 	// at least DDS allows cubemaps with missing faces...
 	// so here's a separate flag for every cubemap face
@@ -78,13 +210,195 @@ enum TextureFlags : uint32_t {
 	                  | TF_CUBEMAP_ZPOS | TF_CUBEMAP_ZNEG,
 };
 
+// uncompressed (DDS) formats without an OpenGL equivalent. They're uploaded as they are,
+// as integer textures, and unpacked in the shader (see UpdateShaders() in main.cpp)
+enum PackedFormat : uint32_t {
+	PF_NONE = 0,
+	// these have two pixels (that share R and B or U and V) in one RGBA8UI texel,
+	// so the OpenGL texture is only half as wide, see Texture::GetGLWidth()
+	PF_R8G8_B8G8,
+	PF_G8R8_G8B8,
+	PF_YUY2,
+	PF_UYVY,
+	// one R16UI or R8UI texel per pixel
+	PF_A8R3G3B2,
+	PF_A4L4,
+};
+
+// shared between a Texture::Load() (that usually runs in a loader thread)
+// and whoever wants to know how far it got or wants to cancel it
+struct LoadProgress {
+	std::atomic<float> progress; // 0.0 .. 1.0, or < 0 if unknown
+	std::atomic<const char*> stage; // must point to a string literal
+	std::atomic<bool> cancelRequested;
+
+	LoadProgress() : progress(0.0f), stage("Waiting"), cancelRequested(false) {}
+
+	void Set(const char* stage_, float progress_ = -1.0f) {
+		stage.store(stage_, std::memory_order_relaxed);
+		progress.store(progress_, std::memory_order_relaxed);
+	}
+
+	bool IsCancelled() const {
+		return cancelRequested.load(std::memory_order_relaxed);
+	}
+};
+
+// decompress.cpp
+// returns "zstd" or "gzip" if data starts with the magic number of that format, else NULL
+extern const char* GetCompressedContainerName(const void* data, size_t size);
+// decompresses mmf (a zstd or gzip file, see GetCompressedContainerName()) into
+// a new MemMappedFile with readBuffer set. Returns NULL on error (or when cancelled)
+extern MemMappedFile* DecompressMemMappedFile(const MemMappedFile* mmf, const char* filename, LoadProgress* progress);
+
+// archive.cpp
+// Files inside PAK (Quake1/2) and ZIP (incl. PK3/PK4) archives are addressed with paths like
+// "/foo/baseq2/pak0.pak/textures/e1u1/floor1_1.wal", i.e. the archive is treated like a directory.
+
+// returns true if fileName ends with the extension of a supported archive type (.pak, .pk3, .pk4, .zip)
+extern bool HasArchiveExtension(const char* fileName);
+// if path is an archive or points to something inside one, sets archivePath to the archive's
+// path and innerPath to the rest (with '/' as separator, empty for the archive itself)
+// and returns true. Only the existence of the archive is checked, not of innerPath
+extern bool SplitArchivePath(const char* path, std::string& archivePath, std::string& innerPath);
+// returns the file innerPath of the archive at archivePath. If it's stored uncompressed
+// data points directly into the archive's mapping, if it's deflated it's inflated into
+// a buffer from a pool. Either way, free it with UnloadMemMappedFile(). NULL on error
+extern MemMappedFile* LoadArchivedFile(const char* archivePath, const char* innerPath);
+// called by UnloadMemMappedFile() for files with mmf->archive set
+extern void ReleaseArchivedFile(MemMappedFile* mmf);
+// like ListDirectory() for dirPath inside an archive (or the archive itself, for its root).
+// returns false if dirPath is not in an archive or the archive can't be opened
+extern bool ListArchiveDirectory(const char* dirPath, std::vector<std::string>& fileNames,
+                                 std::vector<std::string>* dirNames = nullptr);
+// like GetFileSizeAndModTime() for a file inside an archive, the modTime is the archive's
+extern bool GetArchivedFileSizeAndModTime(const char* path, uint64_t* size, int64_t* modTime);
+
+// headerless files (like GPU resources dumped by capture tools) have no format etc,
+// so that's given by the user (with the --raw-* commandline arguments or the import dialog)
+struct RawImportParams {
+	// the name of a format from the DDS format tables (see GetRawImportFormats()),
+	// a DXGI_FORMAT name like R8G8B8A8_UNORM (case doesn't matter) or a DXGI_FORMAT number
+	std::string format;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t numMips = 1;
+	uint32_t arraySize = 1;
+	uint64_t offset = 0; // where the data of the first mip level starts in the file
+	// bytes from the start of one row (of blocks for compressed formats) to the next,
+	// 0 means tightly packed. Only supported for a single mip level, as it'd be different for each
+	uint32_t rowPitch = 0;
+};
+
+// texload.cpp
+// from now on the file at path (absolute, or "-" for stdin) is loaded as raw data with params
+extern void SetRawImportParams(const std::string& path, const RawImportParams& params);
+// returns false if the file at path isn't loaded as raw data
+extern bool GetRawImportParams(const std::string& path, RawImportParams& params);
+// adds the names of the formats that can be used for RawImportParams::format,
+// with their DXGI_FORMAT number (0 for the ones that don't have one)
+extern void GetRawImportFormats(std::vector<std::pair<const char*, int>>& formats);
+// like "R8G8B8A8_UNORM" for DXGI_FORMAT_R8G8B8A8_UNORM, nullptr if unknown
+extern const char* GetDXGIFormatName(int dxgiFormat);
+
+// palette.cpp
+// loads a palette for TF_INDEXED textures from a 256 color PCX file, a JASC-PAL file
+// or a raw file with 256 * RGB (768 bytes, like Quake's gfx/palette.lmp)
+extern bool LoadPaletteFile(const char* path, std::vector<uint32_t>& colors);
+// sets colors to 256 shades of gray, for paletted images whose palette isn't available
+extern void GetGrayscalePalette(std::vector<uint32_t>& colors);
+
+// A persistently mapped pixel buffer object (GL_PIXEL_UNPACK_BUFFER) that's used
+// as a ring buffer for texture uploads: Worker threads copy the texture data into it
+// (so page faults in mmap()ed files and memcpy() don't happen on the main thread),
+// the main thread only issues the glTex(Sub)Image*() calls that read from the buffer.
+// Fences make sure that parts of the buffer are only reused once the GPU is done with them.
+// Needs OpenGL 4.4 or GL_ARB_buffer_storage. Init(), Shutdown(), Enqueue() etc
+// must be called from the thread that has the OpenGL context.
+class UploadRing {
+public:
+	struct CopyJob {
+		const void* src = nullptr;
+		size_t offset = 0; // in the buffer
+		size_t size = 0;
+		std::atomic<int> chunksLeft;
+		CopyJob() : chunksLeft(0) {}
+	};
+	typedef std::shared_ptr<CopyJob> Ticket;
+
+	bool Init(size_t size, int numCopyThreads = 2);
+	void Shutdown();
+
+	bool IsAvailable() const { return mappedPtr != nullptr; }
+	size_t GetSize() const { return ringSize; }
+
+	// reserves size bytes in the buffer and lets the worker threads copy data there.
+	// returns nullptr if there's not enough space (even after waiting for the GPU),
+	// then the data must be uploaded directly
+	Ticket Enqueue(const void* data, size_t size);
+
+	// waits until the copy is done and binds the buffer to GL_PIXEL_UNPACK_BUFFER.
+	// returns the "pointer" to pass to glTex(Sub)Image*() (it's an offset into the buffer)
+	const void* WaitForCopy(const Ticket& t);
+
+	// call this after the GL call reading the data of t has been issued,
+	// so that part of the buffer can be reused once the GPU is done with it
+	void Issued(const Ticket& t);
+
+	// if the data of t isn't needed after all, this frees its part of the buffer.
+	// cancels the parts of the copy that haven't started yet and waits for the rest,
+	// so afterwards the source data isn't accessed anymore and may be freed
+	void Release(const Ticket& t);
+
+private:
+	enum SegmentState { SEG_PENDING, SEG_ISSUED, SEG_RELEASED };
+	struct Segment {
+		Ticket job;
+		size_t end = 0;
+		void* fence = nullptr; // GLsync
+		SegmentState state = SEG_PENDING;
+	};
+	struct Chunk {
+		const void* src;
+		void* dst;
+		size_t size;
+		Ticket job;
+	};
+
+	uint32_t bufferHandle = 0;
+	unsigned char* mappedPtr = nullptr;
+	size_t ringSize = 0;
+	size_t head = 0;
+	std::deque<Segment> segments; // oldest first
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::condition_variable doneCond;
+	std::deque<Chunk> chunks;
+	bool shutdown = false;
+
+	void CopyThread();
+	bool FindSpace(size_t size, size_t& offset) const;
+	// frees the oldest segment, if possible. if wait is true, waits for the GPU/copy if necessary
+	bool FreeOldestSegment(bool wait);
+	Segment* FindSegment(const Ticket& t);
+	void WaitForCopyDone(const Ticket& t);
+};
+
 struct Texture {
 
 	enum FileType {
 		FT_NONE = 0,
 		FT_DDS,
 		FT_KTX, // TODO: extra case for KTX2?
-		FT_STB  // TODO: try to get actual type from stb_image
+		FT_STB, // TODO: try to get actual type from stb_image
+		// paletted formats decoded by texview itself (palette.cpp)
+		FT_WAL,
+		FT_PCX,
+		FT_BMP,
+		FT_TGA,
+		FT_RAW // headerless, see RawImportParams
 	};
 
 	struct MipLevel {
@@ -144,6 +458,18 @@ public:
 	// for formats that should be swizzled, in "simple" format like "agb1"
 	const char* defaultSwizzle = nullptr;
 
+	// for BasisU textures: the name of the format they were transcoded to, else NULL
+	const char* transcodeTarget = nullptr;
+
+	PackedFormat packedFormat = PF_NONE;
+
+	// rows of uncompressed mip levels are padded to this many bytes (GL_UNPACK_ALIGNMENT),
+	// 1 means they're tightly packed, which is the case for everything but KTX1
+	uint32_t unpackAlignment = 1;
+	// if set, rows of uncompressed mip levels are this many texels apart (GL_UNPACK_ROW_LENGTH),
+	// only for raw imports with a rowPitch that can't be expressed with unpackAlignment
+	uint32_t unpackRowLength = 0;
+
 	// texData is freed with texDataFreeFun
 	// it's const because it should generally not be modified (might be read-only mmap)
 	const void* texData = nullptr;
@@ -151,6 +477,52 @@ public:
 	TexDataFreeFun texDataFreeFun = nullptr;
 	ktxTexture* ktxTex = nullptr;
 
+	// how much CPU memory is used for texData and whatever belongs to it
+	// (if it's mmap()ed, that's not necessarily all in RAM, but could be)
+	size_t cpuDataSize = 0;
+	// size and modification time of the file at the time it was loaded,
+	// so we can tell if the file has changed since
+	uint64_t fileSize = 0;
+	int64_t fileModTime = 0;
+
+	// page faults while loading (in the loading thread), to compare the MemMapHints
+	PageFaultCounts loadFaults;
+
+	// hashes of the data of each MipLevel (index elemIdx * GetNumMips() + mipIdx), set by
+	// ComputeMipHashes(). Used by UpdateFromReloaded() to find out which ones have changed
+	std::vector<uint64_t> mipHashes;
+
+	// set by Load() if the file was compressed (like foo.dds.zst)
+	struct ContainerInfo {
+		const char* name = nullptr; // "zstd" or "gzip", NULL if it wasn't compressed
+		uint64_t decompressedSize = 0;
+		double decompressSeconds = 0.0;
+	} container;
+
+	// for TF_INDEXED textures, set with SetPalette()
+	struct Palette {
+		std::vector<uint32_t> colors; // 256 colors, bytes R, G, B, A in memory
+		std::string source; // path of the palette file, "embedded" or "grayscale"
+		unsigned int glHandle = 0; // 256x1 GL_RGBA8 texture, uploaded with the texture
+	} palette;
+
+private:
+	// state of an incremental upload with StartOpenGLupload() and ContinueOpenGLupload()
+	struct UploadState {
+		int nextMip = -1; // next mip level to upload (counting down), -1 if there's nothing left to upload
+		int nextElem = 0; // next element of that mip level to upload
+		int firstCompleteMip = 0; // all mips from this one to the smallest are completely uploaded
+		bool anySuccess = false;
+		bool immutableStorage = false; // allocated with glTex(ture)Storage*()
+		bool useDSA = false; // use direct state access functions (glTextureSubImage*() etc)
+		// for statistics: how much data has been uploaded, and how long the
+		// upload functions have been busy in total (not the time between frames)
+		size_t bytesUploaded = 0;
+		double secondsSpent = 0.0;
+		PageFaultCounts faults; // in the uploading thread, while in ContinueOpenGLupload()
+	} upload;
+
+public:
 	Texture() = default;
 
 	Texture(const Texture& other) = delete; // if needed we'll need reference counting or similar for texData
@@ -161,11 +533,17 @@ public:
 		textureFlags(other.textureFlags), dataFormat(other.dataFormat),
 		glFormat(other.glFormat), glType(other.glType), glTarget(other.glTarget),
 		glTextureHandle(other.glTextureHandle), defaultSwizzle(other.defaultSwizzle),
+		transcodeTarget(other.transcodeTarget), packedFormat(other.packedFormat),
+		unpackAlignment(other.unpackAlignment), unpackRowLength(other.unpackRowLength),
 		texData(other.texData), texDataFreeCookie(other.texDataFreeCookie),
-		texDataFreeFun(other.texDataFreeFun), ktxTex(other.ktxTex)
+		texDataFreeFun(other.texDataFreeFun), ktxTex(other.ktxTex),
+		cpuDataSize(other.cpuDataSize), fileSize(other.fileSize),
+		fileModTime(other.fileModTime), loadFaults(other.loadFaults),
+		mipHashes(std::move(other.mipHashes)), container(other.container), palette(std::move(other.palette)), upload(other.upload)
 	{
 		other.texDataFreeFun = nullptr;
 		other.glTextureHandle = 0;
+		other.palette.glHandle = 0;
 		other.ktxTex = nullptr;
 		other.Clear();
 	}
@@ -191,6 +569,14 @@ public:
 		other.glTextureHandle = 0;
 		defaultSwizzle = other.defaultSwizzle;
 		other.defaultSwizzle = nullptr;
+		transcodeTarget = other.transcodeTarget;
+		other.transcodeTarget = nullptr;
+		packedFormat = other.packedFormat;
+		other.packedFormat = PF_NONE;
+		unpackAlignment = other.unpackAlignment;
+		other.unpackAlignment = 1;
+		unpackRowLength = other.unpackRowLength;
+		other.unpackRowLength = 0;
 		texData = other.texData;
 		other.texData = nullptr;
 		texDataFreeCookie = other.texDataFreeCookie;
@@ -199,16 +585,134 @@ public:
 		other.texDataFreeFun = nullptr;
 		ktxTex = other.ktxTex;
 		other.ktxTex = nullptr;
+		cpuDataSize = other.cpuDataSize;
+		other.cpuDataSize = 0;
+		fileSize = other.fileSize;
+		fileModTime = other.fileModTime;
+		other.fileSize = 0;
+		other.fileModTime = 0;
+		loadFaults = other.loadFaults;
+		other.loadFaults = PageFaultCounts();
+		mipHashes = std::move(other.mipHashes);
+		other.mipHashes.clear();
+		container = other.container;
+		other.container = ContainerInfo();
+		palette = std::move(other.palette);
+		other.palette = Palette();
+		upload = other.upload;
+		other.upload = UploadState();
 
 		return *this;
 	}
 
-	bool Load(const char* filename);
+	// progress is optional; if set, the load can be cancelled through it
+	// and Load() will return false (without printing an error) when that happens
+	// if infoOnly is set, only the header is parsed: the format, size, mips etc
+	// are set, but nothing is decoded or transcoded (the MipLevels' data may be NULL),
+	// so the texture can't be uploaded. That's for the headless --info mode
+	bool Load(const char* filename, LoadProgress* progress = nullptr, bool infoOnly = false);
 
+	// creates the OpenGL texture and uploads everything at once
 	bool CreateOpenGLtexture();
 
+	// creates the OpenGL texture, but doesn't upload anything yet (except for KTX,
+	// libktx uploads everything at once). Then call ContinueOpenGLupload() each frame
+	// until it returns true. The smallest mip levels are uploaded first, so
+	// GetFirstCompleteMip() can be used as GL_TEXTURE_BASE_LEVEL to show them
+	// until the bigger ones are done.
+	// If allowImmutableStorage is true and the GPU supports it (and the format has a
+	// sized equivalent), the texture is allocated with glTex(ture)Storage*()
+	bool StartOpenGLupload(bool allowImmutableStorage = true);
+
+	// uploads mip levels (of all array elements/cube faces) until more than maxSeconds
+	// have passed (but at least one). Returns true when the upload is done (or failed).
+	// If ring is set (and available), the data is uploaded through it.
+	// Note that this binds the texture.
+	bool ContinueOpenGLupload(double maxSeconds, UploadRing* ring = nullptr);
+
+	// hashes the data of all MipLevels (see mipHashes), so a reloaded version of this
+	// texture can be compared to it. Called by the AsyncLoader if that's enabled
+	void ComputeMipHashes();
+
+	// for reloading a texture whose file has changed (see FileWatcher): if newTex has the
+	// same format, size, number of mips etc as this (completely uploaded) texture, this
+	// takes over its data and only uploads the mip levels of the array elements or cube faces
+	// whose contents have changed (according to mipHashes, everything if they're missing)
+	// with glTex(ture)SubImage*(), so the OpenGL texture is kept. numChanged is set to the
+	// number of those and newTex is empty afterwards.
+	// Returns false if that's not possible, then both textures are unchanged
+	bool UpdateFromReloaded(Texture& newTex, int& numChanged);
+
+	// replaces the palette of a TF_INDEXED texture (colors must have 256 entries) and
+	// updates the OpenGL palette texture if there is one, so no new upload is needed.
+	// source is shown in the UI
+	void SetPalette(const std::vector<uint32_t>& colors, const char* source);
+
+	bool UsesImmutableStorage() const {
+		return upload.immutableStorage;
+	}
+
+	bool UsesDSA() const {
+		return upload.useDSA;
+	}
+
+	// deletes the OpenGL texture (if any), but keeps the texture data
+	// so it can be uploaded again later
+	void ReleaseOpenGLtexture();
+
+	// frees the texture data on the CPU side (the mmap or the decoded pixels),
+	// if the texture has been completely uploaded - the MipLevels keep their sizes,
+	// but their data is NULL afterwards. When it's needed again (by StartOpenGLupload()),
+	// the file is loaded again (from the disk cache, if it was decoded or transcoded)
+	void ReleaseCPUData();
+
+	bool HasCPUData() const {
+		return texData != nullptr;
+	}
+
+	// sets a texture parameter (with glTextureParameteri() if possible,
+	// otherwise binds the texture and uses glTexParameteri())
+	void SetParameter(uint32_t pname, int value);
+
+	// how many bytes have been uploaded and how much time that took (so far)
+	void GetUploadStats(size_t& bytes, double& seconds) const {
+		bytes = upload.bytesUploaded;
+		seconds = upload.secondsSpent;
+	}
+
+	// page faults while uploading (so far). Faults in the UploadRing's
+	// worker threads aren't counted (unless the OS only counts per process)
+	PageFaultCounts GetUploadFaults() const {
+		return upload.faults;
+	}
+
+	bool IsUploadPending() const {
+		return upload.nextMip >= 0;
+	}
+
+	// the biggest mip level that (like all smaller ones) has been uploaded completely
+	// if that's GetNumMips(), nothing is usable yet
+	int GetFirstCompleteMip() const {
+		return upload.firstCompleteMip;
+	}
+
 	void Clear();
 
+	// true if the texture can't be sampled directly, but must be decoded in the shader
+	// (paletted textures and PackedFormats). Those are always sampled with GL_NEAREST
+	// and filtered in the shader
+	bool IsDecodedInShader() const {
+		return (textureFlags & TF_INDEXED) != 0 || packedFormat != PF_NONE;
+	}
+
+	// the width of the OpenGL texture for a mip level that's width pixels wide
+	uint32_t GetGLWidth(uint32_t width) const {
+		if(packedFormat >= PF_R8G8_B8G8 && packedFormat <= PF_UYVY) {
+			return (width + 1) / 2;
+		}
+		return width;
+	}
+
 	int GetNumMips() const {
 		return elements.empty() ? 0 : int(elements[0].size());
 	}
@@ -262,18 +766,305 @@ public:
 			*h = h_;
 	}
 
+	// (approximate) size of the texture in GPU memory, 0 if it hasn't been uploaded
+	size_t GetGPUMemoryUsage() const {
+		if(glTextureHandle == 0) {
+			return 0;
+		}
+		size_t ret = 0;
+		for(const std::vector<MipLevel>& mips : elements) {
+			for(const MipLevel& mip : mips) {
+				ret += mip.size;
+			}
+		}
+		if(palette.glHandle != 0) {
+			ret += palette.colors.size() * 4;
+		}
+		return ret;
+	}
+
+	size_t GetMemoryUsage() const {
+		return cpuDataSize + GetGPUMemoryUsage();
+	}
+
 	// returns NULL if not an _INTEGER texture
 	// otherwise it returns a string with the divisor to normalize the components in GLSL
 	const char* GetIntTexInfo(bool& isUnsigned);
 
 private:
-	bool LoadDDS(MemMappedFile* mmf, const char* filename);
-	bool LoadKTX(MemMappedFile* mmf, const char* filename);
+	bool LoadFile(const char* filename, LoadProgress* progress, bool infoOnly);
+	bool LoadDDS(MemMappedFile* mmf, const char* filename, LoadProgress* progress, bool infoOnly);
+	bool LoadKTX(MemMappedFile* mmf, const char* filename, LoadProgress* progress, bool infoOnly);
+	bool LoadRaw(MemMappedFile* mmf, const RawImportParams& params, const char* filename, LoadProgress* progress, bool infoOnly);
+	// for the pixel pair PackedFormats not all mip levels might fit OpenGL's mip chain,
+	// returns how many of them can be used
+	int GetNumUsableMips(int width, int numMips, const char* filename) const;
 
 	bool UploadTexture2D(uint32_t target, int internalFormat, int level, bool isCompressed, const Texture::MipLevel& mipLevel);
 	bool UploadTexture3Dslice(uint32_t target, int internalFormat, int level, int elemIdx, bool isCompressed, const Texture::MipLevel& mipLevel);
+	bool AllocTexture3Dlevel(int mipIdx);
+	bool AllocImmutableStorage(uint32_t sizedFormat);
+	bool UploadSubImage(int level, int layer, int cubeFace, bool isCompressed, const Texture::MipLevel& mipLevel);
+	bool UploadElement(int mipIdx, int elemIdx, UploadRing* ring, const UploadRing::Ticket& ticket);
+	// returns the layer of elements[elemIdx] in the OpenGL texture, like UploadSubImage()
+	// expects it, and sets cubeFace (0 to 5 for +X, -X, +Y, -Y, +Z, -Z; 0 if it's no cubemap)
+	int GetLayer(int elemIdx, int& cubeFace) const;
+	bool PrepareKTXforUpload();
+	bool ReloadCPUData();
+	// the MemMappedFile texData points to, NULL if it's something else
+	const MemMappedFile* GetMemMappedFile() const;
+	void ReadAheadMipLevel(int mipIdx);
+	// texDataFreeFuns for a MemMappedFile as texData (and a ktxTexture as cookie)
+	static void FreeMemMappedTexData(void* texData, intptr_t cookie);
+	static void FreeKTXandMemMappedTexData(void* texData, intptr_t cookie);
+	bool SetKTXmipPointers(ktxTexture* ktxTex, const MemMappedFile* mmf);
+	// diskcache.cpp
+	// returns the key for the cached data of the given source file, 0 if the disk cache is disabled.
+	// variant is for things that make the cached data different, like the transcode target
+	static uint64_t GetDiskCacheKey(const MemMappedFile* mmf, const char* filename, uint32_t variant);
+	// on success the texture data (and format etc) is from the cache file
+	bool LoadFromDiskCache(uint64_t cacheKey, const char* filename);
+	void SaveToDiskCache(uint64_t cacheKey, const char* filename);
+	// transcode.cpp
+	static bool CanTranscodeBasis(const ktxTexture2* ktxTex2);
+	// returns the ktx_transcode_fmt_e the texture should be transcoded to
+	// (and its name in targetName), or -1 if nothing suitable is supported
+	static int ChooseBasisTarget(const ktxTexture2* ktxTex2, const char** targetName);
+	// returns the (static) string from the transcode target table that equals name, or NULL
+	static const char* FindTranscodeTargetName(const char* name);
+	bool TranscodeBasis(ktxTexture2* ktxTex2, const char* filename, LoadProgress* progress);
+	// palette.cpp
+	// returns the FileType if mmf is a paletted image that LoadIndexed() can load, else FT_NONE
+	static FileType GetIndexedFileType(const MemMappedFile* mmf, const char* filename);
+	bool LoadIndexed(MemMappedFile* mmf, FileType type, const char* filename, LoadProgress* progress, bool infoOnly);
+	bool UploadPalette();
 };
 
+// Loads textures in background threads with Texture::Load(), so the UI doesn't
+// freeze while parsing/decoding/transcoding big files.
+// The finished Textures must be fetched (and uploaded to the GPU) by the main thread
+class AsyncLoader {
+public:
+	// called from a loader thread when a load is done, to wake up the main thread
+	typedef void(*NotifyFun)();
+
+	bool Init(NotifyFun notifyFun = nullptr);
+	void Shutdown();
+
+	// start loading path in the background. Cancels all other loads that are
+	// still in flight, only the most recently requested texture is of interest
+	void StartLoad(const char* path);
+
+	void CancelAll();
+
+	// load path in the background with low priority, for textures that will
+	// probably be needed soon (like the next file in the directory).
+	// Prefetches are only started when no regular load is waiting, aren't cancelled
+	// by StartLoad() and are returned by GetFinished() with isPrefetch = true.
+	// If StartLoad() is called for a path that's currently being prefetched,
+	// that prefetch becomes a regular load.
+	void Prefetch(const char* path);
+
+	// returns true if path is currently being loaded or prefetched (or waiting for it)
+	bool IsLoading(const char* path);
+
+	// call this from the main thread (regularly). Returns true if a load has
+	// finished, then path is set and tex contains the texture if success is true.
+	// isPrefetch is set if this was requested with Prefetch()
+	bool GetFinished(Texture& tex, std::string& path, bool& success, bool& isPrefetch);
+
+	// returns false if nothing is currently being loaded (prefetches don't count),
+	// otherwise sets path, stage and progress of the current load
+	bool GetCurrentLoad(std::string& path, const char*& stage, float& progress);
+
+	// if enabled, Texture::ComputeMipHashes() is called for each loaded texture (in the
+	// loader thread), so it can be updated incrementally when its file changes
+	void SetComputeMipHashes(bool enable) { computeMipHashes = enable; }
+
+private:
+	struct Job {
+		std::string path;
+		LoadProgress progress;
+		Texture tex;
+		bool success = false;
+		bool isPrefetch = false; // only modified with mutex locked
+	};
+	typedef std::shared_ptr<Job> JobPtr;
+
+	std::vector<std::thread> threads;
+	unsigned numThreads = 0;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<JobPtr> pendingJobs;
+	std::deque<JobPtr> pendingPrefetches;
+	std::vector<JobPtr> runningJobs;
+	std::deque<JobPtr> finishedJobs;
+	NotifyFun notify = nullptr;
+	bool shutdown = false;
+	std::atomic<bool> computeMipHashes;
+
+	void WorkerThread();
+	bool IsLoadingLocked(const char* path) const;
+
+public:
+	AsyncLoader() : computeMipHashes(false) {}
+};
+
+// Uploads textures to the GPU in its own thread with its own OpenGL context (that must
+// share objects with the main context), so even uploading huge textures doesn't
+// make the UI stutter. When a texture is done, a fence is created and the texture
+// is only returned by GetFinished() once the GPU has signaled it.
+class UploadThread {
+public:
+	typedef void(*NotifyFun)();
+
+	// context is a (hidden) GLFW window whose context shares objects with the
+	// main context. Must be called from the main thread, like Shutdown()
+	bool Init(GLFWwindow* context, NotifyFun notifyFun = nullptr);
+	void Shutdown();
+
+	bool IsRunning() const { return thread.joinable(); }
+
+	// moves tex to the upload thread (so tex is empty afterwards).
+	// cancels uploads that are still in progress or waiting, those textures
+	// are still returned by GetFinished(), but without an OpenGL texture
+	void Submit(Texture& tex, bool allowImmutableStorage, bool useRing);
+
+	// call this from the main thread (regularly). Returns true if a texture
+	// is finished, its glTextureHandle is 0 if it's not uploaded (cancelled or failed)
+	bool GetFinished(Texture& tex);
+
+	// returns false if nothing is being uploaded,
+	// otherwise sets path and progress of the current upload
+	bool GetCurrentUpload(std::string& path, float& progress);
+
+	// returns true if anything is waiting to be uploaded, being uploaded
+	// or waiting to be fetched with GetFinished()
+	bool IsBusy();
+
+private:
+	struct Job {
+		Texture tex;
+		bool allowImmutableStorage = true;
+		bool useRing = true;
+		void* fence = nullptr; // GLsync
+	};
+	typedef std::shared_ptr<Job> JobPtr;
+
+	GLFWwindow* context = nullptr;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<JobPtr> pendingJobs;
+	JobPtr runningJob;
+	std::deque<JobPtr> finishedJobs;
+	NotifyFun notify = nullptr;
+	bool shutdown = false;
+	std::atomic<bool> cancelRunning;
+	std::atomic<float> runningProgress;
+	std::string runningPath; // protected by mutex
+
+	UploadRing ring; // only used by the upload thread
+
+	void ThreadFun();
+
+public:
+	UploadThread() : cancelRunning(false), runningProgress(0.0f) {}
+};
+
+// keeps recently viewed textures (incl. their OpenGL textures) around, so going
+// back to them doesn't require loading them again. Once the memory budget is
+// exceeded, the least recently used textures are thrown out.
+// Only use this from the main thread (the one with the OpenGL context)!
+class TextureCache {
+public:
+	void SetBudget(size_t bytes);
+	size_t GetBudget() const { return budget; }
+
+	// moves tex into the cache (if it's not too big), so tex is empty afterwards.
+	// might evict other textures to stay within the budget
+	void Put(Texture& tex);
+
+	// if there's a texture for path (must be absolute) in the cache and the file
+	// hasn't changed since it was loaded, move it into tex, remove it from the
+	// cache and return true
+	bool Take(const std::string& path, Texture& tex);
+
+	bool Contains(const std::string& path) const;
+
+	size_t GetMemoryUsage() const { return memUsage; }
+	int GetNumTextures() const { return int(entries.size()); }
+
+	void Clear();
+
+private:
+	std::list<Texture> entries; // most recently used first
+	size_t memUsage = 0;
+	size_t budget = size_t(1024) * 1024 * 1024;
+
+	void EvictToBudget(size_t budgetToReach);
+};
+
+// Watches the file of the current texture (or the archive it's in) in a background
+// thread and reports when it has changed, so it can be reloaded automatically.
+// Uses inotify on Linux, elsewhere the modification time is checked twice a second.
+// Changes are debounced: they're only reported once the file hasn't been touched
+// for a moment, so a file that's still being written isn't loaded half-done
+class FileWatcher {
+public:
+	// called from the watcher thread when a change was detected, to wake up the main thread
+	typedef void(*NotifyFun)();
+
+	bool Init(NotifyFun notifyFun = nullptr);
+	void Shutdown();
+
+	// watch the file at path (absolute) instead of the one watched before. modTime is
+	// the modification time the file (or the archive) had when it was loaded, so changes
+	// in the meantime aren't missed. Stops watching if path is empty or stdin
+	void Watch(const std::string& path, int64_t modTime);
+
+	// call this from the main thread (regularly). Returns true if the watched file
+	// has changed, then path is set to the path that was passed to Watch()
+	bool GetChanged(std::string& path);
+
+private:
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cond;
+	NotifyFun notify = nullptr;
+	bool shutdown = false;
+	std::string watchPath; // as passed to Watch()
+	std::string filePath; // the file that's actually watched (the archive for files in archives)
+	int64_t knownModTime = 0;
+	uint32_t watchGeneration = 0; // incremented by Watch(), so the thread notices
+	bool changed = false;
+#ifdef __linux__
+	int wakeupPipe[2] = { -1, -1 }; // to wake up the thread while it waits for inotify
+#endif
+
+	void ThreadFun();
+	void WakeUp();
+};
+
+// checks which formats BasisU textures can be transcoded to on this GPU,
+// must be called with a current OpenGL context (after TV_LoadGLextra()).
+// implemented in transcode.cpp
+extern void ProbeTranscodeTargets();
+
+// size limit for the on-disk cache of decoded/transcoded textures (diskcache.cpp),
+// 0 disables it. the default is 2GB
+extern void SetDiskCacheBudget(size_t budget);
+extern size_t GetDiskCacheBudget();
+// deletes the least recently used files (cached textures and shader program binaries)
+// from the disk cache until it fits in the budget
+extern void TrimDiskCache();
+
+// headless mode: prints information about the given texture files (or all
+// supported files in the given directories) as JSON or CSV, without creating
+// a window or OpenGL context. args are the commandline arguments after "--info".
+// returns the exit code for main()
+extern int RunInfoMode(int argc, char** argv);
+
 } //namespace texview
 
 #endif // _TEXVIEW_H
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ *
+ * Multithreaded transcoding of BasisU (ETC1S/BasisLZ and UASTC) KTX2 textures.
+ * libktx's ktxTexture2_TranscodeBasis() transcodes one image after the other
+ * on one thread, which takes ages for big arrays/cubemaps with many mips.
+ * This uses the same low-level basisu transcoders (that libktx uses internally),
+ * but splits the work into (level, layer, face) images - and for UASTC even
+ * into ranges of block rows - that are transcoded by several threads,
+ * directly into the buffer that's later uploaded.
+ * The target format is the smallest one that fits the texture's content
+ * (opaque, alpha, red-only or red/green) and is supported by the GPU.
+ */
+
+#include "gl_extra.h"
+
+#include "libs/dg_libktx_extra.h"
+
+#include <ktx.h>
+#include <KHR/khr_df.h>
+
+// these must match the definitions ktx_read is built with, see libs/ktx/CMakeLists.txt
+#define BASISD_SUPPORT_KTX2 0
+#define BASISD_SUPPORT_KTX2_ZSTD 0
+#define BASISD_SUPPORT_FXT1 0
+#include "libs/ktx/external/basisu/transcoder/basisu_transcoder.h"
+
+// libktx internals, needed for the level index and the BasisLZ global data
+#include "libs/ktx/lib/ktxint.h"
+#include "libs/ktx/lib/texture2.h"
+#include "libs/ktx/lib/basis_sgd.h"
+
+#include "texview.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace texview {
+
+// UASTC images are split into jobs of about this many bytes of input data
+// (ETC1S slices can't be split, they're entropy coded as a whole)
+static const size_t UASTC_JOB_SIZE = 256 * 1024;
+
+struct TranscodeTarget {
+	ktx_transcode_fmt_e ktxFmt;
+	GLenum glIntFormat;
+	GLenum glIntFormatSRGB; // 0 if there is no sRGB variant
+	uint32_t bytesPerBlock; // 4x4 blocks; 0 if uncompressed
+	uint32_t bytesPerPixel; // only for uncompressed
+	const char* name;
+};
+
+enum TranscodeTargetIndex {
+	TT_BC1, TT_BC3, TT_BC4, TT_BC5, TT_BC7, TT_ETC1, TT_ETC2, TT_ASTC, TT_RGBA32,
+	TT_NUM
+};
+
+// indexed by TranscodeTargetIndex
+static const TranscodeTarget transcodeTargets[TT_NUM] = {
+	{ KTX_TTF_BC1_RGB,  GL_COMPRESSED_RGB_S3TC_DXT1_EXT,  GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,            8, 0, "BC1 (DXT1)" },
+	{ KTX_TTF_BC3_RGBA, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,     16, 0, "BC3 (DXT5)" },
+	{ KTX_TTF_BC4_R,    GL_COMPRESSED_RED_RGTC1,          0,                                            8, 0, "BC4 (RGTC1)" },
+	{ KTX_TTF_BC5_RG,   GL_COMPRESSED_RG_RGTC2,           0,                                           16, 0, "BC5 (RGTC2)" },
+	{ KTX_TTF_BC7_RGBA, GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB,   16, 0, "BC7 (BPTC)" },
+	// ETC1 is a subset of ETC2, so it can be uploaded as ETC2
+	{ KTX_TTF_ETC1_RGB, GL_COMPRESSED_RGB8_ETC2,          GL_COMPRESSED_SRGB8_ETC2,                     8, 0, "ETC1" },
+	{ KTX_TTF_ETC2_RGBA, GL_COMPRESSED_RGBA8_ETC2_EAC,    GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC,         16, 0, "ETC2 RGBA" },
+	{ KTX_TTF_ASTC_4x4_RGBA, GL_COMPRESSED_RGBA_ASTC_4x4_KHR, GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR, 16, 0, "ASTC 4x4" },
+	{ KTX_TTF_RGBA32,   GL_RGBA8,                         GL_SRGB8_ALPHA8,                              0, 4, "RGBA8 (uncompressed)" },
+};
+
+// the candidates for the different kinds of content, smallest first.
+// for the same size the BCn formats are preferred, because desktop drivers that
+// advertise ETC2 (and sometimes ASTC) often decompress them to RGBA8 internally.
+// RGBA32 always works, so it's the last resort
+static const uint8_t targetsOpaque[] = { TT_BC1, TT_ETC1, TT_BC7, TT_ASTC, TT_BC3, TT_ETC2, TT_RGBA32 };
+static const uint8_t targetsAlpha[]  = { TT_BC7, TT_BC3, TT_ASTC, TT_ETC2, TT_RGBA32 };
+static const uint8_t targetsRed[]    = { TT_BC4, TT_BC1, TT_ETC1, TT_BC7, TT_ASTC, TT_RGBA32 };
+static const uint8_t targetsRG[]     = { TT_BC5, TT_BC7, TT_BC3, TT_ASTC, TT_ETC2, TT_RGBA32 };
+
+// bit (1 << TranscodeTargetIndex) is set if the GPU supports the target in the
+// linear or sRGB variant. ProbeTranscodeTargets() sets them, until then (and in
+// --info mode, which has no OpenGL context) everything is assumed to be supported
+static std::atomic<uint32_t> supportedTargets( (1u << TT_NUM) - 1 );
+static std::atomic<uint32_t> supportedTargetsSRGB( (1u << TT_NUM) - 1 );
+
+static bool IsInternalFormatSupported(GLenum intFormat)
+{
+	if(intFormat == 0) {
+		return false;
+	}
+	if(!TV_GL_ARB_internalformat_query2) {
+		return true; // can't tell, trust the extensions
+	}
+	GLint supported = GL_FALSE;
+	glGetInternalformativ(GL_TEXTURE_2D, intFormat, GL_INTERNALFORMAT_SUPPORTED, 1, &supported);
+	return supported == GL_TRUE;
+}
+
+void ProbeTranscodeTargets()
+{
+	const int glVersion = TV_GetGLversion();
+	uint32_t linear = 0;
+	uint32_t srgb = 0;
+	for(int i=0; i < TT_NUM; ++i) {
+		bool haveExt = false;
+		bool haveSRGBext = false;
+		switch(i) {
+			case TT_BC1:
+			case TT_BC3:
+				haveExt = GLAD_GL_EXT_texture_compression_s3tc;
+				haveSRGBext = haveExt && GLAD_GL_EXT_texture_sRGB;
+				break;
+			case TT_BC4:
+			case TT_BC5:
+				// RGTC is core since OpenGL 3.0
+				haveExt = true;
+				break;
+			case TT_BC7:
+				haveExt = haveSRGBext = (glVersion >= 42 || GLAD_GL_ARB_texture_compression_bptc);
+				break;
+			case TT_ETC1:
+			case TT_ETC2:
+				haveExt = haveSRGBext = (glVersion >= 43 || GLAD_GL_ARB_ES3_compatibility);
+				break;
+			case TT_ASTC:
+				haveExt = haveSRGBext = GLAD_GL_KHR_texture_compression_astc_ldr;
+				break;
+			case TT_RGBA32:
+				haveExt = haveSRGBext = true;
+				break;
+		}
+		const TranscodeTarget& t = transcodeTargets[i];
+		if(haveExt && IsInternalFormatSupported(t.glIntFormat)) {
+			linear |= 1u << i;
+		}
+		if(haveSRGBext && IsInternalFormatSupported(t.glIntFormatSRGB)) {
+			srgb |= 1u << i;
+		}
+	}
+	// RGBA8 is required by OpenGL, no matter what glGetInternalformativ() claims
+	linear |= 1u << TT_RGBA32;
+	srgb |= 1u << TT_RGBA32;
+	supportedTargets = linear;
+	supportedTargetsSRGB = srgb;
+}
+
+struct TranscodeJob {
+	uint32_t level;
+	uint32_t width, height; // of the (part of the) image that's transcoded
+	uint32_t numBlocksX, numBlocksY;
+	// for ETC1S: offsets in the level data + lengths of the RGB and alpha slice
+	// for UASTC: offset and length in the level data in rgbOffset/rgbLength
+	uint32_t rgbOffset, rgbLength;
+	uint32_t alphaOffset, alphaLength;
+	size_t dstOffset;
+	size_t dstSize; // in blocks or (for uncompressed) pixels
+};
+
+static void InitBasisTranscoder()
+{
+	// thread-safe since C++11, in case several textures are loaded at once
+	static bool initialized = [](){
+		basist::basisu_transcoder_init();
+		return true;
+	}();
+	(void)initialized;
+}
+
+// what's in a BasisU texture, according to its DFD
+struct BasisContent {
+	bool isETC1S; // else UASTC
+	bool isSRGB;
+	bool redOnly; // just one channel
+	alpha_content_e alphaContent; // eGreen means it's two channels (RG)
+};
+
+static BasisContent GetBasisContent(const ktxTexture2* ktxTex2)
+{
+	const uint32_t* bdb = ktxTex2->pDfd + 1;
+	BasisContent ret = {};
+	ret.isETC1S = (ktxTex2->supercompressionScheme == KTX_SS_BASIS_LZ);
+	ret.isSRGB = (KHR_DFDVAL(bdb, TRANSFER) == KHR_DF_TRANSFER_SRGB);
+	// ktxTexture_FormatHasAlpha() doesn't help here, BasisU textures have no VkFormat.
+	// so this uses the same logic as libktx's ktxTexture2_TranscodeBasis()
+	ret.alphaContent = eNone;
+	if(ret.isETC1S) {
+		if(KHR_DFDSAMPLECOUNT(bdb) == 2) {
+			uint32_t channelId = KHR_DFDSVAL(bdb, 1, CHANNELID);
+			if(channelId == KHR_DF_CHANNEL_ETC1S_AAA) {
+				ret.alphaContent = eAlpha;
+			} else if(channelId == KHR_DF_CHANNEL_ETC1S_GGG) {
+				ret.alphaContent = eGreen;
+			}
+		} else {
+			ret.redOnly = (KHR_DFDSVAL(bdb, 0, CHANNELID) == KHR_DF_CHANNEL_ETC1S_RRR);
+		}
+	} else {
+		uint32_t channelId = KHR_DFDSVAL(bdb, 0, CHANNELID);
+		if(channelId == KHR_DF_CHANNEL_UASTC_RGBA) {
+			ret.alphaContent = eAlpha;
+		} else if(channelId == KHR_DF_CHANNEL_UASTC_RRRG) {
+			ret.alphaContent = eGreen;
+		} else if(channelId == KHR_DF_CHANNEL_UASTC_RRR) {
+			ret.redOnly = true;
+		}
+	}
+	return ret;
+}
+
+// returns the smallest target that fits the content and is supported by
+// both the GPU and the transcoder (for the given codec)
+static const TranscodeTarget* ChooseTranscodeTarget(const BasisContent& content)
+{
+	const uint8_t* candidates = targetsOpaque;
+	size_t numCandidates = sizeof(targetsOpaque);
+	if(content.alphaContent == eAlpha) {
+		candidates = targetsAlpha;
+		numCandidates = sizeof(targetsAlpha);
+	} else if(content.alphaContent == eGreen) {
+		candidates = targetsRG;
+		numCandidates = sizeof(targetsRG);
+	} else if(content.redOnly) {
+		candidates = targetsRed;
+		numCandidates = sizeof(targetsRed);
+	}
+	const uint32_t supported = content.isSRGB ? supportedTargetsSRGB.load() : supportedTargets.load();
+	const basist::basis_tex_format codec = content.isETC1S ? basist::basis_tex_format::cETC1S
+	                                                       : basist::basis_tex_format::cUASTC4x4;
+	for(size_t i=0; i < numCandidates; ++i) {
+		const TranscodeTarget& t = transcodeTargets[candidates[i]];
+		if((supported & (1u << candidates[i])) != 0
+		   && basist::basis_is_format_supported((basist::transcoder_texture_format)t.ktxFmt, codec)) {
+			return &t;
+		}
+	}
+	return nullptr;
+}
+
+int Texture::ChooseBasisTarget(const ktxTexture2* ktxTex2, const char** targetName)
+{
+	const TranscodeTarget* target = ChooseTranscodeTarget(GetBasisContent(ktxTex2));
+	if(target == nullptr) {
+		return -1;
+	}
+	if(targetName != nullptr) {
+		*targetName = target->name;
+	}
+	return target->ktxFmt;
+}
+
+const char* Texture::FindTranscodeTargetName(const char* name)
+{
+	for(const TranscodeTarget& t : transcodeTargets) {
+		if(strcmp(t.name, name) == 0) {
+			return t.name;
+		}
+	}
+	return nullptr;
+}
+
+bool Texture::CanTranscodeBasis(const ktxTexture2* ktxTex2)
+{
+	// video is transcoded frame by frame (P-frames depend on the previous frame)
+	// and 3D textures aren't supported by texview (yet), libktx can handle those
+	return !ktxTex2->isVideo && ktxTex2->baseDepth <= 1 && ktxTex2->pData != nullptr;
+}
+
+bool Texture::TranscodeBasis(ktxTexture2* ktxTex2, const char* filename, LoadProgress* progress)
+{
+	const uint32_t* bdb = ktxTex2->pDfd + 1;
+	const khr_df_model_e colorModel = (khr_df_model_e)KHR_DFDVAL(bdb, MODEL);
+	const BasisContent content = GetBasisContent(ktxTex2);
+	const bool isETC1S = content.isETC1S;
+	const bool isSRGB = content.isSRGB;
+	const alpha_content_e alphaContent = content.alphaContent;
+	if(!isETC1S && colorModel != KHR_DF_MODEL_UASTC) {
+		errprintf("Can't transcode '%s', it's neither ETC1S/BasisLZ nor UASTC\n", filename);
+		return false;
+	}
+
+	const TranscodeTarget* targetPtr = ChooseTranscodeTarget(content);
+	if(targetPtr == nullptr) {
+		errprintf("Can't transcode '%s', found no format that's supported by both the GPU and the transcoder\n", filename);
+		return false;
+	}
+	const TranscodeTarget& target = *targetPtr;
+	const basist::transcoder_texture_format basisFmt = (basist::transcoder_texture_format)target.ktxFmt;
+
+	InitBasisTranscoder();
+
+	ktxTexture2_private& priv = *ktxTex2->_private;
+	const uint32_t numLevels = ktxTex2->numLevels;
+	const uint32_t imagesPerLevel = ktxTex2->numLayers * ktxTex2->numFaces;
+
+	basist::basisu_lowlevel_etc1s_transcoder etc1sTranscoder;
+	const ktxBasisLzEtc1sImageDesc* imageDescs = nullptr;
+	if(isETC1S) {
+		uint8_t* bgd = priv._supercompressionGlobalData;
+		if(bgd == nullptr || priv._sgdByteLength < sizeof(ktxBasisLzGlobalHeader)) {
+			errprintf("Can't transcode '%s', the BasisLZ global data is missing\n", filename);
+			return false;
+		}
+		const ktxBasisLzGlobalHeader& bgdh = *(const ktxBasisLzGlobalHeader*)bgd;
+		const uint32_t imageCount = numLevels * imagesPerLevel;
+		if(bgdh.endpointsByteLength == 0 || bgdh.selectorsByteLength == 0 || bgdh.tablesByteLength == 0
+		   || BGD_TABLES_ADDR(0, bgdh, imageCount) + bgdh.tablesByteLength > priv._sgdByteLength) {
+			errprintf("Can't transcode '%s', the BasisLZ global data is broken\n", filename);
+			return false;
+		}
+		// the codebooks are decoded once and then shared by all threads
+		// (each thread only needs its own basisu_transcoder_state)
+		if(!etc1sTranscoder.decode_palettes(bgdh.endpointCount, BGD_ENDPOINTS_ADDR(bgd, imageCount),
+		                                    bgdh.endpointsByteLength, bgdh.selectorCount,
+		                                    BGD_SELECTORS_ADDR(bgd, bgdh, imageCount), bgdh.selectorsByteLength)
+		   || !etc1sTranscoder.decode_tables(BGD_TABLES_ADDR(bgd, bgdh, imageCount), bgdh.tablesByteLength)) {
+			errprintf("Can't transcode '%s', decoding the BasisLZ codebooks failed\n", filename);
+			return false;
+		}
+		imageDescs = BGD_ETC1S_IMAGE_DESCS(bgd);
+	}
+
+	// set up the jobs and calculate where each image goes in the output buffer.
+	// the output is one image after the other, level 0 first, in the same order
+	// as in the KTX file (all faces of layer 0, then all faces of layer 1, ...)
+	std::vector<TranscodeJob> jobs;
+	std::vector<size_t> imageOffsets(numLevels * imagesPerLevel);
+	std::vector<uint32_t> imageSizes(numLevels);
+	size_t outSize = 0;
+	for(uint32_t level = 0; level < numLevels; ++level) {
+		const uint32_t w = std::max(ktxTex2->baseWidth >> level, 1u);
+		const uint32_t h = std::max(ktxTex2->baseHeight >> level, 1u);
+		const uint32_t blocksX = (w + 3) / 4;
+		const uint32_t blocksY = (h + 3) / 4;
+		const uint64_t levelOffset = ktxTexture2_levelDataOffset(ktxTex2, level);
+		const size_t outRowSize = target.bytesPerBlock != 0 ? size_t(blocksX) * target.bytesPerBlock
+		                                                    : size_t(w) * 4 * target.bytesPerPixel;
+		imageSizes[level] = uint32_t(target.bytesPerBlock != 0 ? outRowSize * blocksY
+		                                                       : size_t(w) * h * target.bytesPerPixel);
+		// uncompressed UASTC input has 16 bytes per block
+		const uint32_t inImageSize = blocksX * blocksY * 16;
+		uint32_t rowsPerJob = blocksY;
+		if(!isETC1S) {
+			rowsPerJob = std::max(uint32_t(UASTC_JOB_SIZE / (size_t(blocksX) * 16)), 1u);
+		}
+
+		for(uint32_t img = 0; img < imagesPerLevel; ++img) {
+			imageOffsets[level * imagesPerLevel + img] = outSize;
+			TranscodeJob job = {};
+			job.level = level;
+			job.width = w;
+			job.numBlocksX = blocksX;
+			if(isETC1S) {
+				const ktxBasisLzEtc1sImageDesc& desc = imageDescs[level * imagesPerLevel + img];
+				if(alphaContent != eNone && (desc.alphaSliceByteOffset == 0 || desc.alphaSliceByteLength == 0)) {
+					errprintf("Can't transcode '%s', alpha slice of image %u in level %u is missing\n",
+					          filename, img, level);
+					return false;
+				}
+				job.height = h;
+				job.numBlocksY = blocksY;
+				job.rgbOffset = uint32_t(levelOffset + desc.rgbSliceByteOffset);
+				job.rgbLength = desc.rgbSliceByteLength;
+				job.alphaOffset = uint32_t(levelOffset + desc.alphaSliceByteOffset);
+				job.alphaLength = desc.alphaSliceByteLength;
+				job.dstOffset = outSize;
+				job.dstSize = target.bytesPerBlock != 0 ? size_t(blocksX) * blocksY : size_t(w) * h;
+				jobs.push_back(job);
+			} else {
+				// UASTC blocks are independent of each other, so big images are split
+				// into several jobs with a range of block rows each
+				const uint64_t imageOffset = levelOffset + uint64_t(img) * inImageSize;
+				for(uint32_t row = 0; row < blocksY; row += rowsPerJob) {
+					uint32_t numRows = std::min(rowsPerJob, blocksY - row);
+					job.numBlocksY = numRows;
+					job.height = std::min(numRows * 4, h - row * 4);
+					job.rgbOffset = uint32_t(imageOffset + size_t(row) * blocksX * 16);
+					job.rgbLength = numRows * blocksX * 16;
+					job.dstOffset = outSize + row * outRowSize;
+					job.dstSize = target.bytesPerBlock != 0 ? size_t(blocksX) * numRows : size_t(w) * job.height;
+					jobs.push_back(job);
+				}
+			}
+			outSize += imageSizes[level];
+		}
+	}
+
+	unsigned char* outData = (unsigned char*)malloc(outSize);
+	if(outData == nullptr) {
+		errprintf("Couldn't allocate %zu bytes for transcoding '%s'\n", outSize, filename);
+		return false;
+	}
+
+	if(progress != nullptr) {
+		progress->Set("Transcoding", 0.0f);
+	}
+
+	basist::basisu_lowlevel_uastc_transcoder uastcTranscoder;
+	const uint8_t* inData = ktxTex2->pData;
+	const uint32_t inDataSize = uint32_t(ktxTex2->dataSize);
+	const bool hasAlpha = (alphaContent != eNone);
+	std::atomic<size_t> nextJob(0);
+	std::atomic<size_t> jobsDone(0);
+	std::atomic<bool> failed(false);
+	auto workerFun = [&]() {
+		basist::basisu_transcoder_state state;
+		while(!failed.load(std::memory_order_relaxed)) {
+			size_t idx = nextJob++;
+			if(idx >= jobs.size()) {
+				break;
+			}
+			if(progress != nullptr && progress->IsCancelled()) {
+				failed = true;
+				break;
+			}
+			const TranscodeJob& job = jobs[idx];
+			bool ok;
+			if(isETC1S) {
+				ok = etc1sTranscoder.transcode_image(basisFmt, outData + job.dstOffset, uint32_t(job.dstSize),
+				                                     inData, inDataSize, job.numBlocksX, job.numBlocksY,
+				                                     job.width, job.height, job.level,
+				                                     job.rgbOffset, job.rgbLength, job.alphaOffset, job.alphaLength,
+				                                     0, hasAlpha, false, 0, &state);
+			} else {
+				ok = uastcTranscoder.transcode_image(basisFmt, outData + job.dstOffset, uint32_t(job.dstSize),
+				                                     inData, inDataSize, job.numBlocksX, job.numBlocksY,
+				                                     job.width, job.height, job.level,
+				                                     job.rgbOffset, job.rgbLength, 0, hasAlpha, false, 0, &state);
+			}
+			if(!ok) {
+				errprintf("Transcoding level %u of '%s' failed\n", job.level, filename);
+				failed = true;
+				break;
+			}
+			size_t done = ++jobsDone;
+			if(progress != nullptr) {
+				progress->Set("Transcoding", float(done) / jobs.size());
+			}
+		}
+	};
+
+	int numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	numThreads = std::min(numThreads, (int)jobs.size());
+	std::vector<std::thread> threads;
+	for(int i=1; i < numThreads; ++i) {
+		threads.push_back(std::thread(workerFun));
+	}
+	workerFun(); // this thread helps as well
+	for(std::thread& t : threads) {
+		t.join();
+	}
+
+	if(failed) {
+		free(outData);
+		return false;
+	}
+
+	dataFormat = isSRGB ? target.glIntFormatSRGB : target.glIntFormat;
+	// for compressed formats that's only needed for glTexImage3D(..., NULL), like with DDS
+	glFormat = GL_RGBA;
+	glType = GL_UNSIGNED_BYTE;
+	if(target.bytesPerBlock != 0) {
+		textureFlags |= TF_COMPRESSED;
+	}
+	if(alphaContent == eAlpha) {
+		textureFlags |= TF_HAS_ALPHA;
+	}
+	if(isSRGB) {
+		textureFlags |= TF_SRGB;
+	}
+	if(IsArray()) {
+		glTarget = IsCubemap() ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_2D_ARRAY;
+	} else {
+		glTarget = IsCubemap() ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	}
+	transcodeTarget = target.name;
+
+	for(size_t e=0; e < elements.size(); ++e) {
+		std::vector<MipLevel>& mipLevels = elements[e];
+		for(uint32_t level = 0; level < numLevels && level < mipLevels.size(); ++level) {
+			mipLevels[level].data = outData + imageOffsets[level * imagesPerLevel + e];
+			mipLevels[level].size = imageSizes[level];
+		}
+	}
+
+	texData = outData;
+	cpuDataSize = outSize;
+	texDataFreeCookie = 0;
+	texDataFreeFun = [](void* texData, intptr_t) -> void { free(texData); };
+
+	return true;
+}
+
+} //namespace texview
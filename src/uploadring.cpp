@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ */
+
+#include "gl_extra.h"
+
+#include "texview.h"
+
+#include <string.h>
+
+namespace texview {
+
+// bigger copies are split into chunks of this size so all copy threads can help
+static const size_t COPY_CHUNK_SIZE = 1024 * 1024;
+// offsets in the buffer are aligned to this
+static const size_t RING_ALIGNMENT = 64;
+
+bool UploadRing::Init(size_t size, int numCopyThreads)
+{
+	if(!TV_GL_ARB_buffer_storage) {
+		errprintf("Can't use PBO ring buffer for uploads, needs GL_ARB_buffer_storage or OpenGL 4.4\n");
+		return false;
+	}
+	glGetError();
+	glGenBuffers(1, &bufferHandle);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+	void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLenum e = glGetError();
+	if(ptr == nullptr || e != GL_NO_ERROR) {
+		errprintf("Creating or mapping the PBO ring buffer (%zu bytes) failed, glGetError() says 0x%x\n", size, e);
+		glDeleteBuffers(1, &bufferHandle);
+		bufferHandle = 0;
+		return false;
+	}
+	mappedPtr = (unsigned char*)ptr;
+	ringSize = size;
+	head = 0;
+	shutdown = false;
+
+	for(int i=0; i < numCopyThreads; ++i) {
+		threads.push_back( std::thread(&UploadRing::CopyThread, this) );
+	}
+	return true;
+}
+
+void UploadRing::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+		chunks.clear();
+	}
+	cond.notify_all();
+	for(std::thread& t : threads) {
+		t.join();
+	}
+	threads.clear();
+
+	for(Segment& seg : segments) {
+		if(seg.fence != nullptr) {
+			glDeleteSync((GLsync)seg.fence);
+		}
+	}
+	segments.clear();
+
+	if(bufferHandle != 0) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &bufferHandle);
+		bufferHandle = 0;
+	}
+	mappedPtr = nullptr;
+	ringSize = 0;
+}
+
+bool UploadRing::FindSpace(size_t size, size_t& offset) const
+{
+	if(segments.empty()) {
+		offset = 0;
+		return size <= ringSize;
+	}
+	size_t tail = segments.front().job->offset;
+	if(head > tail) {
+		// used part doesn't wrap around (yet), so there's free space at the end and at the start
+		if(head + size <= ringSize) {
+			offset = head;
+			return true;
+		}
+		if(size <= tail) {
+			offset = 0;
+			return true;
+		}
+	} else if(head < tail) {
+		// used part wraps around, only the space between head and tail is free
+		if(head + size <= tail) {
+			offset = head;
+			return true;
+		}
+	}
+	// head == tail with segments in use means the buffer is full
+	return false;
+}
+
+bool UploadRing::FreeOldestSegment(bool wait)
+{
+	if(segments.empty()) {
+		return false;
+	}
+	Segment& seg = segments.front();
+	if(seg.state == SEG_PENDING) {
+		// the upload of this hasn't even been issued yet, can't do anything about it
+		return false;
+	}
+	if(seg.state == SEG_ISSUED) {
+		GLuint64 timeout = wait ? 1000000000 : 0; // 1 second should be plenty
+		GLenum res = glClientWaitSync((GLsync)seg.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if(res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED) {
+			if(res == GL_WAIT_FAILED || wait) {
+				errprintf("Waiting for PBO ring fence failed (0x%x)?!\n", res);
+			}
+			return false;
+		}
+		glDeleteSync((GLsync)seg.fence);
+	} else { // SEG_RELEASED
+		if(wait) {
+			WaitForCopyDone(seg.job);
+		} else if(seg.job->chunksLeft.load() != 0) {
+			return false;
+		}
+	}
+	segments.pop_front();
+	return true;
+}
+
+UploadRing::Ticket UploadRing::Enqueue(const void* data, size_t size)
+{
+	if(mappedPtr == nullptr || size > ringSize) {
+		return nullptr;
+	}
+	// free whatever the GPU is already done with
+	while(FreeOldestSegment(false))
+		;
+
+	size_t offset = 0;
+	while(!FindSpace(size, offset)) {
+		if(!FreeOldestSegment(true)) {
+			return nullptr;
+		}
+	}
+
+	Ticket job = std::make_shared<CopyJob>();
+	job->src = data;
+	job->offset = offset;
+	job->size = size;
+
+	Segment seg;
+	seg.job = job;
+	seg.end = offset + size;
+	segments.push_back(seg);
+	head = (seg.end + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+	if(head >= ringSize) {
+		head = 0;
+	}
+
+	size_t numChunks = (size + COPY_CHUNK_SIZE - 1) / COPY_CHUNK_SIZE;
+	job->chunksLeft = int(numChunks);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(size_t i=0; i < numChunks; ++i) {
+			size_t chunkOffset = i * COPY_CHUNK_SIZE;
+			Chunk c;
+			c.src = (const unsigned char*)data + chunkOffset;
+			c.dst = mappedPtr + offset + chunkOffset;
+			c.size = std::min(COPY_CHUNK_SIZE, size - chunkOffset);
+			c.job = job;
+			chunks.push_back(c);
+		}
+	}
+	if(numChunks > 1) {
+		cond.notify_all();
+	} else {
+		cond.notify_one();
+	}
+	return job;
+}
+
+void UploadRing::WaitForCopyDone(const Ticket& t)
+{
+	if(t->chunksLeft.load() == 0) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCond.wait(lock, [&t]{ return t->chunksLeft.load() == 0; });
+}
+
+const void* UploadRing::WaitForCopy(const Ticket& t)
+{
+	WaitForCopyDone(t);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+	return (const void*)(uintptr_t)t->offset;
+}
+
+UploadRing::Segment* UploadRing::FindSegment(const Ticket& t)
+{
+	// usually it's one of the newest
+	for(auto it = segments.rbegin(); it != segments.rend(); ++it) {
+		if(it->job == t) {
+			return &(*it);
+		}
+	}
+	return nullptr;
+}
+
+void UploadRing::Issued(const Ticket& t)
+{
+	Segment* seg = FindSegment(t);
+	if(seg != nullptr) {
+		seg->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		seg->state = SEG_ISSUED;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadRing::Release(const Ticket& t)
+{
+	// the caller may free the source data right after this, so the copy threads
+	// must not touch it anymore: drop the chunks that haven't been started yet
+	// and wait for the ones that are being copied right now
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(auto it = chunks.begin(); it != chunks.end(); ) {
+			if(it->job == t) {
+				--t->chunksLeft;
+				it = chunks.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+	WaitForCopyDone(t);
+	Segment* seg = FindSegment(t);
+	if(seg != nullptr) {
+		seg->state = SEG_RELEASED;
+	}
+}
+
+void UploadRing::CopyThread()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true) {
+		cond.wait(lock, [this]{ return shutdown || !chunks.empty(); });
+		if(shutdown) {
+			break;
+		}
+		Chunk c = chunks.front();
+		chunks.pop_front();
+		lock.unlock();
+
+		memcpy(c.dst, c.src, c.size);
+
+		lock.lock();
+		if(--c.job->chunksLeft == 0) {
+			doneCond.notify_all();
+		}
+	}
+}
+
+} //namespace texview
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2025 Daniel Gibson
+ *
+ * Released under MIT License, see Licenses.txt
+ */
+
+#include "gl_extra.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include "texview.h"
+
+#include <algorithm>
+
+namespace texview {
+
+bool UploadThread::Init(GLFWwindow* context_, NotifyFun notifyFun)
+{
+	context = context_;
+	notify = notifyFun;
+	shutdown = false;
+	thread = std::thread(&UploadThread::ThreadFun, this);
+	return true;
+}
+
+void UploadThread::Shutdown()
+{
+	if(!thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+		cancelRunning = true;
+	}
+	cond.notify_all();
+	thread.join();
+
+	// textures and fences are shared with the main context,
+	// so they can be freed here (in the main thread)
+	for(JobPtr& job : finishedJobs) {
+		if(job->fence != nullptr) {
+			glDeleteSync((GLsync)job->fence);
+		}
+	}
+	finishedJobs.clear();
+	pendingJobs.clear();
+}
+
+void UploadThread::Submit(Texture& tex, bool allowImmutableStorage, bool useRing)
+{
+	JobPtr job = std::make_shared<Job>();
+	job->tex = std::move(tex);
+	job->allowImmutableStorage = allowImmutableStorage;
+	job->useRing = useRing;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// only the newest texture is interesting, the others are given back without uploading
+		for(JobPtr& j : pendingJobs) {
+			finishedJobs.push_back(j);
+		}
+		pendingJobs.clear();
+		if(runningJob != nullptr) {
+			cancelRunning = true;
+		}
+		pendingJobs.push_back(job);
+	}
+	cond.notify_one();
+}
+
+bool UploadThread::GetFinished(Texture& tex)
+{
+	JobPtr job;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(finishedJobs.empty()) {
+			return false;
+		}
+		job = finishedJobs.front();
+		if(job->fence != nullptr) {
+			// don't block the main thread, just check if the GPU is done with it
+			GLenum res = glClientWaitSync((GLsync)job->fence, 0, 0);
+			if(res == GL_TIMEOUT_EXPIRED) {
+				return false;
+			}
+			glDeleteSync((GLsync)job->fence);
+			job->fence = nullptr;
+		}
+		finishedJobs.pop_front();
+	}
+	tex = std::move(job->tex);
+	return true;
+}
+
+bool UploadThread::GetCurrentUpload(std::string& path, float& progress)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(runningJob != nullptr && !cancelRunning) {
+		path = runningPath;
+		progress = runningProgress;
+		return true;
+	}
+	if(!pendingJobs.empty()) {
+		path = pendingJobs.front()->tex.name;
+		progress = 0.0f;
+		return true;
+	}
+	return false;
+}
+
+bool UploadThread::IsBusy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return runningJob != nullptr || !pendingJobs.empty() || !finishedJobs.empty();
+}
+
+void UploadThread::ThreadFun()
+{
+	glfwMakeContextCurrent(context);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true) {
+		cond.wait(lock, [this]{ return shutdown || !pendingJobs.empty(); });
+		if(shutdown) {
+			break;
+		}
+		JobPtr job = pendingJobs.front();
+		pendingJobs.pop_front();
+		runningJob = job;
+		runningPath = job->tex.name;
+		runningProgress = 0.0f;
+		cancelRunning = false;
+		lock.unlock();
+
+		UploadRing* uploadRing = nullptr;
+		if(job->useRing && TV_GL_ARB_buffer_storage) {
+			if(!ring.IsAvailable()) {
+				ring.Init(64 * 1024 * 1024);
+			}
+			uploadRing = ring.IsAvailable() ? &ring : nullptr;
+		}
+
+		Texture& tex = job->tex;
+		bool cancelled = false;
+		if(tex.StartOpenGLupload(job->allowImmutableStorage)) {
+			const int numMips = std::max(tex.GetNumMips(), 1);
+			// uploading in small steps so cancelling doesn't take too long
+			while(!tex.ContinueOpenGLupload(0.05, uploadRing)) {
+				runningProgress = float(numMips - tex.GetFirstCompleteMip()) / numMips;
+				if(cancelRunning) {
+					cancelled = true;
+					break;
+				}
+			}
+		}
+		if(cancelled) {
+			tex.ReleaseOpenGLtexture();
+		} else if(tex.glTextureHandle != 0) {
+			job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		// make sure the commands (incl. the fence) are actually sent to the GPU,
+		// otherwise the main thread might wait for the fence forever
+		glFlush();
+
+		lock.lock();
+		runningJob = nullptr;
+		runningPath.clear();
+		finishedJobs.push_back(job);
+		if(notify != nullptr) {
+			notify();
+		}
+	}
+	lock.unlock();
+
+	ring.Shutdown();
+	glfwMakeContextCurrent(nullptr);
+}
+
+} //namespace texview